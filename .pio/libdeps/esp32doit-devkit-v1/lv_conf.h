@@ -23,8 +23,13 @@
    COLOR SETTINGS
  *====================*/
 
-/*Color depth: 1 (1 byte per pixel), 8 (RGB332), 16 (RGB565), 32 (ARGB8888)*/
+/*Color depth: 1 (1 byte per pixel), 8 (RGB332), 16 (RGB565), 32 (ARGB8888)
+ *Build with -DCYD_LV_COLOR_DEPTH=8 to render in RGB332, expanded to RGB565 by display_flush_cb*/
+#ifdef CYD_LV_COLOR_DEPTH
+#define LV_COLOR_DEPTH CYD_LV_COLOR_DEPTH
+#else
 #define LV_COLOR_DEPTH 16
+#endif
 
 /*Swap the 2 bytes of RGB565 color. Useful if the display has an 8-bit interface (e.g. SPI)*/
 #define LV_COLOR_16_SWAP 0
@@ -309,14 +314,22 @@
 /*For big endian systems set to 1*/
 #define LV_BIG_ENDIAN_SYSTEM 0
 
+/*CYD: build with -DCYD_FAST_MEM to run the tick, flush-ready and draw/blend hot paths from IRAM*/
+#ifdef CYD_FAST_MEM
+#include "esp_attr.h"
+#define CYD_IRAM IRAM_ATTR
+#else
+#define CYD_IRAM
+#endif
+
 /*Define a custom attribute to `lv_tick_inc` function*/
-#define LV_ATTRIBUTE_TICK_INC
+#define LV_ATTRIBUTE_TICK_INC CYD_IRAM
 
 /*Define a custom attribute to `lv_timer_handler` function*/
 #define LV_ATTRIBUTE_TIMER_HANDLER
 
 /*Define a custom attribute to `lv_disp_flush_ready` function*/
-#define LV_ATTRIBUTE_FLUSH_READY
+#define LV_ATTRIBUTE_FLUSH_READY CYD_IRAM
 
 /*Required alignment size for buffers*/
 #define LV_ATTRIBUTE_MEM_ALIGN_SIZE 1
@@ -332,7 +345,7 @@
 #define LV_ATTRIBUTE_LARGE_RAM_ARRAY
 
 /*Place performance critical functions into a faster memory (e.g RAM)*/
-#define LV_ATTRIBUTE_FAST_MEM
+#define LV_ATTRIBUTE_FAST_MEM CYD_IRAM
 
 /*Prefix variables that are used in GPU accelerated operations, often these need to be placed in RAM sections that are DMA accessible*/
 #define LV_ATTRIBUTE_DMA
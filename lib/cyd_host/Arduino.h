@@ -0,0 +1,50 @@
+#pragma once
+
+// Host build (env:native): the subset of the Arduino core used by the
+// engines that run without hardware (audio, ADPCM, storage, library)
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include "host_rtos.h"
+
+using std::max;
+using std::min;
+
+#define PI 3.1415926535897932384626433832795
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// Serial goes to stdout
+class HostSerial {
+ public:
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char* text);
+  size_t println(const char* text = "");
+};
+
+extern HostSerial Serial;
+
+// newlib has it; glibc only from 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = min(len, size - 1);
+    memcpy(dst, src, n);
+    dst[n] = 0;
+  }
+  return len;
+}
+#endif
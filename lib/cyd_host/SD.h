@@ -0,0 +1,57 @@
+#pragma once
+
+// Host build: the card is a directory (CYD_SD_IMAGE, default ./sd_image)
+// standing in for the FAT image, with the subset of the ESP32 SD/FS API the
+// engines use. File handles are shared on copy, as on the device.
+
+#include <memory>
+#include "Arduino.h"
+#include "SPI.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+struct HostFile;
+
+class File {
+ public:
+  File() {}
+  explicit File(std::shared_ptr<HostFile> impl) : impl(impl) {}
+
+  size_t read(uint8_t* buf, size_t len);
+  size_t write(const uint8_t* buf, size_t len);
+  bool seek(uint32_t pos);
+  size_t position();
+  size_t size();
+  void flush();
+  void close();
+
+  bool isDirectory();
+  File openNextFile(const char* mode = FILE_READ);
+  const char* name();                 // Last path component
+  const char* path();                 // From the card root
+  time_t getLastWrite();
+
+  operator bool() const { return impl != nullptr; }
+
+ private:
+  std::shared_ptr<HostFile> impl;
+};
+
+class SDFS {
+ public:
+  bool begin(uint8_t ss, SPIClass& spi, uint32_t frequency, const char* mountpoint, uint8_t max_files);
+  File open(const char* path, const char* mode = FILE_READ, bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+  uint64_t cardSize();
+};
+
+extern SDFS SD;
+
+// Card timing: every read or write call costs latency_us plus its bytes at
+// kbps (0 for no limit). Both 0 by default.
+void host_sd_set_speed(uint32_t latency_us, uint32_t kbps);
@@ -0,0 +1,17 @@
+#pragma once
+
+// Host build: the SD stand-in needs no bus, only the names
+
+#include <cstdint>
+
+#define VSPI 3
+#define HSPI 2
+
+class SPIClass {
+ public:
+  explicit SPIClass(uint8_t bus = HSPI) {}
+  void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+  void end() {}
+};
+
+extern SPIClass SPI;
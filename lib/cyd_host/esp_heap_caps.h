@@ -0,0 +1,14 @@
+#pragma once
+
+// Host build: every allocation is "DMA capable"
+
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+  return malloc(size);
+}
@@ -0,0 +1,154 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Arduino.h"
+
+// Counting semaphore; a mutex starts given, a binary semaphore taken.
+// Handles are never freed, so threads still running at exit stay safe.
+struct HostSemaphore {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t count;
+};
+
+struct HostTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notified;
+};
+
+// Thrown by vTaskDelete(NULL), caught where the task's thread starts
+struct HostTaskEnd {};
+
+static thread_local HostTask* self = NULL;
+static const auto start = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint32_t millis() {
+  return micros() / 1000;
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+HostSerial Serial;
+
+int HostSerial::printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = vprintf(format, args);
+  va_end(args);
+  return n;
+}
+
+size_t HostSerial::print(const char* text) {
+  return fputs(text, stdout) < 0 ? 0 : strlen(text);
+}
+
+size_t HostSerial::println(const char* text) {
+  return print(text) + print("\n");
+}
+
+/***************************************************************************************
+** Semaphores
+***************************************************************************************/
+
+static SemaphoreHandle_t sem_create(uint32_t count) {
+  HostSemaphore* sem = new HostSemaphore;
+  sem->count = count;
+  return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return sem_create(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return sem_create(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(sem->m);
+  auto given = [sem] { return sem->count > 0; };
+  if (ticks == portMAX_DELAY) {
+    sem->cv.wait(lock, given);
+  } else if (!sem->cv.wait_for(lock, std::chrono::milliseconds(ticks), given)) {
+    return pdFALSE;
+  }
+  sem->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  std::lock_guard<std::mutex> lock(sem->m);
+  if (sem->count) return pdFALSE;
+  sem->count = 1;
+  sem->cv.notify_one();
+  return pdTRUE;
+}
+
+/***************************************************************************************
+** Tasks and notifications
+***************************************************************************************/
+
+static HostTask* current_task() {
+  if (!self) {
+    self = new HostTask;
+    self->notified = 0;
+  }
+  return self;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* task, BaseType_t core) {
+  HostTask* t = new HostTask;
+  t->notified = 0;
+  if (task) *task = t;
+  std::thread([fn, arg, t] {
+    self = t;
+    try {
+      fn(arg);
+    } catch (HostTaskEnd&) {
+    }
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (!task) throw HostTaskEnd();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  HostTask* t = current_task();
+  std::unique_lock<std::mutex> lock(t->m);
+  auto notified = [t] { return t->notified > 0; };
+  if (ticks == portMAX_DELAY) {
+    t->cv.wait(lock, notified);
+  } else {
+    t->cv.wait_for(lock, std::chrono::milliseconds(ticks), notified);
+  }
+  uint32_t n = t->notified;
+  if (n) t->notified = clear ? 0 : n - 1;
+  return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  if (!task) return pdPASS;
+  std::lock_guard<std::mutex> lock(task->m);
+  task->notified++;
+  task->cv.notify_one();
+  return pdPASS;
+}
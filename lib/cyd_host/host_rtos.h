@@ -0,0 +1,32 @@
+#pragma once
+
+// Host build: the FreeRTOS calls the engines make, on std::thread. Tasks
+// run unpinned and unprioritised; notifying a NULL task does nothing, so
+// an engine can be driven step by step from the test thread instead.
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef struct HostSemaphore* SemaphoreHandle_t;
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* arg);
+
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))  // 1 ms ticks
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* task, BaseType_t core);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);  // NULL only: ends the calling task
@@ -0,0 +1,162 @@
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include "SD.h"
+
+struct HostFile {
+  std::string path;                   // From the card root, "/a/b.wav"
+  FILE* file = nullptr;
+  DIR* dir = nullptr;
+
+  ~HostFile() {
+    if (file) fclose(file);
+    if (dir) closedir(dir);
+  }
+};
+
+SDFS SD;
+SPIClass SPI;
+
+static std::string root;
+static uint32_t latency_us = 0;
+static uint32_t kbps = 0;
+
+static std::string host_path(const char* path) {
+  return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+// Sleep for what the call would have taken on the card
+static void card_time(size_t bytes) {
+  uint64_t us = latency_us;
+  if (kbps) us += (uint64_t)bytes * 1000000 / 1024 / kbps;
+  if (us) delayMicroseconds(us);
+}
+
+void host_sd_set_speed(uint32_t latency, uint32_t rate) {
+  latency_us = latency;
+  kbps = rate;
+}
+
+/***************************************************************************************
+** Files and directories
+***************************************************************************************/
+
+size_t File::read(uint8_t* buf, size_t len) {
+  if (!impl || !impl->file) return 0;
+  size_t n = fread(buf, 1, len, impl->file);
+  card_time(n);
+  return n;
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+  if (!impl || !impl->file) return 0;
+  card_time(len);
+  return fwrite(buf, 1, len, impl->file);
+}
+
+bool File::seek(uint32_t pos) {
+  return impl && impl->file && fseek(impl->file, pos, SEEK_SET) == 0;
+}
+
+size_t File::position() {
+  return impl && impl->file ? ftell(impl->file) : 0;
+}
+
+size_t File::size() {
+  struct stat st;
+  if (!impl) return 0;
+  if (impl->file) fflush(impl->file);
+  return stat(host_path(impl->path.c_str()).c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+void File::flush() {
+  if (impl && impl->file) fflush(impl->file);
+}
+
+void File::close() {
+  impl.reset();
+}
+
+bool File::isDirectory() {
+  return impl && impl->dir;
+}
+
+File File::openNextFile(const char* mode) {
+  if (!impl || !impl->dir) return File();
+  for (struct dirent* e; (e = readdir(impl->dir));) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+    std::string p = impl->path == "/" ? "/" : impl->path + "/";
+    return SD.open((p + e->d_name).c_str(), mode);
+  }
+  return File();
+}
+
+const char* File::name() {
+  if (!impl) return "";
+  size_t slash = impl->path.rfind('/');
+  return impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+const char* File::path() {
+  return impl ? impl->path.c_str() : "";
+}
+
+time_t File::getLastWrite() {
+  struct stat st;
+  if (!impl) return 0;
+  if (impl->file) fflush(impl->file);
+  return stat(host_path(impl->path.c_str()).c_str(), &st) == 0 ? st.st_mtime : 0;
+}
+
+/***************************************************************************************
+** Card
+***************************************************************************************/
+
+bool SDFS::begin(uint8_t ss, SPIClass& spi, uint32_t frequency, const char* mountpoint, uint8_t max_files) {
+  const char* image = getenv("CYD_SD_IMAGE");
+  root = image && *image ? image : "sd_image";
+  ::mkdir(root.c_str(), 0777);
+  struct stat st;
+  return stat(root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+File SDFS::open(const char* path, const char* mode, bool create) {
+  std::string p = path[0] == '/' ? path : std::string("/") + path;
+  std::string host = host_path(p.c_str());
+  std::shared_ptr<HostFile> f = std::make_shared<HostFile>();
+  f->path = p;
+  struct stat st;
+  if (!strcmp(mode, FILE_READ) && stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    f->dir = opendir(host.c_str());
+    if (!f->dir) return File();
+  } else {
+    f->file = fopen(host.c_str(), !strcmp(mode, FILE_READ) ? "rb" : !strcmp(mode, FILE_APPEND) ? "ab" : "wb");
+    if (!f->file) return File();
+  }
+  card_time(0);
+  return File(f);
+}
+
+bool SDFS::exists(const char* path) {
+  struct stat st;
+  return stat(host_path(path).c_str(), &st) == 0;
+}
+
+bool SDFS::remove(const char* path) {
+  return unlink(host_path(path).c_str()) == 0;
+}
+
+bool SDFS::rename(const char* from, const char* to) {
+  return ::rename(host_path(from).c_str(), host_path(to).c_str()) == 0;
+}
+
+bool SDFS::mkdir(const char* path) {
+  return ::mkdir(host_path(path).c_str(), 0777) == 0;
+}
+
+uint64_t SDFS::cardSize() {
+  struct statvfs vfs;
+  return statvfs(root.c_str(), &vfs) == 0 ? (uint64_t)vfs.f_blocks * vfs.f_frsize : 0;
+}
@@ -0,0 +1,24 @@
+// Host build: the console and telemetry hooks modules call from their init.
+// There is no serial console on the host; tests call the module APIs.
+
+#include "console.h"
+#include "telemetry.h"
+
+bool console_register(const char* name, const char* help, console_handler_t handler) {
+  return true;
+}
+
+bool console_parse_uint(const char* text, uint32_t max, uint32_t* value) {
+  char* end;
+  unsigned long v = strtoul(text, &end, 10);
+  if (end == text || *end || v > max) return false;
+  *value = v;
+  return true;
+}
+
+bool telemetry_register_task(const char* name, TaskHandle_t task) {
+  return true;
+}
+
+void telemetry_unregister_task(TaskHandle_t task) {
+}
@@ -0,0 +1,212 @@
+#include "adpcm.h"
+
+static const int16_t step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t index_table[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static inline uint16_t rd16(const uint8_t* p) { return p[0] | p[1] << 8; }
+static inline uint32_t rd32(const uint8_t* p) { return rd16(p) | (uint32_t)rd16(p + 2) << 16; }
+
+// One nibble into the channel state, returns the new sample
+static inline int16_t expand(AdpcmChannel* ch, uint8_t nib) {
+  int32_t step = step_table[ch->index];
+  int32_t diff = step >> 3;
+  if (nib & 1) diff += step >> 2;
+  if (nib & 2) diff += step >> 1;
+  if (nib & 4) diff += step;
+  int32_t p = ch->predictor + (nib & 8 ? -diff : diff);
+  if (p > 32767) p = 32767;
+  if (p < -32768) p = -32768;
+  ch->predictor = p;
+  int32_t i = ch->index + index_table[nib];
+  ch->index = i < 0 ? 0 : (i > 88 ? 88 : i);
+  return p;
+}
+
+/***************************************************************************************
+** Decoder
+***************************************************************************************/
+
+static bool read_exact(AdpcmDecoder* dec, uint8_t* buf, size_t len) {
+  return dec->read(dec->ctx, buf, len) == len;
+}
+
+// Skip chunk bytes through the block buffer
+static bool skip(AdpcmDecoder* dec, uint32_t len) {
+  while (len) {
+    size_t n = min(len, (uint32_t)ADPCM_MAX_BLOCK);
+    if (!read_exact(dec, dec->block, n)) return false;
+    len -= n;
+  }
+  return true;
+}
+
+static uint32_t source_read(void* ctx, int16_t* out, uint32_t frames) {
+  return adpcm_decode((AdpcmDecoder*)ctx, out, frames);
+}
+
+bool adpcm_open(AdpcmDecoder* dec, adpcm_read_t read, void* ctx) {
+  memset(dec, 0, offsetof(AdpcmDecoder, block));
+  dec->read = read;
+  dec->ctx = ctx;
+
+  uint8_t h[20];
+  if (!read_exact(dec, h, 12) || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return false;
+
+  uint16_t format = 0, bits = 0;
+  for (;;) {
+    if (!read_exact(dec, h, 8)) return false;
+    uint32_t size = rd32(h + 4);
+    if (memcmp(h, "data", 4) == 0) {
+      dec->data_left = size;
+      break;
+    }
+    uint32_t used = 0;
+    if (memcmp(h, "fmt ", 4) == 0) {
+      if (size < 16 || !read_exact(dec, h, 16)) return false;
+      format = rd16(h);
+      dec->channels = rd16(h + 2);
+      dec->sample_rate = rd32(h + 4);
+      dec->block_align = rd16(h + 12);
+      bits = rd16(h + 14);
+      used = 16;
+    }
+    if (!skip(dec, size - used + (size & 1))) return false;  // Chunks are padded to even sizes
+  }
+
+  uint16_t header = 4 * dec->channels;
+  if (format != 0x11 || bits != 4 || dec->channels < 1 || dec->channels > 2) return false;
+  if (dec->block_align <= header || dec->block_align > ADPCM_MAX_BLOCK || dec->block_align % header) return false;
+  dec->samples_per_block = (dec->block_align - header) * 2 / dec->channels + 1;
+
+  uint32_t rest = dec->data_left % dec->block_align;
+  rest -= rest % header;  // As next_block: whole nibble groups only
+  dec->total_frames = dec->data_left / dec->block_align * dec->samples_per_block;
+  if (rest >= header) dec->total_frames += (rest - header) * 2 / dec->channels + 1;
+
+  dec->source.read = source_read;
+  dec->source.ctx = dec;
+  dec->source.sample_rate = dec->sample_rate;
+  return true;
+}
+
+// Load the next compressed block and its header samples
+static bool next_block(AdpcmDecoder* dec) {
+  uint16_t header = 4 * dec->channels;
+  uint32_t len = min(dec->data_left, (uint32_t)dec->block_align);
+  len -= len % header;  // Whole nibble groups only
+  if (len < header) return false;
+  size_t got = dec->read(dec->ctx, dec->block, len);
+  dec->data_left = got < len ? 0 : dec->data_left - len;
+  got -= got % header;
+  if (got < header) return false;
+
+  for (int c = 0; c < dec->channels; c++) {
+    const uint8_t* p = dec->block + c * 4;
+    dec->ch[c].predictor = (int16_t)rd16(p);
+    dec->ch[c].index = p[2] > 88 ? 88 : p[2];
+  }
+  dec->block_frames = (got - header) * 2 / dec->channels + 1;
+  dec->frame = 0;
+  return true;
+}
+
+uint32_t adpcm_decode(AdpcmDecoder* dec, int16_t* out, uint32_t frames) {
+  uint32_t done = 0;
+  while (done < frames) {
+    if (dec->frame >= dec->block_frames && !next_block(dec)) break;
+
+    uint32_t f = dec->frame;
+    uint32_t end = min((uint32_t)dec->block_frames, f + (frames - done));
+    int16_t* o = out + done * 2;
+    done += end - f;
+    dec->frame = end;
+
+    // Header sample first, then nibbles (low one first)
+    if (f == 0) {
+      o[0] = dec->ch[0].predictor;
+      o[1] = dec->ch[dec->channels - 1].predictor;
+      o += 2;
+      f = 1;
+    }
+    if (dec->channels == 1) {
+      const uint8_t* data = dec->block + 4;
+      for (; f < end; f++, o += 2) {
+        uint32_t k = f - 1;
+        uint8_t b = data[k >> 1];
+        o[0] = o[1] = expand(&dec->ch[0], k & 1 ? b >> 4 : b & 15);
+      }
+    } else {
+      // Stereo interleaves 4 bytes (8 nibbles) per channel
+      const uint8_t* data = dec->block + 8;
+      for (; f < end; f++, o += 2) {
+        uint32_t k = f - 1;
+        const uint8_t* g = data + (k >> 3) * 8 + ((k & 7) >> 1);
+        bool hi = k & 1;
+        o[0] = expand(&dec->ch[0], hi ? g[0] >> 4 : g[0] & 15);
+        o[1] = expand(&dec->ch[1], hi ? g[4] >> 4 : g[4] & 15);
+      }
+    }
+  }
+  return done;
+}
+
+const AudioSource* adpcm_source(AdpcmDecoder* dec) {
+  return &dec->source;
+}
+
+uint32_t adpcm_duration_ms(const AdpcmDecoder* dec) {
+  return dec->sample_rate ? (uint64_t)dec->total_frames * 1000 / dec->sample_rate : 0;
+}
+
+/***************************************************************************************
+** Encoder (test signals)
+***************************************************************************************/
+
+static uint8_t encode_sample(AdpcmChannel* ch, int16_t s) {
+  int32_t step = step_table[ch->index];
+  int32_t diff = s - ch->predictor;
+  uint8_t nib = 0;
+  if (diff < 0) {
+    nib = 8;
+    diff = -diff;
+  }
+  if (diff >= step) { nib |= 4; diff -= step; }
+  step >>= 1;
+  if (diff >= step) { nib |= 2; diff -= step; }
+  step >>= 1;
+  if (diff >= step) nib |= 1;
+  expand(ch, nib);  // Track the decoder's reconstruction
+  return nib;
+}
+
+size_t adpcm_encode_block(AdpcmChannel* state, uint16_t channels, const int16_t* pcm,
+                          uint16_t samples_per_block, uint8_t* out) {
+  uint8_t* o = out;
+  for (int c = 0; c < channels; c++) {
+    state[c].predictor = pcm[c];
+    o[0] = pcm[c] & 0xFF;
+    o[1] = (uint16_t)pcm[c] >> 8;
+    o[2] = state[c].index;
+    o[3] = 0;
+    o += 4;
+  }
+  // samples_per_block - 1 must be a multiple of 8
+  for (uint32_t k = 0; k + 1 < samples_per_block; k += 8) {
+    for (int c = 0; c < channels; c++) {
+      for (int j = 0; j < 8; j += 2) {
+        const int16_t* s = pcm + (1 + k + j) * channels + c;
+        uint8_t lo = encode_sample(&state[c], s[0]);
+        uint8_t hi = encode_sample(&state[c], s[channels]);
+        *o++ = lo | hi << 4;
+      }
+    }
+  }
+  return o - out;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "audio.h"
+
+// Compressed input. Returns the bytes read; short only at end of stream.
+typedef size_t (*adpcm_read_t)(void* ctx, uint8_t* buf, size_t len);
+
+struct AdpcmChannel {
+  int32_t predictor;
+  int32_t index;
+};
+
+// Streaming IMA-ADPCM (WAV format 0x11) decoder. Memory is fixed: one
+// compressed block plus the channel state; PCM is decoded straight into
+// the caller's buffer (the audio ring).
+struct AdpcmDecoder {
+  adpcm_read_t read;
+  void* ctx;
+  uint16_t channels;
+  uint16_t block_align;          // Compressed bytes per block
+  uint16_t samples_per_block;    // Frames per block, header sample included
+  uint32_t sample_rate;
+  uint32_t data_left;            // Bytes of the data chunk not read yet
+  uint32_t total_frames;
+  uint16_t block_frames;         // Frames in the current block (last one may be short)
+  uint16_t frame;                // Next frame within the current block
+  AdpcmChannel ch[2];
+  uint8_t block[ADPCM_MAX_BLOCK];
+  AudioSource source;            // Hands the decoder to audio_play
+};
+
+// Parse the WAV header up to the data chunk. False if not mono/stereo
+// IMA-ADPCM or the block does not fit ADPCM_MAX_BLOCK.
+bool adpcm_open(AdpcmDecoder* dec, adpcm_read_t read, void* ctx);
+
+// Decode up to 'frames' interleaved stereo frames (mono is duplicated),
+// returns 0 at the end of the data
+uint32_t adpcm_decode(AdpcmDecoder* dec, int16_t* out, uint32_t frames);
+
+// The decoder as an audio engine source (valid while dec is)
+const AudioSource* adpcm_source(AdpcmDecoder* dec);
+
+uint32_t adpcm_duration_ms(const AdpcmDecoder* dec);
+
+// Encode one block of interleaved PCM (frames = samples_per_block) into
+// WAV IMA-ADPCM layout, for test signals and benchmarks.
+// state carries the predictor between blocks; returns the bytes written.
+size_t adpcm_encode_block(AdpcmChannel* state, uint16_t channels, const int16_t* pcm,
+                          uint16_t samples_per_block, uint8_t* out);
@@ -0,0 +1,242 @@
+#include "analog_clock.h"
+#include "display.h"
+#include "theme.h"
+#include "wallclock.h"
+
+#define DIAL CLOCK_DIAL_SIZE
+#define R (DIAL / 2)
+
+enum { HAND_HOUR, HAND_MINUTE, HAND_SECOND, HANDS };
+
+struct Hand {
+  float angle;              // Radians clockwise from 12
+  float len;
+  float r0, r1;             // Half widths at the centre and the tip
+  uint16_t color;
+};
+
+struct AnalogClock {
+  bool seconds;
+  bool active;
+  bool drawn;               // The panel shows the dial with 'hands'
+  Hand hands[HANDS];
+  lv_timer_t* repaint;      // Paused until LVGL draws over the face
+};
+
+// Shared by all faces, freed with the last one
+static TFT_eSprite* dial = NULL;
+static TFT_eSprite* strip = NULL;
+static uint8_t faces = 0;
+
+static AnalogClockStats stats;
+
+static void free_sprites() {
+  if (dial) dial->deleteSprite();
+  if (strip) strip->deleteSprite();
+  delete dial;
+  delete strip;
+  dial = strip = NULL;
+}
+
+static bool build_dial() {
+  if (dial) return true;
+  TFT_eSPI* tft = display_get_tft();
+  dial = new TFT_eSprite(tft);
+  strip = new TFT_eSprite(tft);
+  dial->setColorDepth(16);
+  strip->setColorDepth(16);
+  if (!dial->createSprite(DIAL, DIAL) || !strip->createSprite(DIAL, CLOCK_STRIP_ROWS)) {
+    free_sprites();
+    return false;
+  }
+
+  uint16_t bg = lv_color_to16(SPOTIFY_BLACK);
+  uint16_t face = lv_color_to16(SPOTIFY_DARK_GREY);
+  uint16_t mark = lv_color_to16(SPOTIFY_LIGHT_GREY);
+  dial->fillSprite(bg);
+  dial->fillSmoothCircle(R, R, R - 1, face, bg);
+  for (int i = 0; i < 60; i++) {
+    float s = sinf(i * 6 * DEG_TO_RAD), c = cosf(i * 6 * DEG_TO_RAD);
+    bool hour = i % 5 == 0;
+    float r_in = hour ? R - 14 : R - 8, r_out = R - 4;
+    float w = hour ? 1.5f : 0.5f;
+    dial->drawWedgeLine(R + s * r_in, R - c * r_in, R + s * r_out, R - c * r_out, w, w, mark, face);
+  }
+  dial->setTextColor(lv_color_to16(SPOTIFY_WHITE), face);
+  dial->setTextDatum(MC_DATUM);
+  for (int h = 1; h <= 12; h++) {
+    float s = sinf(h * 30 * DEG_TO_RAD), c = cosf(h * 30 * DEG_TO_RAD);
+    dial->drawNumber(h, R + s * (R - 26), R - c * (R - 26), 2);
+  }
+  return true;
+}
+
+static void set_hand(Hand* h, float deg, float len, float r0, float r1, lv_color_t color) {
+  h->angle = deg * DEG_TO_RAD;
+  h->len = len;
+  h->r0 = r0;
+  h->r1 = r1;
+  h->color = lv_color_to16(color);
+}
+
+static void set_hands(Hand* hands, const struct tm* now) {
+  // Minute hand steps once a minute, so second ticks only move the second hand
+  set_hand(&hands[HAND_HOUR], (now->tm_hour % 12) * 30 + now->tm_min * 0.5f, R * 0.5f, 3, 2, SPOTIFY_WHITE);
+  set_hand(&hands[HAND_MINUTE], now->tm_min * 6, R * 0.75f, 2, 1.5f, SPOTIFY_WHITE);
+  set_hand(&hands[HAND_SECOND], now->tm_sec * 6, R * 0.85f, 1, 0.75f, SPOTIFY_GREEN);
+}
+
+// Dial pixels a hand can touch, anti-aliased edge included
+static void hand_box(const Hand* h, lv_area_t* box) {
+  float tx = R + sinf(h->angle) * h->len, ty = R - cosf(h->angle) * h->len;
+  float m = max(h->r0, h->r1) + 2;
+  box->x1 = max((int32_t)floorf(min((float)R, tx) - m), (int32_t)0);
+  box->y1 = max((int32_t)floorf(min((float)R, ty) - m), (int32_t)0);
+  box->x2 = min((int32_t)ceilf(max((float)R, tx) + m), (int32_t)DIAL - 1);
+  box->y2 = min((int32_t)ceilf(max((float)R, ty) + m), (int32_t)DIAL - 1);
+}
+
+// Rebuild one area of the face a strip at a time: dial, then every hand
+// over it, then push the strip to the panel at (ox, oy)
+static void compose(AnalogClock* c, const lv_area_t* a, int32_t ox, int32_t oy) {
+  int32_t w = lv_area_get_width(a);
+  const uint16_t* src = (const uint16_t*)dial->getPointer();
+  uint16_t* dst = (uint16_t*)strip->getPointer();
+  uint8_t count = c->seconds ? HANDS : HAND_SECOND;
+
+  for (int32_t y0 = a->y1; y0 <= a->y2; y0 += CLOCK_STRIP_ROWS) {
+    int32_t rows = min((int32_t)CLOCK_STRIP_ROWS, a->y2 + 1 - y0);
+    for (int32_t r = 0; r < rows; r++) memcpy(dst + r * DIAL, src + (y0 + r) * DIAL + a->x1, w * 2);
+
+    // Strip coordinates; the sprite clips, columns past w are never pushed
+    float cx = R - a->x1, cy = R - y0;
+    for (uint8_t i = 0; i < count; i++) {
+      const Hand* h = &c->hands[i];
+      strip->drawWedgeLine(cx, cy, cx + sinf(h->angle) * h->len, cy - cosf(h->angle) * h->len,
+                           h->r0, h->r1, h->color);
+    }
+    strip->fillSmoothCircle(cx, cy, 4, lv_color_to16(SPOTIFY_GREEN));
+    strip->pushSprite(ox + a->x1, oy + y0, 0, 0, w, rows);
+  }
+  display_invalidate_tiles(ox + a->x1, oy + a->y1, w, lv_area_get_height(a));
+  stats.px_last += w * lv_area_get_height(a);
+}
+
+void analog_clock_draw(lv_obj_t* obj, const struct tm* now, bool full) {
+  AnalogClock* c = (AnalogClock*)lv_obj_get_user_data(obj);
+  lv_area_t coords;
+  lv_obj_get_content_coords(obj, &coords);
+
+  uint32_t t = micros();
+  stats.px_last = 0;
+  Hand next[HANDS];
+  set_hands(next, now);
+
+  if (full || !c->drawn) {
+    memcpy(c->hands, next, sizeof(next));
+    lv_area_t all = { 0, 0, DIAL - 1, DIAL - 1 };
+    compose(c, &all, coords.x1, coords.y1);
+  } else {
+    // Old and new box of each hand that moved; all hands are drawn in each
+    lv_area_t dirty[HANDS];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < (c->seconds ? HANDS : HAND_SECOND); i++) {
+      if (next[i].angle == c->hands[i].angle) continue;
+      lv_area_t old_box, new_box;
+      hand_box(&c->hands[i], &old_box);
+      hand_box(&next[i], &new_box);
+      _lv_area_join(&dirty[n], &old_box, &new_box);
+      // Hour and minute boxes overlap around the centre: one pass for both
+      if (n > 0 && _lv_area_is_on(&dirty[n - 1], &dirty[n])) _lv_area_join(&dirty[n - 1], &dirty[n - 1], &dirty[n]);
+      else n++;
+    }
+    memcpy(c->hands, next, sizeof(next));
+    for (uint8_t i = 0; i < n; i++) compose(c, &dirty[i], coords.x1, coords.y1);
+  }
+  c->drawn = true;
+
+  t = micros() - t;
+  if (t > stats.draw_max_us) stats.draw_max_us = t;
+  stats.ticks++;
+  stats.px_sum += stats.px_last;
+}
+
+static void tick_cb(const struct tm* now, uint8_t changed, void* user_data) {
+  lv_obj_t* obj = (lv_obj_t*)user_data;
+  if (lv_obj_get_screen(obj) != lv_scr_act() || !lv_obj_is_visible(obj)) return;
+  analog_clock_draw(obj, now, false);
+}
+
+// After LVGL painted the placeholder and flushed it
+static void repaint_cb(lv_timer_t* timer) {
+  lv_timer_pause(timer);
+  lv_obj_t* obj = (lv_obj_t*)timer->user_data;
+  AnalogClock* c = (AnalogClock*)lv_obj_get_user_data(obj);
+  if (!c->active || lv_obj_get_screen(obj) != lv_scr_act()) return;
+  struct tm now;
+  wallclock_now(&now);
+  analog_clock_draw(obj, &now, true);
+}
+
+static void event_cb(lv_event_t* e) {
+  lv_obj_t* obj = lv_event_get_target(e);
+  AnalogClock* c = (AnalogClock*)lv_obj_get_user_data(obj);
+  lv_event_code_t code = lv_event_get_code(e);
+
+  if (code == LV_EVENT_DRAW_MAIN) {
+    c->drawn = false;
+    lv_timer_resume(c->repaint);
+    lv_timer_ready(c->repaint);
+  } else if (code == LV_EVENT_DELETE) {
+    analog_clock_set_active(obj, false);
+    lv_timer_del(c->repaint);
+    lv_mem_free(c);
+    if (--faces == 0) free_sprites();
+  }
+}
+
+lv_obj_t* analog_clock_create(lv_obj_t* parent, bool seconds) {
+  if (!build_dial()) return NULL;
+  faces++;
+
+  lv_obj_t* obj = lv_obj_create(parent);
+  lv_obj_remove_style_all(obj);
+  lv_obj_set_size(obj, DIAL, DIAL);
+  lv_obj_set_style_bg_color(obj, SPOTIFY_BLACK, 0);
+  lv_obj_set_style_bg_opa(obj, LV_OPA_COVER, 0);
+  lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+
+  AnalogClock* c = (AnalogClock*)lv_mem_alloc(sizeof(AnalogClock));
+  memset(c, 0, sizeof(*c));
+  c->seconds = seconds;
+  c->repaint = lv_timer_create(repaint_cb, 0, obj);
+  lv_timer_pause(c->repaint);
+  lv_obj_set_user_data(obj, c);
+  lv_obj_add_event_cb(obj, event_cb, LV_EVENT_ALL, NULL);
+
+  analog_clock_set_active(obj, true);
+  stats.full_px = DIAL * DIAL;
+  return obj;
+}
+
+void analog_clock_set_active(lv_obj_t* obj, bool active) {
+  AnalogClock* c = (AnalogClock*)lv_obj_get_user_data(obj);
+  if (c->active == active) return;
+  c->active = active;
+  if (active) {
+    c->drawn = false;  // Hands moved while inactive
+    lv_timer_resume(c->repaint);
+    wallclock_subscribe(c->seconds ? WALLCLOCK_SECOND : WALLCLOCK_MINUTE, tick_cb, obj);
+  } else {
+    wallclock_unsubscribe(tick_cb, obj);
+  }
+}
+
+void analog_clock_get_stats(AnalogClockStats* out, bool reset) {
+  *out = stats;
+  if (reset) {
+    stats.ticks = 0;
+    stats.px_sum = 0;
+    stats.draw_max_us = 0;
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <lvgl.h>
+#include <time.h>
+#include "config.h"
+
+struct AnalogClockStats {
+  uint32_t ticks;           // Hand updates
+  uint32_t px_last;         // Pixels pushed by the last update
+  uint32_t px_sum;
+  uint32_t full_px;         // Pixels of a full dial redraw
+  uint32_t draw_max_us;
+};
+
+// Analog clock face, CLOCK_DIAL_SIZE square. The static dial (face, ticks,
+// numerals) is rendered once into a sprite shared by all faces. A tick
+// rebuilds only the boxes around the old and new position of each hand
+// that moved, in strips: dial pixels copied from the sprite, hands drawn
+// over them, pushed straight to the panel. The object is a placeholder;
+// LVGL redrawing it triggers a full repaint. Nothing may overlap it.
+// Returns NULL when the dial sprite does not fit in the heap.
+lv_obj_t* analog_clock_create(lv_obj_t* parent, bool seconds);
+
+// Inactive faces are not subscribed to wallclock ticks
+void analog_clock_set_active(lv_obj_t* face, bool active);
+
+// Move the hands to 'now' (the tick handler; exposed for benchmarks)
+void analog_clock_draw(lv_obj_t* face, const struct tm* now, bool full);
+
+void analog_clock_get_stats(AnalogClockStats* stats, bool reset);
@@ -0,0 +1,138 @@
+#include "app_manager.h"
+#include "console.h"
+
+struct App {
+  const AppDesc* desc;
+  lv_obj_t* scr;
+  uint32_t last_used;   // Switch counter when it last left the display
+  AppStats stats;
+};
+
+static App apps[APP_MAX_APPS];
+static uint8_t app_count = 0;
+static int current = -1;
+static uint32_t switch_count = 0;
+
+static const char* state_names[] = { "unbuilt", "active", "cached" };
+
+static uint32_t pool_free() {
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  return mon.free_size;
+}
+
+static void teardown(int id) {
+  App& app = apps[id];
+  if (app.desc->destroy) app.desc->destroy();
+  lv_obj_del(app.scr);
+  app.scr = NULL;
+  app.stats.state = APP_UNBUILT;
+}
+
+// Tear down cached screens, least recently used first, until they fit the
+// budget and 'need' bytes (plus the reserve) are free in the pool
+static void enforce_budget(uint32_t need) {
+  for (;;) {
+    uint32_t cached = 0;
+    int lru = -1;
+    for (int i = 0; i < app_count; i++) {
+      if (apps[i].stats.state != APP_CACHED) continue;
+      cached += apps[i].stats.pool_bytes;
+      if (lru < 0 || apps[i].last_used < apps[lru].last_used) lru = i;
+    }
+    if (lru < 0) return;
+    if (cached <= APP_CACHE_BUDGET && pool_free() >= need + APP_POOL_RESERVE) return;
+    teardown(lru);
+  }
+}
+
+int app_register(const AppDesc* desc) {
+  if (app_count >= APP_MAX_APPS || !desc->create) return -1;
+  App& app = apps[app_count];
+  memset(&app, 0, sizeof(app));
+  app.desc = desc;
+  app.stats.state = APP_UNBUILT;
+  return app_count++;
+}
+
+bool app_switch(int id) {
+  if (id < 0 || id >= app_count) return false;
+  if (id == current) return true;
+
+  uint32_t t = micros();
+  App& app = apps[id];
+  bool resumed = app.scr != NULL;
+
+  if (!resumed) {
+    // The size measured on the last build is the best estimate of what it needs
+    enforce_budget(app.stats.pool_bytes);
+    uint32_t before = pool_free();
+    app.scr = lv_obj_create(NULL);
+    app.desc->create(app.scr);
+    uint32_t after = pool_free();
+    app.stats.pool_bytes = before > after ? before - after : 0;
+    app.stats.builds++;
+  }
+
+  lv_obj_t* old = lv_scr_act();
+  lv_scr_load(app.scr);
+  if (current >= 0) {
+    App& prev = apps[current];
+    if (prev.desc->suspend) prev.desc->suspend();
+    prev.stats.state = APP_CACHED;
+    prev.last_used = ++switch_count;
+  } else if (old != app.scr) {
+    lv_obj_del(old);  // The display's initial screen, owned by no app
+  }
+  current = id;
+  app.stats.state = APP_ACTIVE;
+  if (resumed && app.desc->resume) app.desc->resume();
+
+  // The screen just left may now push the cache over budget
+  enforce_budget(0);
+
+  // Latency covers construction and the first full frame
+  lv_refr_now(NULL);
+  app.stats.switch_us = micros() - t;
+  if (app.stats.switch_us > app.stats.switch_max_us) app.stats.switch_max_us = app.stats.switch_us;
+  return true;
+}
+
+bool app_switch_name(const char* name) {
+  for (int i = 0; i < app_count; i++) {
+    if (strcmp(apps[i].desc->name, name) == 0) return app_switch(i);
+  }
+  return false;
+}
+
+int app_current() {
+  return current;
+}
+
+bool app_get_stats(int id, AppStats* stats) {
+  if (id < 0 || id >= app_count) return false;
+  *stats = apps[id].stats;
+  return true;
+}
+
+void app_print() {
+  for (int i = 0; i < app_count; i++) {
+    const AppStats* s = &apps[i].stats;
+    Serial.printf("APP,%s,state=%s,pool=%u,builds=%u,switch_us=%u,switch_max_us=%u\n",
+                  apps[i].desc->name, state_names[s->state], s->pool_bytes, s->builds,
+                  s->switch_us, s->switch_max_us);
+  }
+  Serial.printf("APP,total,lv_free=%u,cache_budget=%u\n", pool_free(), APP_CACHE_BUDGET);
+}
+
+static void cmd_app(int argc, char** argv) {
+  if (argc > 1 && !app_switch_name(argv[1])) {
+    Serial.println("usage: app [name]");
+    return;
+  }
+  app_print();
+}
+
+void app_manager_init() {
+  console_register("app", "[name] switch app, print per-app memory and switch time", cmd_app);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <lvgl.h>
+#include "config.h"
+
+// An app owns one screen. Only create is required; the screen itself is
+// deleted by the manager, destroy just drops the app's pointers into it.
+struct AppDesc {
+  const char* name;
+  void (*create)(lv_obj_t* scr);  // Build the widgets on a fresh screen
+  void (*destroy)();              // Screen is about to be deleted
+  void (*suspend)();              // Another app takes the display (stop timers)
+  void (*resume)();               // Back on the display with the cached screen
+};
+
+enum AppState {
+  APP_UNBUILT,    // Never built, or torn down to stay within the budget
+  APP_ACTIVE,     // On the display
+  APP_CACHED      // Suspended, screen kept in the LVGL pool
+};
+
+// Per-app statistics
+struct AppStats {
+  AppState state;
+  uint32_t pool_bytes;      // LVGL pool taken by the screen when it was built
+  uint32_t builds;          // Times the screen was constructed
+  uint32_t switch_us;       // Last switch to this app, including the first full refresh
+  uint32_t switch_max_us;   // Slowest switch to this app
+};
+
+// Register an app (desc must stay valid). Returns its id, or -1 when full.
+int app_register(const AppDesc* desc);
+
+// Show an app, building its screen on first use. Inactive screens are
+// cached until they exceed APP_CACHE_BUDGET or the pool runs low.
+bool app_switch(int id);
+bool app_switch_name(const char* name);
+int app_current();
+
+bool app_get_stats(int id, AppStats* stats);
+
+// Print one APP line per registered app
+void app_print();
+
+// Register the 'app' console command
+void app_manager_init();
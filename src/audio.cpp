@@ -0,0 +1,555 @@
+#include <atomic>
+#ifndef CYD_HOST
+#include <driver/i2s.h>
+#endif
+#include "audio.h"
+#include "console.h"
+#include "telemetry.h"
+
+// Ring of interleaved stereo frames. The feeder task is the only writer of
+// ring_head and the output task the only writer of ring_tail.
+static_assert((AUDIO_RING_FRAMES & (AUDIO_RING_FRAMES - 1)) == 0, "AUDIO_RING_FRAMES must be a power of two");
+static int16_t ring[AUDIO_RING_FRAMES * 2];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+
+// Mono copy of what the output task sent, for visualizers. Readers race the
+// writer, which at worst tears a window that is about to scroll by anyway.
+static_assert((AUDIO_TAP_FRAMES & (AUDIO_TAP_FRAMES - 1)) == 0, "AUDIO_TAP_FRAMES must be a power of two");
+static int16_t tap[AUDIO_TAP_FRAMES];
+static std::atomic<uint32_t> tap_head(0);
+
+// Transport. source is guarded by source_lock, which the feeder holds while reading.
+static SemaphoreHandle_t source_lock = NULL;
+static const AudioSource* source = NULL;
+static std::atomic<bool> source_done(false);
+static std::atomic<bool> flush_req(false);     // Output drops queued frames and applies the new rate
+static std::atomic<bool> ended(false);         // Output drained a finished source
+static bool primed = false;                    // Output: a full block went out since the flush
+static std::atomic<uint8_t> state(AUDIO_STOPPED);
+static std::atomic<uint8_t> volume(192);
+static uint32_t pending_rate = AUDIO_SAMPLE_RATE;
+static uint32_t current_rate = AUDIO_SAMPLE_RATE;
+
+// Gapless transitions. next_source and the preroll are guarded by
+// source_lock; the preroll holds the first frames of preroll_src, decoded
+// while the ring was full. The feeder publishes a splice (ring position
+// and rate of the next source's first frame) before releasing its frames.
+static const AudioSource* next_source = NULL;
+static const AudioSource* preroll_src = NULL;
+static int16_t preroll[AUDIO_PREROLL_FRAMES * 2];
+static uint32_t preroll_len = 0;
+static uint32_t preroll_pos = 0;
+static bool preroll_eof = false;               // preroll_src ended within the preroll
+static uint32_t end_us;                        // Feeder: when the current source ended
+static std::atomic<bool> splice_pending(false);
+static uint32_t splice_at;
+static uint32_t splice_rate;
+static uint32_t splice_preroll;
+static uint32_t splice_us;
+static std::atomic<bool> gap_open(false);      // A source ended, the next has not been heard yet
+static uint32_t gap_frames;                    // Output: silence sent while gap_open
+static AudioTransition transition;             // Written by the output task
+
+static TaskHandle_t feeder_task = NULL;  // NULL on the host, where nothing waits on it
+#ifndef CYD_HOST
+static TaskHandle_t output_task = NULL;
+#endif
+
+static AudioStats stats;
+
+// I2S block, also the DAC format conversion buffer
+static int16_t out_buf[AUDIO_DMA_FRAMES * 2];
+
+static void preroll_reset() {
+  preroll_src = NULL;
+  preroll_len = preroll_pos = 0;
+  preroll_eof = false;
+}
+
+// Decode the start of the next source while the ring is full, so the
+// transition does not wait on its first (slowest) reads
+static void preroll_next() {
+  if (!next_source || preroll_src == next_source || preroll_pos < preroll_len) return;
+  preroll_reset();
+  preroll_src = next_source;
+  while (preroll_len < AUDIO_PREROLL_FRAMES) {
+    uint32_t got = next_source->read(next_source->ctx, &preroll[preroll_len * 2],
+                                     min((uint32_t)AUDIO_FEED_FRAMES, AUDIO_PREROLL_FRAMES - preroll_len));
+    if (got == 0) {
+      preroll_eof = true;
+      break;
+    }
+    preroll_len += got;
+  }
+}
+
+// Read from the current source, draining its preroll first
+static uint32_t read_source(int16_t* out, uint32_t frames) {
+  if (preroll_src == source) {
+    if (preroll_pos < preroll_len) {
+      uint32_t n = min(frames, preroll_len - preroll_pos);
+      memcpy(out, &preroll[preroll_pos * 2], n * 2 * sizeof(int16_t));
+      preroll_pos += n;
+      return n;
+    }
+    bool eof = preroll_eof;
+    preroll_reset();
+    if (eof) return 0;
+  }
+  return source->read(source->ctx, out, frames);
+}
+
+// Continue with next_source; its first frame goes to ring position 'at',
+// right after the last frame of the source that ended
+static void splice(uint32_t at) {
+  source = next_source;
+  next_source = NULL;
+  source_done = false;
+  splice_at = at;
+  splice_rate = source->sample_rate;
+  splice_preroll = preroll_src == source ? preroll_len : 0;
+  splice_us = micros() - end_us;
+  splice_pending.store(true, std::memory_order_release);
+}
+
+// Top up the ring from the source, until it is full or the source ends
+static void feed() {
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  // Queued after the current source had already ended, or it ended
+  // before the previous transition was heard
+  if (source && source_done && next_source && !splice_pending && !flush_req) {
+    splice(ring_head.load(std::memory_order_relaxed));
+  }
+
+  while (source && !source_done && !flush_req) {
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    uint32_t space = AUDIO_RING_FRAMES - (head - ring_tail.load(std::memory_order_acquire));
+    if (space < AUDIO_FEED_FRAMES) {
+      preroll_next();
+      break;
+    }
+
+    // Contiguous part only, the next pass continues after the wrap
+    uint32_t idx = head & (AUDIO_RING_FRAMES - 1);
+    uint32_t n = min((uint32_t)AUDIO_FEED_FRAMES, (uint32_t)AUDIO_RING_FRAMES - idx);
+    uint32_t t = micros();
+    uint32_t got = read_source(&ring[idx * 2], n);
+    t = micros() - t;
+    if (t > stats.source_max_us) stats.source_max_us = t;
+
+    if (got == 0) {
+      end_us = micros();
+      gap_open = true;
+      if (next_source && !splice_pending) {
+        splice(head);
+        continue;
+      }
+      source_done = true;
+      break;
+    }
+    ring_head.store(head + got, std::memory_order_release);
+  }
+  xSemaphoreGive(source_lock);
+}
+
+// Copy up to max_frames frames out of the ring, returns the count
+static uint32_t take_frames(uint32_t max_frames) {
+  uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+  uint32_t fill = ring_head.load(std::memory_order_acquire) - tail;
+  if (fill < stats.ring_min) stats.ring_min = fill;
+
+  uint32_t n = min(fill, max_frames);
+  int32_t vol = volume;
+  uint32_t th = tap_head.load(std::memory_order_relaxed);
+  for (uint32_t i = 0; i < n; i++) {
+    const int16_t* f = &ring[((tail + i) & (AUDIO_RING_FRAMES - 1)) * 2];
+    tap[(th + i) & (AUDIO_TAP_FRAMES - 1)] = (int16_t)(((int32_t)f[0] + f[1]) >> 1);
+#if AUDIO_OUTPUT_DAC
+    // One speaker: mix down, and the DAC takes unsigned samples (top 8 bits)
+    int32_t s = (((int32_t)f[0] + f[1]) * vol) >> 9;
+    out_buf[i * 2] = out_buf[i * 2 + 1] = (int16_t)(s ^ 0x8000);
+#else
+    out_buf[i * 2] = (int16_t)((f[0] * vol) >> 8);
+    out_buf[i * 2 + 1] = (int16_t)((f[1] * vol) >> 8);
+#endif
+  }
+  tap_head.store(th + n, std::memory_order_release);
+  ring_tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+/***************************************************************************************
+** Output sink: I2S on the device, a WAV file on the host
+***************************************************************************************/
+
+#ifndef CYD_HOST
+static void sink_set_rate(uint32_t rate) {
+  i2s_set_sample_rates(AUDIO_I2S_PORT, rate);
+}
+
+// Blocks until a DMA buffer is free, which paces the output task
+static void sink_write(const int16_t* frames, uint32_t count) {
+  size_t written;
+  i2s_write(AUDIO_I2S_PORT, frames, count * 2 * sizeof(int16_t), &written, portMAX_DELAY);
+}
+
+static void i2s_init() {
+  i2s_config_t cfg = {};
+#if AUDIO_OUTPUT_DAC
+  cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN);
+  cfg.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+#else
+  cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+  cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+#endif
+  cfg.sample_rate = current_rate;
+  cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  cfg.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+  cfg.dma_buf_count = AUDIO_DMA_BUFS;
+  cfg.dma_buf_len = AUDIO_DMA_FRAMES;
+  cfg.tx_desc_auto_clear = true;  // Silence instead of a repeated buffer if the task stalls
+  i2s_driver_install(AUDIO_I2S_PORT, &cfg, 0, NULL);
+
+#if AUDIO_OUTPUT_DAC
+  i2s_set_pin(AUDIO_I2S_PORT, NULL);
+  i2s_set_dac_mode(I2S_DAC_CHANNEL_LEFT_EN);  // DAC2 = GPIO26, the speaker header
+#else
+  i2s_pin_config_t pins = {};
+  pins.bck_io_num = AUDIO_I2S_BCK;
+  pins.ws_io_num = AUDIO_I2S_WS;
+  pins.data_out_num = AUDIO_I2S_DOUT;
+  pins.data_in_num = I2S_PIN_NO_CHANGE;
+  i2s_set_pin(AUDIO_I2S_PORT, &pins);
+#endif
+}
+#else
+static FILE* wav = NULL;
+static uint32_t wav_frames = 0;
+static uint32_t wav_rate = 0;
+
+static void put_le(uint8_t* p, uint32_t v, int bytes) {
+  for (int i = 0; i < bytes; i++) p[i] = v >> (i * 8);
+}
+
+// 16-bit stereo PCM header for 'frames' frames
+static void wav_header(uint32_t frames) {
+  uint8_t h[44];
+  uint32_t data = frames * 4;
+  memcpy(h, "RIFF", 4);
+  put_le(h + 4, 36 + data, 4);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put_le(h + 16, 16, 4);
+  put_le(h + 20, 1, 2);
+  put_le(h + 22, 2, 2);
+  put_le(h + 24, wav_rate, 4);
+  put_le(h + 28, wav_rate * 4, 4);
+  put_le(h + 32, 4, 2);
+  put_le(h + 34, 16, 2);
+  memcpy(h + 36, "data", 4);
+  put_le(h + 40, data, 4);
+  fseek(wav, 0, SEEK_SET);
+  fwrite(h, 1, sizeof(h), wav);
+  fseek(wav, 0, SEEK_END);
+}
+
+// A WAV file has one rate: the file keeps the one of its first block, later
+// changes only show in the transition statistics
+static void sink_set_rate(uint32_t rate) {
+}
+
+static void sink_write(const int16_t* frames, uint32_t count) {
+  if (!wav_rate) wav_rate = current_rate;
+#if AUDIO_OUTPUT_DAC
+  // Back from the DAC's unsigned format to signed PCM
+  int16_t pcm[AUDIO_DMA_FRAMES * 2];
+  for (uint32_t i = 0; i < count * 2; i++) pcm[i] = frames[i] ^ 0x8000;
+  frames = pcm;
+#endif
+  if (wav) wav_frames += fwrite(frames, 4, count, wav);
+}
+#endif
+
+/***************************************************************************************
+** Output
+***************************************************************************************/
+
+// Send one AUDIO_DMA_FRAMES block, padded with silence
+static void output_block() {
+  if (flush_req) {
+    ring_tail.store(ring_head.load(std::memory_order_acquire), std::memory_order_release);
+    if (pending_rate != current_rate) {
+      current_rate = pending_rate;
+      sink_set_rate(current_rate);
+    }
+    stats.frames_out = 0;
+    ended = false;
+    primed = false;
+    splice_pending = false;
+    gap_open = false;
+    gap_frames = 0;
+    flush_req = false;
+    xTaskNotifyGive(feeder_task);
+  }
+
+  // A source at another rate: stop the block at the splice, then switch
+  uint32_t max_frames = AUDIO_DMA_FRAMES;
+  bool pending = splice_pending.load(std::memory_order_acquire);
+  if (pending) {
+    ended = false;
+    uint32_t before = splice_at - ring_tail.load(std::memory_order_relaxed);
+    if (splice_rate != current_rate) {
+      if (before == 0) {
+        current_rate = splice_rate;
+        sink_set_rate(current_rate);
+      } else {
+        max_frames = min(max_frames, before);
+      }
+    }
+  }
+
+  uint32_t n = 0;
+  if (state == AUDIO_PLAYING && !ended) {
+    n = take_frames(max_frames);
+    stats.frames_out += n;
+    if (n == max_frames) {
+      primed = true;
+    } else if (!source_done) {
+      // The output outranks the feeder, so the first block after a flush
+      // always finds the ring empty: not an underrun
+      if (primed) stats.underruns++;
+    } else if (n == 0) {
+      ended = true;
+    }
+    xTaskNotifyGive(feeder_task);
+  }
+
+  if (pending && (int32_t)(ring_tail.load(std::memory_order_relaxed) - splice_at) > 0) {
+    // First frames of the next source went out: the transition is complete
+    transition.preroll_frames = splice_preroll;
+    transition.splice_us = splice_us;
+    transition.gap_frames = gap_frames;
+    transition.sample_rate = splice_rate;
+    transition.seq++;
+    stats.frames_out = ring_tail.load(std::memory_order_relaxed) - splice_at;
+    gap_frames = 0;
+    gap_open = false;
+    splice_pending = false;
+  } else if (gap_open && state == AUDIO_PLAYING) {
+    gap_frames += AUDIO_DMA_FRAMES - n;
+  }
+
+#if AUDIO_OUTPUT_DAC
+  const int16_t silence = (int16_t)0x8000;
+#else
+  const int16_t silence = 0;
+#endif
+  for (uint32_t i = n * 2; i < AUDIO_DMA_FRAMES * 2; i++) out_buf[i] = silence;
+  sink_write(out_buf, AUDIO_DMA_FRAMES);
+}
+
+#ifndef CYD_HOST
+static void feeder_loop(void* arg) {
+  for (;;) {
+    // Woken by the output task after each block, polls in case a wake is lost
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    feed();
+  }
+}
+
+static void output_loop(void* arg) {
+  for (;;) output_block();
+}
+#else
+bool audio_host_render(const char* path, uint32_t frames, uint32_t feed_every) {
+  wav = fopen(path, "wb");
+  if (!wav) return false;
+  wav_frames = 0;
+  wav_rate = 0;
+  wav_header(0);
+  for (uint32_t b = 0; b * AUDIO_DMA_FRAMES < frames; b++) {
+    output_block();  // First, as the output task outranks the feeder
+    if (feed_every && b % feed_every == 0) feed();
+  }
+  wav_header(wav_frames);
+  bool ok = ferror(wav) == 0;
+  fclose(wav);
+  wav = NULL;
+  return ok;
+}
+#endif
+
+void audio_play(const AudioSource* src) {
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  source = src;
+  source_done = false;
+  next_source = NULL;
+  preroll_reset();
+  pending_rate = src->sample_rate;
+  flush_req = true;
+  state = AUDIO_PLAYING;
+  xSemaphoreGive(source_lock);
+  xTaskNotifyGive(feeder_task);
+}
+
+void audio_queue(const AudioSource* next) {
+  if (!source) {
+    audio_play(next);
+    return;
+  }
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  next_source = next;
+  if (preroll_src != source) preroll_reset();  // Drop the preroll of a previously queued source
+  xSemaphoreGive(source_lock);
+  xTaskNotifyGive(feeder_task);
+}
+
+uint32_t audio_get_transition(AudioTransition* out) {
+  *out = transition;
+  return out->seq;
+}
+
+void audio_pause() {
+  if (state == AUDIO_PLAYING) state = AUDIO_PAUSED;
+}
+
+void audio_resume() {
+  if (state == AUDIO_PAUSED) state = AUDIO_PLAYING;
+}
+
+void audio_stop() {
+  xSemaphoreTake(source_lock, portMAX_DELAY);
+  source = NULL;
+  next_source = NULL;
+  preroll_reset();
+  flush_req = true;
+  state = AUDIO_STOPPED;
+  xSemaphoreGive(source_lock);
+}
+
+void audio_set_volume(uint8_t v) {
+  volume = v;
+}
+
+uint8_t audio_get_volume() {
+  return volume;
+}
+
+AudioState audio_get_state() {
+  if (state == AUDIO_PLAYING && ended) return AUDIO_STOPPED;
+  return (AudioState)(uint8_t)state;
+}
+
+uint32_t audio_get_position_ms() {
+  return (uint32_t)((uint64_t)stats.frames_out * 1000 / current_rate);
+}
+
+void audio_get_stats(AudioStats* out, bool reset) {
+  *out = stats;
+  out->ring_fill = ring_head.load() - ring_tail.load();
+  if (reset) {
+    stats.underruns = 0;
+    stats.ring_min = UINT32_MAX;
+    stats.source_max_us = 0;
+  }
+}
+
+bool audio_read_tap(int16_t* out, uint32_t n, uint32_t decimate) {
+  if (state != AUDIO_PLAYING || n * decimate > AUDIO_TAP_FRAMES) return false;
+  uint32_t i = tap_head.load(std::memory_order_acquire) - n * decimate;
+  for (uint32_t k = 0; k < n; k++) {
+    int32_t sum = 0;
+    for (uint32_t d = 0; d < decimate; d++, i++) sum += tap[i & (AUDIO_TAP_FRAMES - 1)];
+    out[k] = (int16_t)(sum / (int32_t)decimate);
+  }
+  return true;
+}
+
+/***************************************************************************************
+** Sine test source
+***************************************************************************************/
+
+struct ToneState {
+  uint32_t phase;
+  uint32_t step;    // 16.16 fixed point table steps per sample
+};
+
+static int16_t sine_table[256];
+static ToneState tone;
+static AudioSource tone_source;
+
+static uint32_t tone_read(void* ctx, int16_t* out, uint32_t frames) {
+  ToneState* t = (ToneState*)ctx;
+  for (uint32_t i = 0; i < frames; i++) {
+    int16_t s = sine_table[(t->phase >> 16) & 255];
+    out[i * 2] = out[i * 2 + 1] = s;
+    t->phase += t->step;
+  }
+  return frames;
+}
+
+const AudioSource* audio_tone_source(uint32_t hz) {
+  if (sine_table[64] == 0) {
+    for (int i = 0; i < 256; i++) sine_table[i] = (int16_t)(sinf(i * 2 * PI / 256) * 12000);
+  }
+  tone.phase = 0;
+  tone.step = (uint32_t)(((uint64_t)hz * 256 << 16) / AUDIO_SAMPLE_RATE);
+  tone_source.read = tone_read;
+  tone_source.ctx = &tone;
+  tone_source.sample_rate = AUDIO_SAMPLE_RATE;
+  return &tone_source;
+}
+
+/***************************************************************************************
+** Console
+***************************************************************************************/
+
+static const char* state_names[] = { "stopped", "playing", "paused" };
+
+static void cmd_audio(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 2 && strcmp(argv[1], "tone") == 0 && console_parse_uint(argv[2], AUDIO_SAMPLE_RATE / 2, &value)) {
+    audio_stop();
+    audio_play(audio_tone_source(value));
+  } else if (argc > 2 && strcmp(argv[1], "vol") == 0 && console_parse_uint(argv[2], 255, &value)) {
+    audio_set_volume(value);
+  } else if (argc > 1 && strcmp(argv[1], "pause") == 0) {
+    audio_pause();
+  } else if (argc > 1 && strcmp(argv[1], "resume") == 0) {
+    audio_resume();
+  } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+    audio_stop();
+  } else if (argc > 1) {
+    Serial.println("usage: audio [tone <hz>|vol <0-255>|pause|resume|stop]");
+    return;
+  }
+
+  AudioStats s;
+  audio_get_stats(&s, false);
+  Serial.printf("AUDIO,state=%s,rate=%u,vol=%u,pos_ms=%u,ring_fill=%u,ring_min=%u,underruns=%u,src_max_us=%u\n",
+                state_names[audio_get_state()], current_rate, audio_get_volume(), audio_get_position_ms(),
+                s.ring_fill, s.ring_min == UINT32_MAX ? 0 : s.ring_min, s.underruns, s.source_max_us);
+  AudioTransition t;
+  if (audio_get_transition(&t)) {
+    Serial.printf("AUDIO,transitions=%u,last_gap_frames=%u,last_preroll=%u,last_splice_us=%u\n",
+                  t.seq, t.gap_frames, t.preroll_frames, t.splice_us);
+  }
+}
+
+void audio_init() {
+  stats.ring_min = UINT32_MAX;
+  source_lock = xSemaphoreCreateMutex();
+#ifndef CYD_HOST
+  i2s_init();
+
+  // Output first: it must outrank the feeder so a slow source cannot starve the DMA
+  xTaskCreatePinnedToCore(output_loop, "audio_out", AUDIO_TASK_STACK, NULL, AUDIO_TASK_PRIORITY + 1,
+                          &output_task, AUDIO_CORE);
+  xTaskCreatePinnedToCore(feeder_loop, "audio_feed", AUDIO_TASK_STACK, NULL, AUDIO_TASK_PRIORITY,
+                          &feeder_task, AUDIO_CORE);
+  telemetry_register_task("audio_out", output_task);
+  telemetry_register_task("audio_feed", feeder_task);
+#endif
+
+  console_register("audio", "[tone <hz>|vol <0-255>|pause|resume|stop] audio transport and ring statistics", cmd_audio);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// PCM producer. read fills up to 'frames' interleaved stereo int16 frames
+// and returns how many it wrote; 0 ends the stream. It runs on the audio
+// feeder task (AUDIO_CORE), never on the render core.
+struct AudioSource {
+  uint32_t (*read)(void* ctx, int16_t* out, uint32_t frames);
+  void* ctx;
+  uint32_t sample_rate;
+};
+
+enum AudioState {
+  AUDIO_STOPPED,
+  AUDIO_PLAYING,
+  AUDIO_PAUSED
+};
+
+struct AudioStats {
+  uint32_t frames_out;      // Frames sent to I2S since play
+  uint32_t underruns;       // Output blocks padded with silence while playing
+  uint32_t ring_fill;       // Frames queued now
+  uint32_t ring_min;        // Lowest fill seen while playing
+  uint32_t source_max_us;   // Slowest source read
+};
+
+// Transition from one source to the queued next one
+struct AudioTransition {
+  uint32_t seq;             // Transitions completed since boot
+  uint32_t preroll_frames;  // Frames of the next source decoded before the current one ended
+  uint32_t splice_us;       // From the end of the current source to the next one taking over
+  uint32_t gap_frames;      // Silence heard between the last frame and the next first frame
+  uint32_t sample_rate;     // Of the next source; a rate change costs a short gap
+};
+
+// Start the I2S output and the feeder/output tasks on AUDIO_CORE, and
+// register the 'audio' console command
+void audio_init();
+
+// Transport (call from the UI/main loop)
+void audio_play(const AudioSource* src);  // src must stay valid until stopped
+
+// Play 'next' right after the current source ends, sample-contiguous in the
+// ring. Its first AUDIO_PREROLL_FRAMES are decoded ahead while the ring is
+// full. Plays at once if nothing is playing; replaces a queued source.
+void audio_queue(const AudioSource* next);
+
+// Latest completed transition, returns its seq (poll for changes)
+uint32_t audio_get_transition(AudioTransition* transition);
+void audio_pause();
+void audio_resume();
+void audio_stop();
+void audio_set_volume(uint8_t volume);    // 0-255
+uint8_t audio_get_volume();
+AudioState audio_get_state();
+uint32_t audio_get_position_ms();
+
+void audio_get_stats(AudioStats* stats, bool reset);
+
+// Latest 'n' mono samples sent to the output (before volume), each the
+// average of 'decimate' frames; n * decimate must not exceed
+// AUDIO_TAP_FRAMES. Returns false unless playing.
+bool audio_read_tap(int16_t* out, uint32_t n, uint32_t decimate);
+
+// Sine test source
+const AudioSource* audio_tone_source(uint32_t hz);
+
+#ifdef CYD_HOST
+// Host build: there are no tasks or I2S. Run the output for 'frames' frames
+// (whole blocks) into a 16-bit stereo WAV file. The feeder gets a turn after
+// every 'feed_every' output blocks; above AUDIO_RING_FRAMES / AUDIO_DMA_FRAMES
+// it falls behind like a slow source would. 0 never feeds.
+bool audio_host_render(const char* path, uint32_t frames, uint32_t feed_every);
+#endif
@@ -0,0 +1,1007 @@
+#include <esp_heap_caps.h>
+#include <lvgl.h>
+#include <SD.h>
+#include "adpcm.h"
+#include "analog_clock.h"
+#include "audio.h"
+#include "benchmark.h"
+#include "console.h"
+#include "display.h"
+#include "lvgl_init.h"
+#include "rgb565_swar.h"
+#include "smooth_raster.h"
+#include "spectrum.h"
+#include "sprite_dma.h"
+#include "storage.h"
+#include "touch.h"
+#include "vlist.h"
+
+#define BENCH_IMG_SIZE 64
+
+void benchmark_report(const char* group, const char* name, uint32_t iterations, uint32_t total_us) {
+  Serial.printf("BENCH,%s,%s,%u,%u,%u\n", group, name, iterations, total_us,
+                iterations ? total_us / iterations : 0);
+}
+
+// Header line so results from different builds and settings can be compared
+static void report_begin() {
+  Serial.printf("BENCH,begin,fw=%s,built=%s %s,spi_hz=%u,buf_rows=%u,refr_ms=%u,color_depth=%d\n",
+                FIRMWARE_VERSION, __DATE__, __TIME__, (unsigned)SPI_FREQUENCY,
+                lvgl_get_buffer_rows(), lvgl_get_refresh_period(), LV_COLOR_DEPTH);
+}
+
+static void report_end() {
+  Serial.println("BENCH,end");
+}
+
+// Gradient test image in RGB565
+static uint16_t* make_test_image() {
+  uint16_t* img = (uint16_t*)malloc(BENCH_IMG_SIZE * BENCH_IMG_SIZE * sizeof(uint16_t));
+  if (!img) return NULL;
+  for (int y = 0; y < BENCH_IMG_SIZE; y++) {
+    for (int x = 0; x < BENCH_IMG_SIZE; x++) {
+      img[y * BENCH_IMG_SIZE + x] = ((x * 31 / BENCH_IMG_SIZE) << 11) | ((y * 63 / BENCH_IMG_SIZE) << 5) | 0x0F;
+    }
+  }
+  return img;
+}
+
+// Same gradient in the LVGL colour format
+static lv_color_t* make_lv_test_image() {
+  lv_color_t* img = (lv_color_t*)malloc(BENCH_IMG_SIZE * BENCH_IMG_SIZE * sizeof(lv_color_t));
+  if (!img) return NULL;
+  for (int y = 0; y < BENCH_IMG_SIZE; y++) {
+    for (int x = 0; x < BENCH_IMG_SIZE; x++) {
+      img[y * BENCH_IMG_SIZE + x] = lv_color_make(x * 255 / BENCH_IMG_SIZE, y * 255 / BENCH_IMG_SIZE, 0x7F);
+    }
+  }
+  return img;
+}
+
+/***************************************************************************************
+** TFT_eSPI workloads, drawn straight to the panel
+***************************************************************************************/
+
+void benchmark_run_tft() {
+  TFT_eSPI* tft = display_get_tft();
+  int16_t w = tft->width();
+  int16_t h = tft->height();
+  uint32_t t;
+
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    tft->fillScreen(i & 1 ? TFT_NAVY : TFT_DARKGREEN);
+  }
+  benchmark_report("tft", "fill_screen", BENCH_ITERATIONS, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS * 10; i++) {
+    tft->fillRect((i * 37) % (w - 40), (i * 53) % (h - 40), 40, 40, i * 0x1234);
+  }
+  benchmark_report("tft", "fill_rect_40", BENCH_ITERATIONS * 10, micros() - t);
+
+  tft->fillScreen(TFT_BLACK);
+  tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    for (int row = 0; row < 10; row++) {
+      tft->drawString("The quick brown fox 0123", 0, row * 16, 2);
+    }
+  }
+  benchmark_report("tft", "text_font2_x10", BENCH_ITERATIONS, micros() - t);
+
+  uint16_t* img = make_test_image();
+  if (img) {
+    t = micros();
+    for (int i = 0; i < BENCH_ITERATIONS * 10; i++) {
+      tft->pushImage((i * 29) % (w - BENCH_IMG_SIZE), (i * 41) % (h - BENCH_IMG_SIZE),
+                     BENCH_IMG_SIZE, BENCH_IMG_SIZE, img);
+    }
+    benchmark_report("tft", "image_64", BENCH_ITERATIONS * 10, micros() - t);
+    free(img);
+  }
+
+  tft->fillScreen(TFT_BLACK);
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    tft->drawSmoothArc(w / 2, h / 2, 80, 60, 30, 330, i & 1 ? TFT_ORANGE : TFT_CYAN, TFT_BLACK, true);
+  }
+  benchmark_report("tft", "smooth_arc_r80", BENCH_ITERATIONS, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    tft->drawWedgeLine(w / 2, h / 2, w / 2 + 70 * cosf(i * 0.3f), h / 2 + 70 * sinf(i * 0.3f),
+                       6, 1, TFT_WHITE, TFT_BLACK);
+  }
+  benchmark_report("tft", "wedge_line_70", BENCH_ITERATIONS, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    raster_wedge_line(tft, w / 2, h / 2, w / 2 + 70 * cosf(i * 0.3f), h / 2 + 70 * sinf(i * 0.3f),
+                      6, 1, TFT_WHITE, TFT_BLACK);
+  }
+  benchmark_report("tft", "raster_wedge_line_70", BENCH_ITERATIONS, micros() - t);
+
+  // Unknown background: per-pixel readPixel versus one readRect per row
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    tft->drawSpot(w / 2, h / 2, 20, TFT_RED);
+  }
+  benchmark_report("tft", "spot_r20_read_bg", BENCH_ITERATIONS, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    raster_spot(tft, w / 2, h / 2, 20, TFT_RED);
+  }
+  benchmark_report("tft", "raster_spot_r20_read_bg", BENCH_ITERATIONS, micros() - t);
+
+  // Rotating needle, TFT_eSprite::pushRotated against the DMA rotation engine
+  TFT_eSprite needle(tft);
+  for (int bpp = 16; bpp >= 4; bpp -= 12) {
+    needle.setColorDepth(bpp);
+    if (!needle.createSprite(120, 14)) continue;
+    // 4bpp sprites take default palette indices: 0 black, 2 red, 9 white
+    needle.fillSprite(TFT_BLACK);
+    needle.fillTriangle(0, 7, 110, 0, 110, 13, bpp == 4 ? 2 : TFT_RED);
+    needle.fillCircle(110, 7, 3, bpp == 4 ? 9 : TFT_WHITE);
+    needle.setPivot(110, 7);
+    tft->setPivot(w / 2, h / 2);
+    const char* suffix = bpp == 16 ? "16" : "4";
+    char name[40];
+
+    tft->fillScreen(TFT_BLACK);
+    t = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) needle.pushRotated(i * 18, TFT_BLACK);
+    snprintf(name, sizeof(name), "push_rotated_%sbpp", suffix);
+    benchmark_report("tft", name, BENCH_ITERATIONS, micros() - t);
+
+    static const char* modes[] = { "nearest", "edge_aa", "bilinear" };
+    for (int m = 0; m < 3; m++) {
+      tft->fillScreen(TFT_BLACK);
+      t = micros();
+      for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        sprite_push_rotated(tft, &needle, w / 2, h / 2, i * 18, (SpriteSampling)m, TFT_BLACK, TFT_BLACK);
+      }
+      snprintf(name, sizeof(name), "sprite_rotated_%sbpp_%s", suffix, modes[m]);
+      benchmark_report("tft", name, BENCH_ITERATIONS, micros() - t);
+    }
+    needle.deleteSprite();
+  }
+
+  // Full-screen low-bpp sprites, TFT_eSprite::pushSprite against DMA palette expansion
+  TFT_eSprite screen(tft);
+  for (int bpp = 4; bpp <= 8; bpp += 4) {
+    screen.setColorDepth(bpp);
+    if (!screen.createSprite(w, h)) continue;
+    for (int y = 0; y < h; y += 16) {
+      for (int x = 0; x < w; x += 16) {
+        uint16_t c = bpp == 4 ? ((x + y) >> 4) & 0x0F : (x * 0x1F / w) << 11 | (y * 0x3F / h) << 5;
+        screen.fillRect(x, y, 16, 16, c);
+      }
+    }
+    char name[40];
+
+    t = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) screen.pushSprite(0, 0);
+    snprintf(name, sizeof(name), "push_sprite_full_%dbpp", bpp);
+    benchmark_report("tft", name, BENCH_ITERATIONS, micros() - t);
+
+    t = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) sprite_push(tft, &screen, 0, 0);
+    snprintf(name, sizeof(name), "sprite_push_dma_full_%dbpp", bpp);
+    benchmark_report("tft", name, BENCH_ITERATIONS, micros() - t);
+
+    screen.deleteSprite();
+  }
+
+  // The panel no longer shows what the flush filter last sent
+  display_invalidate_all_tiles();
+}
+
+/***************************************************************************************
+** LVGL workloads, rendered and flushed through display_flush_cb
+***************************************************************************************/
+
+// Time full refreshes, calling update before each one
+static void time_refresh(const char* name, lv_obj_t* scr, void (*update)(lv_obj_t*, int)) {
+  lv_refr_now(NULL);  // Settle layout and first draw outside the timing
+  uint32_t t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    update(scr, i);
+    lv_refr_now(NULL);
+  }
+  benchmark_report("lvgl", name, BENCH_ITERATIONS, micros() - t);
+}
+
+static void update_fill(lv_obj_t* scr, int i) {
+  lv_obj_set_style_bg_color(scr, i & 1 ? lv_color_hex(0x000080) : lv_color_hex(0x008000), 0);
+}
+
+static void update_text(lv_obj_t* scr, int i) {
+  for (uint32_t c = 0; c < lv_obj_get_child_cnt(scr); c++) {
+    lv_label_set_text_fmt(lv_obj_get_child(scr, c), "The quick brown fox %d", i);
+  }
+}
+
+static void update_invalidate(lv_obj_t* scr, int i) {
+  lv_obj_invalidate(scr);
+}
+
+static void update_arc(lv_obj_t* scr, int i) {
+  lv_arc_set_value(lv_obj_get_child(scr, 0), i & 1 ? 90 : 10);
+}
+
+static lv_obj_t* new_bench_screen() {
+  lv_obj_t* scr = lv_obj_create(NULL);
+  lv_obj_clear_flag(scr, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_style_bg_color(scr, lv_color_black(), 0);
+  lv_scr_load(scr);
+  return scr;
+}
+
+static void del_bench_screen(lv_obj_t* scr, lv_obj_t* prev) {
+  lv_scr_load(prev);
+  lv_obj_del(scr);
+}
+
+void benchmark_run_lvgl() {
+  lv_obj_t* prev = lv_scr_act();
+  lv_obj_t* scr;
+
+  scr = new_bench_screen();
+  time_refresh("fill_screen", scr, update_fill);
+  del_bench_screen(scr, prev);
+
+  scr = new_bench_screen();
+  for (int row = 0; row < 10; row++) {
+    lv_obj_t* label = lv_label_create(scr);
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_set_style_text_font(label, LV_FONT_DEFAULT, 0);  // Not the theme's label font
+    lv_obj_set_pos(label, 0, row * 16);
+  }
+  time_refresh("text_x10", scr, update_text);
+  del_bench_screen(scr, prev);
+
+  lv_color_t* img = make_lv_test_image();
+  if (img) {
+    lv_img_dsc_t dsc;
+    memset(&dsc, 0, sizeof(dsc));
+    dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
+    dsc.header.w = BENCH_IMG_SIZE;
+    dsc.header.h = BENCH_IMG_SIZE;
+    dsc.data_size = BENCH_IMG_SIZE * BENCH_IMG_SIZE * sizeof(lv_color_t);
+    dsc.data = (const uint8_t*)img;
+
+    scr = new_bench_screen();
+    for (int i = 0; i < 10; i++) {
+      lv_obj_t* obj = lv_img_create(scr);
+      lv_img_set_src(obj, &dsc);
+      lv_obj_set_pos(obj, (i * 29) % (lv_disp_get_hor_res(NULL) - BENCH_IMG_SIZE),
+                     (i * 41) % (lv_disp_get_ver_res(NULL) - BENCH_IMG_SIZE));
+    }
+    time_refresh("image_64_x10", scr, update_invalidate);
+    del_bench_screen(scr, prev);
+    free(img);
+  }
+
+  scr = new_bench_screen();
+  lv_obj_t* arc = lv_arc_create(scr);
+  lv_obj_set_size(arc, 160, 160);
+  lv_obj_center(arc);
+  time_refresh("arc_160", scr, update_arc);
+  del_bench_screen(scr, prev);
+
+  // The UI screen itself (open the panel first to include it)
+  time_refresh("ui", prev, update_invalidate);
+}
+
+/***************************************************************************************
+** Long lists: lv_list with one button per row against the virtualized list
+***************************************************************************************/
+
+#define LIST_ROWS 1000
+#define LIST_ROW_H 20
+#define LIST_POOL_RESERVE (6 * 1024)  // Stop adding lv_list rows here, rendering still needs pool
+
+static lv_obj_t* bench_list;
+
+static uint32_t pool_used() {
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  return mon.total_size - mon.free_size;
+}
+
+static uint32_t pool_free() {
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  return mon.free_size;
+}
+
+static void bind_row(lv_obj_t* row, uint32_t index, void* user_data) {
+  lv_label_set_text_fmt(row, "Track %u", index);
+}
+
+static void update_lv_list(lv_obj_t* scr, int i) {
+  lv_obj_scroll_by(bench_list, 0, -3 * LIST_ROW_H, LV_ANIM_OFF);
+}
+
+static void update_vlist(lv_obj_t* scr, int i) {
+  vlist_scroll_by(bench_list, 3 * LIST_ROW_H);
+}
+
+void benchmark_run_list() {
+  lv_obj_t* prev = lv_scr_act();
+  lv_obj_t* scr = new_bench_screen();
+
+  // One object tree per row, until the pool would run out
+  uint32_t before = pool_used();
+  uint32_t t = micros();
+  bench_list = lv_list_create(scr);
+  lv_obj_set_size(bench_list, LV_PCT(100), LV_PCT(100));
+  int rows = 0;
+  for (; rows < LIST_ROWS && pool_free() > LIST_POOL_RESERVE; rows++) {
+    lv_obj_t* btn = lv_list_add_btn(bench_list, NULL, "Track");
+    lv_label_set_text_fmt(lv_obj_get_child(btn, 0), "Track %d", rows);
+  }
+  benchmark_report("list", "lv_list_create", rows, micros() - t);
+  // BENCH,list,<kind>_mem,<rows_created>,<pool_bytes>
+  Serial.printf("BENCH,list,lv_list_mem,%d,%u\n", rows, pool_used() - before);
+  time_refresh("lv_list_scroll", scr, update_lv_list);
+  del_bench_screen(scr, prev);
+
+  scr = new_bench_screen();
+  before = pool_used();
+  t = micros();
+  bench_list = vlist_create(scr, LIST_ROWS, LIST_ROW_H, bind_row, NULL);
+  benchmark_report("list", "vlist_create", LIST_ROWS, micros() - t);
+  Serial.printf("BENCH,list,vlist_mem,%d,%u\n", LIST_ROWS, pool_used() - before);
+  time_refresh("vlist_scroll", scr, update_vlist);
+  // BENCH,list,vlist_binds,<rows_bound_while_scrolling>
+  Serial.printf("BENCH,list,vlist_binds,%u\n", vlist_get_bind_count(bench_list));
+  del_bench_screen(scr, prev);
+
+  lv_obj_invalidate(prev);
+}
+
+/***************************************************************************************
+** RGB565 kernels, in RAM only (no panel traffic)
+***************************************************************************************/
+
+#define SWAR_LEN 240
+
+// Compare a kernel against its scalar reference over odd and even alignments
+static bool check_kernel(const char* name, uint16_t* a, uint16_t* b, const uint8_t* mask,
+                         void (*kernel)(uint16_t*, uint16_t, const uint8_t*, uint32_t),
+                         void (*reference)(uint16_t*, uint16_t, const uint8_t*, uint32_t)) {
+  for (int off = 0; off < 2; off++) {
+    for (int i = 0; i < SWAR_LEN + 2; i++) a[i] = b[i] = esp_random();
+    uint16_t color = esp_random();
+    kernel(a + off, color, mask, SWAR_LEN - off);
+    reference(b + off, color, mask, SWAR_LEN - off);
+    if (memcmp(a, b, (SWAR_LEN + 2) * sizeof(uint16_t)) != 0) {
+      Serial.printf("BENCH,swar,check_%s,FAIL,off=%d\n", name, off);
+      return false;
+    }
+  }
+  return true;
+}
+
+static void const_kernel(uint16_t* d, uint16_t c, const uint8_t* m, uint32_t n) { swar_blend_const(d, c, m[0], n); }
+static void const_reference(uint16_t* d, uint16_t c, const uint8_t* m, uint32_t n) { scalar_blend_const(d, c, m[0], n); }
+
+void benchmark_run_swar() {
+  uint16_t* a = (uint16_t*)malloc((SWAR_LEN + 2) * sizeof(uint16_t));
+  uint16_t* b = (uint16_t*)malloc((SWAR_LEN + 2) * sizeof(uint16_t));
+  uint8_t* mask = (uint8_t*)malloc(SWAR_LEN);
+  if (!a || !b || !mask) {
+    free(a); free(b); free(mask);
+    return;
+  }
+
+  // Anti-aliased glyph-like mask: runs of 0 and 255 with soft edges
+  for (int i = 0; i < SWAR_LEN; i++) {
+    int p = i % 24;
+    mask[i] = p < 8 ? 0 : (p < 12 ? (p - 7) * 51 : (p < 20 ? 255 : (24 - p) * 51));
+  }
+
+  bool ok = true;
+  ok &= check_kernel("a8", a, b, mask, swar_blend_a8, scalar_blend_a8);
+  ok &= check_kernel("a4", a, b, mask, swar_blend_a4, scalar_blend_a4);
+  for (int alpha = 0; alpha < 256 && ok; alpha += 17) {
+    uint8_t al = alpha;
+    ok &= check_kernel("const", a, b, &al, const_kernel, const_reference);
+  }
+  Serial.printf("BENCH,swar,check,%s\n", ok ? "ok" : "FAIL");
+
+  TFT_eSPI* tft = display_get_tft();
+  const int rows = BENCH_ITERATIONS * 50;
+  uint32_t t;
+
+  t = micros();
+  for (int i = 0; i < rows; i++) {
+    for (int x = 0; x < SWAR_LEN; x++) a[x] = tft->alphaBlend(128, TFT_ORANGE, a[x]);
+  }
+  benchmark_report("swar", "alpha_blend_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) {
+    for (int x = 0; x < SWAR_LEN; x++) a[x] = fastBlend(128, TFT_ORANGE, a[x]);
+  }
+  benchmark_report("swar", "fast_blend_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) scalar_blend_const(a, TFT_ORANGE, 128, SWAR_LEN);
+  benchmark_report("swar", "scalar_const_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) swar_blend_const(a, TFT_ORANGE, 128, SWAR_LEN);
+  benchmark_report("swar", "swar_const_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) scalar_blend_a8(a, TFT_ORANGE, mask, SWAR_LEN);
+  benchmark_report("swar", "scalar_a8_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) swar_blend_a8(a, TFT_ORANGE, mask, SWAR_LEN);
+  benchmark_report("swar", "swar_a8_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) scalar_blend_a4(a, TFT_ORANGE, mask, SWAR_LEN);
+  benchmark_report("swar", "scalar_a4_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) swar_blend_a4(a, TFT_ORANGE, mask, SWAR_LEN);
+  benchmark_report("swar", "swar_a4_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) {
+    for (int x = 0; x < SWAR_LEN; x++) a[x] = TFT_NAVY;
+  }
+  benchmark_report("swar", "scalar_fill_row", rows, micros() - t);
+
+  t = micros();
+  for (int i = 0; i < rows; i++) swar_fill(a, TFT_NAVY, SWAR_LEN);
+  benchmark_report("swar", "swar_fill_row", rows, micros() - t);
+
+  free(a);
+  free(b);
+  free(mask);
+}
+
+/***************************************************************************************
+** Colour banding of the LVGL colour depth against RGB565
+***************************************************************************************/
+
+// RGB565 channel round trip, as the panel shows a 16-bit LVGL colour
+static uint8_t expand565(uint8_t v, int bits) {
+  uint8_t q = v >> (8 - bits);
+  uint8_t max = (1 << bits) - 1;
+  return (q * 255 + max / 2) / max;
+}
+
+void benchmark_run_banding() {
+  static const char* ramps[] = { "red", "green", "blue", "grey" };
+
+  // Each 0-255 ramp through lv_color_make and back. Fewer levels and a larger
+  // error than RGB565 mean visible bands in gradients.
+  for (int ch = 0; ch < 4; ch++) {
+    int levels = 0, levels_565 = 0, err = 0, err_565 = 0;
+    uint32_t prev = 0xFFFFFFFF, prev_565 = 0xFFFFFFFF;
+
+    for (int v = 0; v < 256; v++) {
+      uint8_t in[3] = { (uint8_t)(ch == 0 || ch == 3 ? v : 0), (uint8_t)(ch == 1 || ch == 3 ? v : 0),
+                        (uint8_t)(ch == 2 || ch == 3 ? v : 0) };
+      uint32_t c32 = lv_color_to32(lv_color_make(in[0], in[1], in[2]));
+      uint8_t out[3] = { (uint8_t)(c32 >> 16), (uint8_t)(c32 >> 8), (uint8_t)c32 };
+      uint8_t ref[3] = { expand565(in[0], 5), expand565(in[1], 6), expand565(in[2], 5) };
+
+      uint32_t key = c32 & 0xFFFFFF;
+      uint32_t key_565 = ref[0] << 16 | ref[1] << 8 | ref[2];
+      if (key != prev) levels++;
+      if (key_565 != prev_565) levels_565++;
+      prev = key;
+      prev_565 = key_565;
+
+      for (int i = 0; i < 3; i++) {
+        err = max(err, abs(out[i] - in[i]));
+        err_565 = max(err_565, abs(ref[i] - in[i]));
+      }
+    }
+    // BENCH,banding,<ramp>,<levels>,<max_err>,<levels_565>,<max_err_565>
+    Serial.printf("BENCH,banding,%s,%d,%d,%d,%d\n", ramps[ch], levels, err, levels_565, err_565);
+  }
+}
+
+/***************************************************************************************
+** Hot path placement: refresh timings with a cold and a warm flash cache
+***************************************************************************************/
+
+// Read-only data in flash, larger than the 32 KB cache. Reading it evicts the
+// cached instructions, as a busy app would between two frames. Only linked
+// into benchmark builds (-DCYD_BENCH_IRAM); without it the cold cache passes
+// are skipped.
+#ifdef CYD_BENCH_IRAM
+#define EVICT_SIZE (48 * 1024)
+static const uint8_t evict_data[EVICT_SIZE] = { 1 };
+#else
+#define EVICT_SIZE 0
+#endif
+
+extern int _iram_text_start;
+extern int _iram_text_end;
+
+static void evict_flash_cache() {
+#if EVICT_SIZE
+  const volatile uint8_t* p = evict_data;  // Keep the reads from being folded away
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < EVICT_SIZE; i += 32) sum += p[i];
+  (void)sum;
+#endif
+}
+
+void benchmark_run_iram() {
+#ifdef CYD_FAST_MEM
+  const char* fast_mem = "on";
+#else
+  const char* fast_mem = "off";
+#endif
+  // BENCH,iram,<fast_mem>,<iram_text_bytes>,<exec_heap_free>
+  Serial.printf("BENCH,iram,%s,%u,%u\n", fast_mem,
+                (unsigned)((uint8_t*)&_iram_text_end - (uint8_t*)&_iram_text_start),
+                heap_caps_get_free_size(MALLOC_CAP_EXEC));
+
+  lv_obj_t* prev = lv_scr_act();
+  lv_obj_t* scr = new_bench_screen();
+  for (int row = 0; row < 10; row++) {
+    lv_obj_t* label = lv_label_create(scr);
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_set_style_bg_opa(label, LV_OPA_50, 0);
+    lv_obj_set_style_bg_color(label, lv_color_hex(0x0040A0), 0);
+    lv_label_set_text_fmt(label, "Hot path row %d", row);
+    lv_obj_set_pos(label, 0, row * 24);
+  }
+  lv_refr_now(NULL);
+
+  uint32_t cold = 0, warm = 0;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    uint32_t t;
+    if (EVICT_SIZE) {
+      display_invalidate_all_tiles();  // Flush every tile, not only changed ones
+      lv_obj_invalidate(scr);
+      evict_flash_cache();
+      t = micros();
+      lv_refr_now(NULL);
+      cold += micros() - t;
+    }
+
+    display_invalidate_all_tiles();
+    lv_obj_invalidate(scr);
+    t = micros();
+    lv_refr_now(NULL);
+    warm += micros() - t;
+  }
+  if (EVICT_SIZE) benchmark_report("iram", "refresh_cold_cache", BENCH_ITERATIONS, cold);
+  benchmark_report("iram", "refresh_warm_cache", BENCH_ITERATIONS, warm);
+
+  // Touch read path as LVGL calls it
+  lv_indev_drv_t drv;
+  lv_indev_data_t data;
+  cold = warm = 0;
+  for (int i = 0; i < BENCH_ITERATIONS * 10; i++) {
+    uint32_t t;
+    if (EVICT_SIZE) {
+      evict_flash_cache();
+      t = micros();
+      touch_read_cb(&drv, &data);
+      cold += micros() - t;
+    }
+    t = micros();
+    touch_read_cb(&drv, &data);
+    warm += micros() - t;
+  }
+  if (EVICT_SIZE) benchmark_report("iram", "touch_read_cold_cache", BENCH_ITERATIONS * 10, cold);
+  benchmark_report("iram", "touch_read_warm_cache", BENCH_ITERATIONS * 10, warm);
+  if (!EVICT_SIZE) Serial.println("BENCH,iram,cold_cache,not_built");  // Needs -DCYD_BENCH_IRAM
+
+  del_bench_screen(scr, prev);
+  lv_obj_invalidate(prev);
+}
+
+/***************************************************************************************
+** IMA-ADPCM decode cost per second of audio (RAM to RAM, no I2S)
+***************************************************************************************/
+
+#define ADPCM_BENCH_SPB 1017          // Frames per block: 1024-byte blocks in stereo, 512 in mono
+
+struct MemReader {
+  const uint8_t* data;
+  size_t len;
+  size_t pos;
+};
+
+static size_t mem_read(void* ctx, uint8_t* buf, size_t len) {
+  MemReader* r = (MemReader*)ctx;
+  len = min(len, r->len - r->pos);
+  memcpy(buf, r->data + r->pos, len);
+  r->pos += len;
+  return len;
+}
+
+static void put_le(uint8_t* p, uint32_t v, int bytes) {
+  for (int i = 0; i < bytes; i++) p[i] = v >> (i * 8);
+}
+
+// One second of a two-tone signal as an in-memory IMA-ADPCM WAV, NULL if out of memory
+static uint8_t* make_adpcm_wav(uint16_t channels, size_t* len, AdpcmChannel* state) {
+  const uint32_t blocks = (AUDIO_SAMPLE_RATE + ADPCM_BENCH_SPB - 1) / ADPCM_BENCH_SPB;
+  const uint16_t block_align = 4 * channels + (ADPCM_BENCH_SPB - 1) / 2 * channels;
+  const size_t header = 12 + 8 + 16 + 8;
+  *len = header + blocks * block_align;
+
+  uint8_t* wav = (uint8_t*)malloc(*len);
+  int16_t* pcm = (int16_t*)malloc(ADPCM_BENCH_SPB * channels * sizeof(int16_t));
+  if (!wav || !pcm) {
+    free(wav); free(pcm);
+    return NULL;
+  }
+
+  memcpy(wav, "RIFF", 4);
+  put_le(wav + 4, *len - 8, 4);
+  memcpy(wav + 8, "WAVEfmt ", 8);
+  put_le(wav + 16, 16, 4);
+  put_le(wav + 20, 0x11, 2);
+  put_le(wav + 22, channels, 2);
+  put_le(wav + 24, AUDIO_SAMPLE_RATE, 4);
+  put_le(wav + 28, AUDIO_SAMPLE_RATE * block_align / ADPCM_BENCH_SPB, 4);
+  put_le(wav + 32, block_align, 2);
+  put_le(wav + 34, 4, 2);
+  memcpy(wav + 36, "data", 4);
+  put_le(wav + 40, blocks * block_align, 4);
+
+  memset(state, 0, 2 * sizeof(AdpcmChannel));
+  uint32_t n = 0;
+  for (uint32_t b = 0; b < blocks; b++) {
+    for (int i = 0; i < ADPCM_BENCH_SPB; i++, n++) {
+      for (int c = 0; c < channels; c++) {
+        pcm[i * channels + c] = 9000 * sinf(n * (0.06f + 0.03f * c)) + 3000 * sinf(n * 0.71f);
+      }
+    }
+    adpcm_encode_block(state, channels, pcm, ADPCM_BENCH_SPB, wav + header + b * block_align);
+  }
+  free(pcm);
+  return wav;
+}
+
+static void bench_adpcm(uint16_t channels, AdpcmDecoder* dec, int16_t* out) {
+  size_t len;
+  AdpcmChannel enc[2];
+  uint8_t* wav = make_adpcm_wav(channels, &len, enc);
+  if (!wav) return;
+
+  // Check: the full length decodes and ends on the encoder's reconstruction
+  MemReader r = { wav, len, 0 };
+  uint32_t frames = 0, n;
+  bool ok = adpcm_open(dec, mem_read, &r);
+  while (ok && (n = adpcm_decode(dec, out, AUDIO_FEED_FRAMES)) > 0) frames += n;
+  ok = ok && frames == dec->total_frames;
+  if (ok) {
+    uint32_t last = (frames - 1) % AUDIO_FEED_FRAMES;
+    ok = out[last * 2] == enc[0].predictor && out[last * 2 + 1] == enc[channels - 1].predictor;
+  }
+  const char* name = channels == 1 ? "decode_mono" : "decode_stereo";
+  Serial.printf("BENCH,adpcm,check_%s,%s\n", name, ok ? "ok" : "FAIL");
+  if (!ok) {
+    free(wav);
+    return;
+  }
+
+  // Decode in feeder-sized reads, as the audio engine does
+  uint32_t t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    r.pos = 0;
+    adpcm_open(dec, mem_read, &r);
+    while (adpcm_decode(dec, out, AUDIO_FEED_FRAMES) > 0) {}
+  }
+  t = micros() - t;
+  benchmark_report("adpcm", name, BENCH_ITERATIONS, t);
+
+  // BENCH,adpcm,<name>_cpu,<cycles_per_audio_second>,<cpu_permille>
+  uint32_t us_per_s = (uint64_t)t * 1000 / (BENCH_ITERATIONS * adpcm_duration_ms(dec));
+  Serial.printf("BENCH,adpcm,%s_cpu,%u,%u\n", name, us_per_s * getCpuFrequencyMhz(), us_per_s / 1000);
+  free(wav);
+}
+
+void benchmark_run_adpcm() {
+  AdpcmDecoder* dec = (AdpcmDecoder*)malloc(sizeof(AdpcmDecoder));
+  int16_t* out = (int16_t*)malloc(AUDIO_FEED_FRAMES * 2 * sizeof(int16_t));
+  if (dec && out) {
+    bench_adpcm(1, dec, out);
+    bench_adpcm(2, dec, out);
+  }
+  free(dec);
+  free(out);
+}
+
+/***************************************************************************************
+** Spectrum FFT: fixed point against the FPU
+***************************************************************************************/
+
+#define FFT_BENCH_BIN 20
+
+void benchmark_run_fft() {
+  int16_t* re = (int16_t*)malloc(SPECTRUM_FFT_N * 2 * sizeof(int16_t));
+  float* ref = (float*)malloc(SPECTRUM_FFT_N * 2 * sizeof(float));
+  if (re && ref) {
+    int16_t* im = re + SPECTRUM_FFT_N;
+    float* imf = ref + SPECTRUM_FFT_N;
+    int16_t tone[SPECTRUM_FFT_N];
+    for (int i = 0; i < SPECTRUM_FFT_N; i++) {
+      tone[i] = (int16_t)(16384 * sinf(2.0f * (float)M_PI * FFT_BENCH_BIN * i / SPECTRUM_FFT_N));
+    }
+
+    // Check: a tone on a bin lands on that bin in both, at the same level
+    for (int i = 0; i < SPECTRUM_FFT_N; i++) { re[i] = tone[i]; im[i] = 0; ref[i] = tone[i]; imf[i] = 0; }
+    spectrum_fft_q15(re, im);
+    spectrum_fft_float(ref, imf);
+    int peak = 1, peak_f = 1;
+    for (int k = 1; k < SPECTRUM_FFT_N / 2; k++) {
+      if (abs(im[k]) > abs(im[peak])) peak = k;
+      if (fabsf(imf[k]) > fabsf(imf[peak_f])) peak_f = k;
+    }
+    float scaled = imf[peak_f] / SPECTRUM_FFT_N;
+    bool ok = peak == FFT_BENCH_BIN && peak_f == FFT_BENCH_BIN && fabsf(scaled - im[peak]) < 8;
+    Serial.printf("BENCH,fft,check,%s\n", ok ? "ok" : "FAIL");
+
+    uint32_t t = micros();
+    for (int r = 0; r < BENCH_ITERATIONS; r++) {
+      for (int i = 0; i < SPECTRUM_FFT_N; i++) { re[i] = tone[i]; im[i] = 0; }
+      spectrum_fft_q15(re, im);
+    }
+    benchmark_report("fft", "fft_q15", BENCH_ITERATIONS, micros() - t);
+
+    t = micros();
+    for (int r = 0; r < BENCH_ITERATIONS; r++) {
+      for (int i = 0; i < SPECTRUM_FFT_N; i++) { ref[i] = tone[i]; imf[i] = 0; }
+      spectrum_fft_float(ref, imf);
+    }
+    benchmark_report("fft", "fft_float", BENCH_ITERATIONS, micros() - t);
+
+    // BENCH,fft,path,<path_the_visualizer_uses>
+    SpectrumStats st;
+    spectrum_get_stats(&st, false);
+    Serial.printf("BENCH,fft,path,%s\n", st.use_float ? "float" : "q15");
+  }
+  free(re);
+  free(ref);
+}
+
+/***************************************************************************************
+** Spectrum visualizer: live frames of a test tone, as on screen
+***************************************************************************************/
+
+#define SPECTRUM_BENCH_MS 5000
+#define SPECTRUM_BENCH_HZ 1000
+
+void benchmark_run_spectrum() {
+  lv_obj_t* prev = lv_scr_act();
+  lv_obj_t* scr = new_bench_screen();
+  lv_obj_t* spec = spectrum_create(scr);
+  lv_obj_set_size(spec, LV_PCT(100), LV_PCT(50));
+  lv_obj_center(spec);
+  lv_refr_now(NULL);
+
+  // Frames come from the visualizer's own timer, so LVGL runs as in loop()
+  SpectrumStats st;
+  spectrum_get_stats(&st, true);
+  audio_play(audio_tone_source(SPECTRUM_BENCH_HZ));
+  uint32_t start = millis();
+  while (millis() - start < SPECTRUM_BENCH_MS) {
+    lvgl_task_handler();
+    delay(1);
+  }
+  audio_stop();
+  spectrum_get_stats(&st, true);
+  // BENCH,spectrum,frames,<frames>,<late>,<px_per_frame>,<analyze_max_us>,<draw_max_us>
+  Serial.printf("BENCH,spectrum,frames,%u,%u,%u,%u,%u\n", st.frames, st.late,
+                st.frames ? st.px_sum / st.frames : 0, st.analyze_max_us, st.draw_max_us);
+
+  del_bench_screen(scr, prev);
+  lv_obj_invalidate(prev);
+}
+
+/***************************************************************************************
+** Analog clock: full dial redraw against hands-only updates from the cached dial
+***************************************************************************************/
+
+void benchmark_run_clock() {
+  lv_obj_t* prev = lv_scr_act();
+  lv_obj_t* scr = new_bench_screen();
+  lv_obj_t* face = analog_clock_create(scr, true);
+  if (!face) {
+    Serial.println("BENCH,clock,no_memory");
+    del_bench_screen(scr, prev);
+    return;
+  }
+  analog_clock_set_active(face, false);  // Ticks come from here only
+  lv_obj_center(face);
+  lv_refr_now(NULL);
+
+  struct tm tm = {};
+  tm.tm_hour = 10;
+  tm.tm_min = 9;
+  AnalogClockStats st;
+  uint32_t t = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++) analog_clock_draw(face, &tm, true);
+  benchmark_report("clock", "full_redraw", BENCH_ITERATIONS, micros() - t);
+
+  // A minute of second ticks, ending on the minute rollover that moves all hands
+  analog_clock_get_stats(&st, true);
+  t = micros();
+  for (int i = 1; i <= 60; i++) {
+    tm.tm_sec = i % 60;
+    if (tm.tm_sec == 0) tm.tm_min++;
+    analog_clock_draw(face, &tm, false);
+  }
+  benchmark_report("clock", "hands_tick", 60, micros() - t);
+  analog_clock_get_stats(&st, true);
+  // BENCH,clock,px_per_tick,<avg_pushed>,<full_redraw>,<draw_max_us>
+  Serial.printf("BENCH,clock,px_per_tick,%u,%u,%u\n", st.px_sum / st.ticks, st.full_px, st.draw_max_us);
+
+  del_bench_screen(scr, prev);
+  lv_obj_invalidate(prev);
+}
+
+/***************************************************************************************
+** SD card: small against sector-aligned transfers, and the read-ahead stream
+***************************************************************************************/
+
+#define SD_BENCH_PATH "/bench.bin"
+#define SD_BENCH_SIZE (256 * 1024)
+#define SD_BENCH_SMALL 100            // A typical log record / naive read size
+
+// BENCH,sd,<name>,<ops>,<total_us>,<us_per_op>, then BENCH,sd,<name>_kbps,<kbps>
+static void report_sd(const char* name, uint32_t ops, uint32_t bytes, uint32_t us) {
+  benchmark_report("sd", name, ops, us);
+  Serial.printf("BENCH,sd,%s_kbps,%u\n", name, us ? (uint32_t)((uint64_t)bytes * 1000000 / 1024 / us) : 0);
+}
+
+// Whole chunks only: with 100-byte records the file ends a little short of
+// SD_BENCH_SIZE, and the count and rate are of what was written
+static void sd_write_file(const char* name, uint8_t* buf, size_t chunk) {
+  SD.remove(SD_BENCH_PATH);
+  File f = SD.open(SD_BENCH_PATH, FILE_WRITE);
+  if (!f) return;
+  uint32_t ops = 0;
+  size_t done = 0;
+  uint32_t t = micros();
+  for (; done + chunk <= SD_BENCH_SIZE; done += chunk, ops++) f.write(buf, chunk);
+  f.close();
+  report_sd(name, ops, done, micros() - t);
+}
+
+static void sd_read_file(const char* name, uint8_t* buf, size_t chunk) {
+  File f = SD.open(SD_BENCH_PATH, FILE_READ);
+  if (!f) return;
+  uint32_t ops = 0, bytes = 0;
+  int n;
+  uint32_t t = micros();
+  while ((n = f.read(buf, chunk)) > 0) {
+    ops++;
+    bytes += n;
+  }
+  f.close();
+  report_sd(name, ops, bytes, micros() - t);
+}
+
+void benchmark_run_sd() {
+  if (!storage_mounted()) {
+    Serial.println("BENCH,sd,no_card");
+    return;
+  }
+  uint8_t* buf = (uint8_t*)heap_caps_malloc(STORAGE_BLOCK, MALLOC_CAP_DMA);
+  if (!buf) return;
+  for (int i = 0; i < STORAGE_BLOCK; i++) buf[i] = i;
+
+  // Direct file access: record-sized calls against sector-aligned blocks.
+  // The reads see the SD_BENCH_SIZE file of the block pass.
+  sd_write_file("write_100", buf, SD_BENCH_SMALL);
+  sd_write_file("write_block", buf, STORAGE_BLOCK);
+  sd_read_file("read_100", buf, SD_BENCH_SMALL);
+  sd_read_file("read_block", buf, STORAGE_BLOCK);
+
+  // Read-ahead stream in small reads: the card work happens on the storage task
+  StorageStats st;
+  storage_get_stats(&st, true);
+  StorageStream* s = storage_stream_open(SD_BENCH_PATH);
+  if (s) {
+    uint32_t ops = 0, bytes = 0;
+    size_t n;
+    uint32_t t = micros();
+    while ((n = storage_stream_read(s, buf, SD_BENCH_SMALL)) > 0) {
+      ops++;
+      bytes += n;
+    }
+    t = micros() - t;
+    storage_stream_close(s);
+    report_sd("stream_100", ops, bytes, t);
+    storage_get_stats(&st, true);
+    // BENCH,sd,stream_io,<card_reads>,<read_max_us>,<stalls>
+    Serial.printf("BENCH,sd,stream_io,%u,%u,%u\n", st.read_ops, st.read_max_us, st.stalls);
+  }
+
+  SD.remove(SD_BENCH_PATH);
+  free(buf);
+}
+
+void benchmark_run_all() {
+  report_begin();
+  benchmark_run_banding();
+  benchmark_run_swar();
+  benchmark_run_iram();
+  benchmark_run_adpcm();
+  benchmark_run_fft();
+  benchmark_run_sd();
+  benchmark_run_tft();
+  benchmark_run_lvgl();
+  benchmark_run_list();
+  benchmark_run_clock();
+  benchmark_run_spectrum();
+  report_end();
+}
+
+static void cmd_bench(int argc, char** argv) {
+  if (argc < 2 || strcmp(argv[1], "all") == 0) {
+    benchmark_run_all();
+  } else if (strcmp(argv[1], "tft") == 0) {
+    report_begin();
+    benchmark_run_tft();
+    lv_obj_invalidate(lv_scr_act());
+    report_end();
+  } else if (strcmp(argv[1], "lvgl") == 0) {
+    report_begin();
+    benchmark_run_lvgl();
+    report_end();
+  } else if (strcmp(argv[1], "swar") == 0) {
+    report_begin();
+    benchmark_run_swar();
+    report_end();
+  } else if (strcmp(argv[1], "banding") == 0) {
+    report_begin();
+    benchmark_run_banding();
+    report_end();
+  } else if (strcmp(argv[1], "iram") == 0) {
+    report_begin();
+    benchmark_run_iram();
+    report_end();
+  } else if (strcmp(argv[1], "adpcm") == 0) {
+    report_begin();
+    benchmark_run_adpcm();
+    report_end();
+  } else if (strcmp(argv[1], "list") == 0) {
+    report_begin();
+    benchmark_run_list();
+    report_end();
+  } else if (strcmp(argv[1], "fft") == 0) {
+    report_begin();
+    benchmark_run_fft();
+    report_end();
+  } else if (strcmp(argv[1], "spectrum") == 0) {
+    report_begin();
+    benchmark_run_spectrum();
+    report_end();
+  } else if (strcmp(argv[1], "clock") == 0) {
+    report_begin();
+    benchmark_run_clock();
+    report_end();
+  } else if (strcmp(argv[1], "sd") == 0) {
+    report_begin();
+    benchmark_run_sd();
+    report_end();
+  } else {
+    Serial.println("usage: bench [all|tft|lvgl|list|clock|spectrum|swar|banding|iram|adpcm|fft|sd]");
+  }
+}
+
+void benchmark_init() {
+  console_register("bench", "[all|tft|lvgl|list|clock|spectrum|swar|banding|iram|adpcm|fft|sd] run graphics, audio and storage benchmarks", cmd_bench);
+}
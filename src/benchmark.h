@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Register the "bench" console command
+void benchmark_init();
+
+// Run workloads directly through TFT_eSPI and through LVGL + display_flush_cb.
+// Prints BENCH lines (CSV) and restores the active LVGL screen afterwards.
+void benchmark_run_tft();
+void benchmark_run_lvgl();
+void benchmark_run_all();
+
+// lv_list with 1,000 rows (as many as the pool holds) against vlist: pool
+// bytes, creation time and scroll frame time
+void benchmark_run_list();
+
+// RGB565 kernels against their scalar references: checks, then timings
+void benchmark_run_swar();
+
+// Gradient levels and worst error of the LVGL colour depth next to RGB565
+void benchmark_run_banding();
+
+// IRAM use, then refresh and touch read timings with a warm flash cache and,
+// with -DCYD_BENCH_IRAM (48 KB of eviction data in flash), a cold one.
+// Compare a default build with one built with -DCYD_FAST_MEM.
+void benchmark_run_iram();
+
+// IMA-ADPCM decoder check, then decode time and CPU share per second of audio
+void benchmark_run_adpcm();
+
+// Spectrum FFT check, then fixed-point and FPU transform times
+void benchmark_run_fft();
+
+// A few seconds of the spectrum visualizer on a test tone: frames, late
+// frames, pixels pushed per frame and the worst analyze and draw times
+void benchmark_run_spectrum();
+
+// Analog clock full dial redraw against hands-only ticks, and the pixels
+// each pushes
+void benchmark_run_clock();
+
+// SD write/read with record-sized and sector-aligned calls, and the
+// read-ahead stream; uses a scratch file on the card
+void benchmark_run_sd();
+
+// Emit one result line: BENCH,<group>,<name>,<iterations>,<total_us>,<us_per_iter>
+void benchmark_report(const char* group, const char* name, uint32_t iterations, uint32_t total_us);
@@ -0,0 +1,33 @@
+#include "boot.h"
+
+struct BootPhase {
+  const char* name;
+  uint32_t at_us;
+};
+
+static BootPhase phases[BOOT_MAX_PHASES];
+static uint8_t phase_count = 0;
+static bool first_frame_seen = false;
+
+void boot_mark(const char* phase) {
+  if (phase_count >= BOOT_MAX_PHASES) return;
+  phases[phase_count].name = phase;
+  phases[phase_count].at_us = micros();
+  phase_count++;
+}
+
+void boot_note_frame() {
+  if (first_frame_seen) return;
+  first_frame_seen = true;
+  boot_mark("first_frame");
+  boot_report();
+}
+
+void boot_report() {
+  // micros() starts counting when the app starts, after the bootloader
+  uint32_t prev = 0;
+  for (uint8_t i = 0; i < phase_count; i++) {
+    Serial.printf("PHASE,%s,%u,%u\n", phases[i].name, phases[i].at_us, phases[i].at_us - prev);
+    prev = phases[i].at_us;
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Record the end of a boot phase (name must be a string literal)
+void boot_mark(const char* phase);
+
+// Called on every LVGL refresh, records the first one
+void boot_note_frame();
+
+// Print PHASE lines: name, time since reset and duration of the phase
+void boot_report();
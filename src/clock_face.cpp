@@ -0,0 +1,66 @@
+#include "clock_face.h"
+#include "analog_clock.h"
+#include "wallclock.h"
+
+static lv_obj_t* dial = NULL;
+static lv_obj_t* digits = NULL;
+static lv_obj_t* date_label = NULL;
+
+static void set_date(const struct tm* now) {
+  char text[24];
+  strftime(text, sizeof(text), "%a %d %b %Y", now);
+  lv_label_set_text(date_label, text);
+}
+
+static void date_tick(const struct tm* now, uint8_t changed, void* user_data) {
+  if (changed & WALLCLOCK_CHANGED_DAY) set_date(now);
+}
+
+static void clock_resume() {
+  struct tm now;
+  wallclock_now(&now);
+  set_date(&now);
+  wallclock_digits_set_active(digits, true);
+  if (dial) analog_clock_set_active(dial, true);
+  wallclock_subscribe(WALLCLOCK_MINUTE, date_tick, NULL);
+}
+
+static void clock_suspend() {
+  wallclock_digits_set_active(digits, false);
+  if (dial) analog_clock_set_active(dial, false);
+  wallclock_unsubscribe(date_tick, NULL);
+}
+
+static void clock_create(lv_obj_t* scr) {
+#if CLOCK_ANALOG
+  dial = analog_clock_create(scr, CLOCK_SHOW_SECONDS);
+  if (dial) lv_obj_align(dial, LV_ALIGN_TOP_MID, 0, 16);
+#endif
+
+  digits = wallclock_digits_create(scr, CLOCK_SHOW_SECONDS ? WALLCLOCK_SECOND : WALLCLOCK_MINUTE, CLOCK_DIGIT_FONT);
+  date_label = lv_label_create(scr);
+  if (dial) {
+    // Clear of the dial, which repaints itself whenever anything over it is drawn
+    lv_coord_t y = 16 + CLOCK_DIAL_SIZE + 12;
+    lv_obj_align(digits, LV_ALIGN_TOP_MID, 0, y);
+    lv_obj_align(date_label, LV_ALIGN_TOP_MID, 0, y + lv_font_get_line_height(CLOCK_DIGIT_FONT) + 8);
+  } else {
+    lv_obj_align(digits, LV_ALIGN_CENTER, 0, -12);
+    lv_obj_align(date_label, LV_ALIGN_CENTER, 0, 16);
+  }
+
+  struct tm now;
+  wallclock_now(&now);
+  set_date(&now);
+  wallclock_subscribe(WALLCLOCK_MINUTE, date_tick, NULL);
+}
+
+static void clock_destroy() {
+  // The digits and dial unsubscribe themselves when the screen is deleted
+  wallclock_unsubscribe(date_tick, NULL);
+  dial = NULL;
+  digits = NULL;
+  date_label = NULL;
+}
+
+const AppDesc clock_app = { "clock", clock_create, clock_destroy, clock_suspend, clock_resume };
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <lvgl.h>
+#include "app_manager.h"
+
+// Clock screen: digital time and date, updated by wallclock ticks only
+extern const AppDesc clock_app;
@@ -1,9 +1,20 @@
 #pragma once
 
+#define FIRMWARE_VERSION "0.2.0"
+
+// Build with -DCYD_FAST_MEM to run the flush, touch and blend hot paths from IRAM
+#ifdef CYD_FAST_MEM
+#include <esp_attr.h>
+#define FAST_MEM_ATTR IRAM_ATTR
+#else
+#define FAST_MEM_ATTR
+#endif
+
 // Pin definitions
 #define TOUCH_CS  33  // Touch chip select pin - IO33
 #define TOUCH_IRQ 36  // Touch interrupt pin - IO36
 #define TFT_BL    27  // TFT backlight pin
+#define BACKLIGHT_PWM_HZ 1000       // LEDC on RTC8M_CLK, keeps running in light sleep
 
 // SPI pins for touch
 #define TOUCH_SPI_SCK  14
@@ -25,9 +36,142 @@
 #define LED_PIN_GREEN 16  // Green LED (common anode, low level on)
 #define LED_PIN_BLUE 17   // Blue LED (common anode, low level on)
 
+// Panel orientation at boot: 0/2 portrait, 1/3 landscape (MADCTL, no software rotation)
+#define DISPLAY_ROTATION 0
+
 // LVGL settings
-#define LVGL_BUFFER_ROWS 20       // Number of rows in the buffer
+#if defined(CYD_LV_COLOR_DEPTH) && CYD_LV_COLOR_DEPTH == 8
+#define LVGL_BUFFER_ROWS 80       // 19.2 KB at 1 byte per pixel, four times the 16-bit rows
+#else
+#define LVGL_BUFFER_ROWS 22       // Rows of 240 px; in landscape still one 16-row tile row of 320 px
+#endif
 #define LVGL_REFRESH_TIME 5       // LVGL refresh time in ms
+#define LVGL_SWAR_BLEND 1         // Route LVGL colour fills through the RGB565 kernels
+
+// Memory telemetry
+#define TELEMETRY_SAMPLE_MS 1000      // Sampling period while the UI runs
+#define TELEMETRY_MAX_SCENARIOS 8     // Distinct UI scenarios tracked
+#define TELEMETRY_MAX_TASKS 8         // Tasks whose stack high-water mark is tracked: loop, audio_out,
+                                      // audio_feed, sd_io, player, lib_scan, and room for two more
+
+// Flight recorder (RTC slow memory, survives soft resets)
+#define FLIGHT_RECORDER_ENTRIES 64    // Periodic samples kept
+#define FLIGHT_RECORDER_BOOTS 8       // Reset reasons kept
+#define FLIGHT_RECORDER_PERIOD_MS 5000
+
+// Serial command console
+#define CONSOLE_LINE_MAX 64           // Longest accepted command line
+#define CONSOLE_MAX_ARGS 6            // Arguments per command, including the name
+#define CONSOLE_MAX_COMMANDS 24       // Registered commands
+
+// Boot profiling and cached splash frame
+#define BOOT_MAX_PHASES 12            // Boot phases recorded
+#define SPLASH_ENABLED 1              // Show the last UI frame at boot, save it on sleep
+#define SPLASH_PATH "/splash.rle"     // LittleFS file holding the cached frame
+
+// Smooth primitive rasterizer
+#define RASTER_MAX_SPAN 320           // Longest row span (panel's long side)
+
+// Display DMA and sprite rendering
+#define DISPLAY_DMA 1                 // Attach the panel SPI bus to DMA (pushPixelsDMA)
+#define SPRITE_MAX_SPAN 320           // Longest row a sprite push can output
+
+// Flush filter (skip tiles whose pixels are already on the panel)
+#define DISPLAY_TILE_FILTER 1
+#define DISPLAY_TILE_SIZE 16          // Tile edge in pixels
+
+// Refresh planner (merges dirty areas by estimated SPI cost)
+#define REFRESH_PLANNER 1
+#define REFRESH_PLAN_WINDOW_US 40     // Fixed cost of one flushed window: call, transaction, render pass
+
+// App manager (screens built on first use, cached while inactive)
+#define APP_MAX_APPS 8                // Registered apps
+#define APP_CACHE_BUDGET (16 * 1024)  // LVGL pool kept by inactive screens
+#define APP_POOL_RESERVE (8 * 1024)   // Pool left free for the active app's runtime allocations
+
+// Audio playback (Arduino's loop and LVGL run on core 1, audio on core 0)
+#define AUDIO_OUTPUT_DAC 1            // 1: internal DAC on GPIO26 (speaker header), 0: external I2S codec
+#define AUDIO_I2S_PORT I2S_NUM_0      // The built-in DAC is only wired to I2S0
+#define AUDIO_I2S_BCK 32              // External codec pins, unused with the DAC (22 is LED_PIN_RED)
+#define AUDIO_I2S_WS 21
+#define AUDIO_I2S_DOUT 26
+#define AUDIO_SAMPLE_RATE 22050       // Rate until a source asks for another
+#define AUDIO_RING_FRAMES 4096        // Stereo frames between feeder and output (power of two, ~186 ms)
+#define AUDIO_FEED_FRAMES 512         // Largest source read
+#define AUDIO_DMA_FRAMES 256          // Frames per I2S DMA buffer and per output block
+#define AUDIO_DMA_BUFS 4
+#define AUDIO_PREROLL_FRAMES 1024     // Start of the queued source decoded ahead (~46 ms)
+#define AUDIO_TAP_FRAMES 1024         // Mono copy of the output for visualizers (power of two)
+#define AUDIO_CORE 0
+#define AUDIO_TASK_PRIORITY 5         // Feeder; the output task runs one above
+#define AUDIO_TASK_STACK 3072
+#define ADPCM_MAX_BLOCK 2048          // Largest IMA-ADPCM block the decoder buffers
+
+// microSD slot (own SPI bus, HSPI: the display and touch share VSPI) and storage task
+#define SD_CS 5
+#define SD_SPI_SCK 18
+#define SD_SPI_MISO 19
+#define SD_SPI_MOSI 23
+#define SD_SPI_FREQUENCY 20000000
+#define STORAGE_BLOCK 4096            // Read-ahead buffer (multiple of the 512-byte sector), two per stream
+#define STORAGE_MAX_STREAMS 2
+#define STORAGE_MAX_LOGS 2
+#define STORAGE_LOG_BUF 2048          // Log write coalescing buffer, two per log
+#define STORAGE_LOG_FLUSH_MS 1000     // Oldest unwritten log byte
+#define STORAGE_TASK_PRIORITY 3       // Below the audio tasks
+#define STORAGE_TASK_STACK 4096
+#define STORAGE_MAX_FILES 12          // FatFs handles: streams, logs, library reader and index build
+
+// Music library index (one file on the card, read through a page cache)
+#define LIBRARY_PATH "/library.idx"
+#define LIBRARY_STR_MAX 64            // Longest title/artist/album kept, bytes of UTF-8
+#define LIBRARY_PATH_MAX 128
+#define LIBRARY_PAGE 256              // Index cache page
+#define LIBRARY_CACHE_PAGES 8         // 2 KB of cache, all the RAM browsing needs
+#define LIBRARY_TAG_BYTES 2048        // File head read for tags
+#define LIBRARY_SORT_RUN 256          // Records per in-RAM sort run (12 KB while scanning)
+#define LIBRARY_MAX_RUNS 64           // Up to 16384 tracks
+#define LIBRARY_SCAN_STACK 6144
+
+// Play queue (the next track is opened and queued while one plays)
+#define PLAYER_QUEUE_MAX 16
+#define PLAYER_POLL_MS 50
+#define PLAYER_TASK_PRIORITY 2        // Below the storage task
+#define PLAYER_TASK_STACK 4096
+
+// Spectrum visualizer (drawn straight to the panel, outside LVGL)
+#define SPECTRUM_FFT_LOG2 8           // 256-point FFT
+#define SPECTRUM_DECIMATE 2           // Output frames averaged per FFT sample (0-5.5 kHz at 22.05 kHz)
+#define SPECTRUM_BARS 32
+#define SPECTRUM_PERIOD_MS 33         // 30 fps
+#define SPECTRUM_FALL 3               // Pixels a bar drops per frame
+#define SPECTRUM_FLOOR_LOG2 6         // Bin power shown as an empty bar
+#define SPECTRUM_TOP_LOG2 26          // Bin power of a full-scale sine, a full bar
+
+// Wall clock (system time runs on the RTC timer, also through light sleep)
+#define WALLCLOCK_TZ "UTC0"           // POSIX TZ of the local time shown
+#define WALLCLOCK_MAX_SUBS 4          // Tick subscribers
+#define WALLCLOCK_LIGHT_SLEEP 1       // Idle loop light-sleeps until the next tick it needs
+#define WALLCLOCK_SLEEP_MIN_MS 20     // Shorter waits are plain delays
+#define WALLCLOCK_SLEEP_IDLE_MS 3000  // No touch for this long before sleeping with the screen on
+#define WALLCLOCK_STEP_US 500000      // GPS offsets above this step the clock, smaller ones are slewed
+#define WALLCLOCK_GPS_INTERVAL_S 600  // Fixes applied at most this often (rate learning needs spacing)
+#define WALLCLOCK_DRIFT_MAX_PPB 500000
+#define WALLCLOCK_NMEA_LATENCY_MS 100 // Second boundary to RMC sentence arrival, without PPS
+#define CLOCK_SHOW_SECONDS 0
+#define CLOCK_DIGIT_FONT LV_FONT_DEFAULT
+#define CLOCK_ANALOG 1                // Dial above the digits
+#define CLOCK_DIAL_SIZE 180           // Dial sprite side, 63 KB
+#define CLOCK_STRIP_ROWS 24           // Rows composed per push while moving the hands
+
+// Virtualized list
+#define VLIST_MARGIN_ROWS 2           // Rows bound beyond each edge of the viewport
+#define VLIST_MOMENTUM_MS 16          // Fling step period
+#define VLIST_FRICTION 240            // Velocity kept per step, /256
+#define VLIST_TAP_SLOP 8              // Drag in pixels that still counts as a tap
+
+// Built-in benchmarks
+#define BENCH_ITERATIONS 20           // Repetitions per workload
 
 #define SCREEN_TIMEOUT_MS 30000 // 30 seconds timeout
 static uint32_t last_activity_time = 0;
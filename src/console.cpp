@@ -0,0 +1,203 @@
+#include "console.h"
+#include "display.h"
+#include "lvgl_init.h"
+#include "telemetry.h"
+#include "flight_recorder.h"
+#include "ui.h"
+#include "refresh_plan.h"
+
+struct ConsoleCommand {
+  const char* name;
+  const char* help;
+  console_handler_t handler;
+};
+
+static ConsoleCommand commands[CONSOLE_MAX_COMMANDS];
+static uint8_t command_count = 0;
+
+// Line being received; overlong lines are dropped whole
+static char line[CONSOLE_LINE_MAX];
+static uint16_t line_len = 0;
+static bool line_overflow = false;
+
+bool console_parse_uint(const char* text, uint32_t max, uint32_t* value) {
+  if (!text || !*text) return false;
+  uint32_t v = 0;
+  for (const char* p = text; *p; p++) {
+    if (*p < '0' || *p > '9') return false;
+    v = v * 10 + (*p - '0');
+    if (v > max) return false;
+  }
+  *value = v;
+  return true;
+}
+
+bool console_register(const char* name, const char* help, console_handler_t handler) {
+  if (command_count >= CONSOLE_MAX_COMMANDS) return false;
+  commands[command_count].name = name;
+  commands[command_count].help = help;
+  commands[command_count].handler = handler;
+  command_count++;
+  return true;
+}
+
+static void cmd_help(int argc, char** argv) {
+  for (uint8_t i = 0; i < command_count; i++) {
+    Serial.printf("  %-8s %s\n", commands[i].name, commands[i].help);
+  }
+}
+
+static void cmd_backlight(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 1) {
+    if (!console_parse_uint(argv[1], 255, &value)) {
+      Serial.println("usage: bl [0-255]");
+      return;
+    }
+    set_screen_brightness(value);
+  }
+  Serial.printf("bl=%u\n", get_screen_brightness());
+}
+
+static void cmd_led(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 1) {
+    if (!console_parse_uint(argv[1], 255, &value)) {
+      Serial.println("usage: led [0-255]");
+      return;
+    }
+    set_led_brightness(value);
+  }
+  Serial.printf("led=%u\n", get_led_brightness());
+}
+
+static void cmd_mem(int argc, char** argv) {
+  telemetry_print();
+}
+
+static void cmd_rec(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+    flight_recorder_clear();
+    Serial.println("rec cleared");
+    return;
+  }
+  flight_recorder_dump();
+}
+
+static void cmd_prof(int argc, char** argv) {
+  FrameStats stats;
+  lvgl_get_frame_stats(&stats, false);
+  Serial.printf("PROF,frames=%u,avg_ms=%u,max_ms=%u,px=%u\n", stats.frames,
+                stats.frames ? stats.time_sum_ms / stats.frames : 0, stats.time_max_ms, stats.px_sum);
+}
+
+static void cmd_plan(int argc, char** argv) {
+  RefreshPlanStats s;
+  refresh_plan_get_stats(&s, argc > 1 && strcmp(argv[1], "reset") == 0);
+  uint32_t f = s.frames ? s.frames : 1;
+  Serial.printf("PLAN,frames=%u,areas=%u,windows_lvgl=%u,windows=%u,bytes_lvgl=%u,bytes=%u,"
+                "windows_saved_per_frame=%d,bytes_saved_per_frame=%d\n",
+                s.frames, s.areas_in, s.windows_lvgl, s.windows_planned, s.bytes_lvgl, s.bytes_planned,
+                ((int32_t)s.windows_lvgl - (int32_t)s.windows_planned) / (int32_t)f,
+                ((int32_t)s.bytes_lvgl - (int32_t)s.bytes_planned) / (int32_t)f);
+
+  FlushStats fs;
+  display_get_flush_stats(&fs);
+  Serial.printf("FLUSH,areas=%u,windows=%u,tiles_sent=%u,tiles_skipped=%u,bytes=%u,bytes_saved=%u\n",
+                fs.areas, fs.windows, fs.tiles_sent, fs.tiles_skipped, fs.bytes_total, fs.bytes_saved);
+}
+
+static void cmd_rot(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 1) {
+    if (!console_parse_uint(argv[1], 3, &value)) {
+      Serial.println("usage: rot [0-3]");
+      return;
+    }
+    lvgl_set_rotation(value);
+  }
+  TFT_eSPI* tft = display_get_tft();
+  Serial.printf("rot=%u (%dx%d)\n", lvgl_get_rotation(), tft->width(), tft->height());
+}
+
+static void cmd_refr(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 1) {
+    if (!console_parse_uint(argv[1], 1000, &value) || value == 0) {
+      Serial.println("usage: refr [1-1000]");
+      return;
+    }
+    lvgl_set_refresh_period(value);
+  }
+  Serial.printf("refr=%u ms\n", lvgl_get_refresh_period());
+}
+
+static void cmd_buf(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 1) {
+    if (!console_parse_uint(argv[1], LVGL_BUFFER_ROWS, &value) || !lvgl_set_buffer_rows(value)) {
+      Serial.printf("usage: buf [1-%d]\n", LVGL_BUFFER_ROWS);
+      return;
+    }
+  }
+  Serial.printf("buf=%u rows\n", lvgl_get_buffer_rows());
+}
+
+void console_init() {
+  console_register("help", "list commands", cmd_help);
+  console_register("bl", "[0-255] get/set backlight", cmd_backlight);
+  console_register("led", "[0-255] get/set LED level", cmd_led);
+  console_register("mem", "print memory high-water marks", cmd_mem);
+  console_register("rec", "[clear] dump flight recorder", cmd_rec);
+  console_register("prof", "print frame statistics", cmd_prof);
+  console_register("plan", "[reset] refresh planner and flush filter statistics", cmd_plan);
+  console_register("rot", "[0-3] get/set panel rotation (1/3 landscape)", cmd_rot);
+  console_register("refr", "[ms] get/set LVGL refresh period", cmd_refr);
+  console_register("buf", "[rows] get/set draw buffer height", cmd_buf);
+}
+
+static void console_execute(char* text) {
+  char* argv[CONSOLE_MAX_ARGS];
+  int argc = 0;
+
+  // Split on spaces in place
+  char* p = text;
+  while (*p && argc < CONSOLE_MAX_ARGS) {
+    while (*p == ' ' || *p == '\t') *p++ = '\0';
+    if (!*p) break;
+    argv[argc++] = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+  }
+  if (argc == 0) return;
+
+  for (uint8_t i = 0; i < command_count; i++) {
+    if (strcmp(commands[i].name, argv[0]) == 0) {
+      commands[i].handler(argc, argv);
+      return;
+    }
+  }
+  Serial.printf("unknown command: %s (try help)\n", argv[0]);
+}
+
+void console_poll() {
+  int avail = Serial.available();
+  while (avail-- > 0) {
+    int c = Serial.read();
+    if (c < 0) break;
+
+    if (c == '\r' || c == '\n') {
+      if (line_overflow) {
+        Serial.println("line too long");
+      } else if (line_len > 0) {
+        line[line_len] = '\0';
+        console_execute(line);
+      }
+      line_len = 0;
+      line_overflow = false;
+    } else if (line_len < CONSOLE_LINE_MAX - 1) {
+      line[line_len++] = (char)c;
+    } else {
+      line_overflow = true;
+    }
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Command handler: argv[0] is the command name
+typedef void (*console_handler_t)(int argc, char** argv);
+
+// Register the built-in commands
+void console_init();
+
+// Add a command (name and help must stay valid, usually string literals)
+bool console_register(const char* name, const char* help, console_handler_t handler);
+
+// Read pending serial input and run complete lines, never blocks
+void console_poll();
+
+// Parse an unsigned decimal argument, returns false if malformed or above max
+bool console_parse_uint(const char* text, uint32_t max, uint32_t* value);
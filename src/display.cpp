@@ -1,34 +1,267 @@
 #include <lvgl.h>
+#include <driver/ledc.h>
+#include <esp_sleep.h>
 #include "display.h"
+#include "splash.h"
+#include "boot.h"
 
 // TFT Display object
 static TFT_eSPI tft = TFT_eSPI();
 
+#if LV_COLOR_DEPTH == 8
+#define FLUSH_CHUNK_PX (SCREEN_WIDTH * 2)
+
+// RGB332 to RGB565 in panel byte order, full range per channel
+static uint16_t rgb332_lut[256];
+
+// Expanded pixels alternate between two buffers so expansion overlaps DMA
+static uint16_t flush_buf[2][FLUSH_CHUNK_PX] __attribute__((aligned(4)));
+static uint8_t flush_sel = 0;
+
+static void build_rgb332_lut() {
+  for (int i = 0; i < 256; i++) {
+    uint16_t r = (((i >> 5) & 0x07) * 31 + 3) / 7;
+    uint16_t g = (((i >> 2) & 0x07) * 63 + 3) / 7;
+    uint16_t b = ((i & 0x03) * 31 + 1) / 3;
+    uint16_t c = (r << 11) | (g << 5) | b;
+    rgb332_lut[i] = (c >> 8) | (c << 8);
+  }
+}
+
+static void FAST_MEM_ATTR push_chunk(uint16_t* out, uint32_t n) {
+  if (tft.DMA_Enabled) {
+    tft.pushPixelsDMA(out, n);  // Waits for the previous chunk
+    flush_sel ^= 1;
+  } else {
+    tft.pushPixels(out, n);
+  }
+}
+
+// Rows of w pixels, stride apart in the source
+static void FAST_MEM_ATTR push_rgb332(const uint8_t* src, uint32_t w, uint32_t h, uint32_t stride) {
+  bool swap = tft.getSwapBytes();
+  tft.setSwapBytes(false);
+  uint16_t* out = flush_buf[flush_sel];
+  uint32_t n = 0;
+  for (uint32_t y = 0; y < h; y++, src += stride) {
+    for (uint32_t x = 0; x < w;) {
+      uint32_t m = w - x < FLUSH_CHUNK_PX - n ? w - x : FLUSH_CHUNK_PX - n;
+      for (uint32_t i = 0; i < m; i++) out[n + i] = rgb332_lut[src[x + i]];
+      n += m;
+      x += m;
+      if (n == FLUSH_CHUNK_PX) {
+        push_chunk(out, n);
+        out = flush_buf[flush_sel];
+        n = 0;
+      }
+    }
+  }
+  // pushPixels does not wait for DMA, so the tail goes the same way
+  if (n) push_chunk(out, n);
+  if (tft.DMA_Enabled) tft.dmaWait();
+  tft.setSwapBytes(swap);
+}
+#endif
+
+// Send a w x h block of LVGL pixels, stride pixels apart, to one address window
+static void FAST_MEM_ATTR send_rect(int32_t x, int32_t y, int32_t w, int32_t h, const lv_color_t* src, int32_t stride) {
+  tft.setAddrWindow(x, y, w, h);
+#if LV_COLOR_DEPTH == 8
+  push_rgb332((const uint8_t*)src, w, h, stride);
+#else
+  if (stride == w) {
+    tft.pushColors((uint16_t*)src, w * h, true);
+  } else {
+    for (int32_t r = 0; r < h; r++) tft.pushColors((uint16_t*)(src + r * stride), w, true);
+  }
+#endif
+}
+
+#if DISPLAY_TILE_FILTER
+#define TILE DISPLAY_TILE_SIZE
+#define TILE_MAX (((SCREEN_WIDTH + TILE - 1) / TILE) * ((SCREEN_HEIGHT + TILE - 1) / TILE))
+
+// Hash of the pixels last sent for each whole tile, 0 = unknown
+static uint32_t tile_hash[TILE_MAX];
+static FlushStats flush_stats;
+
+static uint32_t FAST_MEM_ATTR hash_block(const lv_color_t* src, int32_t w, int32_t h, int32_t stride) {
+  uint32_t hash = 2166136261u;
+  for (int32_t r = 0; r < h; r++, src += stride) {
+    for (int32_t i = 0; i < w; i++) hash = (hash ^ src[i].full) * 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
+// Send only the tiles whose pixels differ from what the panel already shows.
+// Each tile row becomes one address window per run of changed tiles.
+static void FAST_MEM_ATTR flush_tiles(const lv_area_t* area, const lv_color_t* color_p) {
+  const int32_t aw = area->x2 - area->x1 + 1;
+  const int32_t pw = tft.width();
+  const int32_t ph = tft.height();
+  const int32_t tiles_x = (pw + TILE - 1) / TILE;
+  flush_stats.areas++;
+
+  for (int32_t y = area->y1; y <= area->y2;) {
+    int32_t ty = y / TILE;
+    int32_t y_end = min<int32_t>(area->y2, ty * TILE + TILE - 1);
+    int32_t bh = y_end - y + 1;
+    bool whole_rows = (y == ty * TILE) && (y_end == ty * TILE + TILE - 1 || y_end == ph - 1);
+    const lv_color_t* band = color_p + (y - area->y1) * aw;
+
+    int32_t run_x = -1, run_end = 0;
+    for (int32_t tx = area->x1 / TILE; tx * TILE <= area->x2; tx++) {
+      int32_t x0 = max<int32_t>(area->x1, tx * TILE);
+      int32_t x1 = min<int32_t>(area->x2, tx * TILE + TILE - 1);
+      bool whole = whole_rows && x0 == tx * TILE && (x1 == tx * TILE + TILE - 1 || x1 == pw - 1);
+      int32_t idx = ty * tiles_x + tx;
+
+      bool changed = true;
+      if (idx < TILE_MAX) {
+        if (whole) {
+          uint32_t hash = hash_block(band + (x0 - area->x1), x1 - x0 + 1, bh, aw);
+          changed = hash != tile_hash[idx];
+          tile_hash[idx] = hash;
+        } else {
+          tile_hash[idx] = 0;  // Partly covered, contents no longer known
+        }
+      }
+
+      if (changed) {
+        if (run_x < 0) run_x = x0;
+        run_end = x1;
+        flush_stats.tiles_sent++;
+      } else {
+        if (run_x >= 0) {
+          send_rect(run_x, y, run_end - run_x + 1, bh, band + (run_x - area->x1), aw);
+          flush_stats.windows++;
+          run_x = -1;
+        }
+        flush_stats.tiles_skipped++;
+        flush_stats.bytes_saved += (x1 - x0 + 1) * bh * 2;
+      }
+    }
+    if (run_x >= 0) {
+      send_rect(run_x, y, run_end - run_x + 1, bh, band + (run_x - area->x1), aw);
+      flush_stats.windows++;
+    }
+    y = y_end + 1;
+  }
+}
+#endif
+
 void display_init() {
   // Initialize display
   tft.init();
-  tft.setRotation(0);  // Match your physical screen orientation
+  tft.setRotation(DISPLAY_ROTATION);  // Use lvgl_set_rotation() to change it later
+#if DISPLAY_DMA
+  tft.initDMA();
+#endif
+#if LV_COLOR_DEPTH == 8
+  build_rgb332_lut();
+#endif
+
+  // Show the last UI frame while the rest of init runs
+#if SPLASH_ENABLED
+  if (splash_show(&tft)) {
+    boot_mark("splash");
+    return;
+  }
+#endif
   tft.fillScreen(TFT_BLACK);
-  
+}
+
+// Backlight PWM on a low-speed LEDC timer clocked from RTC8M_CLK rather than
+// APB, so it keeps running through light sleep while that domain is powered.
+// Channel and timer 0 of the low-speed group; analogWrite takes channels from
+// the top of it.
+#define BACKLIGHT_CHANNEL LEDC_CHANNEL_0
+#define BACKLIGHT_TIMER LEDC_TIMER_0
+
+static bool backlight_ready = false;
+
+static void backlight_init() {
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = LEDC_LOW_SPEED_MODE;
+  timer.duty_resolution = LEDC_TIMER_8_BIT;
+  timer.timer_num = BACKLIGHT_TIMER;
+  timer.freq_hz = BACKLIGHT_PWM_HZ;
+  timer.clk_cfg = LEDC_USE_RTC8M_CLK;
+  ledc_timer_config(&timer);
+
+  ledc_channel_config_t channel = {};
+  channel.gpio_num = TFT_BL;
+  channel.speed_mode = LEDC_LOW_SPEED_MODE;
+  channel.channel = BACKLIGHT_CHANNEL;
+  channel.timer_sel = BACKLIGHT_TIMER;
+  channel.duty = 0;
+  ledc_channel_config(&channel);
+  backlight_ready = true;
 }
 
 void display_set_backlight(uint8_t brightness) {
-  analogWrite(TFT_BL, brightness);        // Write brightness (0-255)
+  if (!backlight_ready) backlight_init();
+  // 255 is fully on (a duty of 256 at 8 bits), as analogWrite does
+  ledc_set_duty(LEDC_LOW_SPEED_MODE, BACKLIGHT_CHANNEL, brightness == 255 ? 256 : brightness);
+  ledc_update_duty(LEDC_LOW_SPEED_MODE, BACKLIGHT_CHANNEL);
+  // RTC8M_CLK stays on in light sleep only while the backlight is lit
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC8M, brightness ? ESP_PD_OPTION_ON : ESP_PD_OPTION_AUTO);
 }
 
 TFT_eSPI* display_get_tft() {
   return &tft;
 }
 
-void display_flush_cb(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
+void FAST_MEM_ATTR display_flush_cb(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
   
   tft.startWrite();
-  tft.setAddrWindow(area->x1, area->y1, w, h);
-  tft.pushColors((uint16_t *)color_p, w * h, true);
+#if DISPLAY_TILE_FILTER
+  flush_tiles(area, color_p);
+  flush_stats.bytes_total += w * h * 2;
+#else
+  send_rect(area->x1, area->y1, w, h, color_p, w);
+#endif
   tft.endWrite();
   
   lv_disp_flush_ready(disp);
 }
 
+void display_rounder_cb(lv_disp_drv_t *disp, lv_area_t *area) {
+#if DISPLAY_TILE_FILTER
+  // Whole tiles across; whole tile rows too when a buffer chunk can hold them
+  area->x1 = area->x1 / TILE * TILE;
+  area->x2 = min<int32_t>(disp->hor_res - 1, area->x2 / TILE * TILE + TILE - 1);
+  if (disp->draw_buf->size / disp->hor_res >= TILE) {
+    area->y1 = area->y1 / TILE * TILE;
+    area->y2 = min<int32_t>(disp->ver_res - 1, area->y2 / TILE * TILE + TILE - 1);
+  }
+#endif
+}
+
+void display_invalidate_tiles(int32_t x, int32_t y, int32_t w, int32_t h) {
+#if DISPLAY_TILE_FILTER
+  const int32_t tiles_x = (tft.width() + TILE - 1) / TILE;
+  if (w <= 0 || h <= 0) return;
+  for (int32_t ty = max<int32_t>(0, y) / TILE; ty <= (y + h - 1) / TILE; ty++) {
+    for (int32_t tx = max<int32_t>(0, x) / TILE; tx <= (x + w - 1) / TILE && tx < tiles_x; tx++) {
+      if (ty * tiles_x + tx < TILE_MAX) tile_hash[ty * tiles_x + tx] = 0;
+    }
+  }
+#endif
+}
+
+void display_invalidate_all_tiles() {
+#if DISPLAY_TILE_FILTER
+  memset(tile_hash, 0, sizeof(tile_hash));
+#endif
+}
+
+void display_get_flush_stats(FlushStats* stats) {
+#if DISPLAY_TILE_FILTER
+  *stats = flush_stats;
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
@@ -13,3 +13,20 @@ TFT_eSPI* display_get_tft();
 // LVGL display flush callback
 void display_flush_cb(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p);
 
+// Flush filter: the flush keeps a hash per tile of the pixels last sent and
+// skips tiles that have not changed. The rounder aligns areas to tiles.
+struct FlushStats {
+  uint32_t areas;          // Areas flushed by LVGL
+  uint32_t windows;        // Address windows actually sent
+  uint32_t tiles_sent;
+  uint32_t tiles_skipped;
+  uint32_t bytes_total;    // Panel bytes LVGL asked for
+  uint32_t bytes_saved;    // Panel bytes skipped as unchanged
+};
+void display_rounder_cb(lv_disp_drv_t *disp, lv_area_t *area);
+void display_get_flush_stats(FlushStats* stats);
+
+// Forget tile contents after drawing to the panel outside LVGL
+void display_invalidate_tiles(int32_t x, int32_t y, int32_t w, int32_t h);
+void display_invalidate_all_tiles();
+
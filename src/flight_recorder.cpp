@@ -0,0 +1,139 @@
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_heap_caps.h>
+#include <lvgl.h>
+#include "flight_recorder.h"
+#include "lvgl_init.h"
+
+#define FLIGHT_LOG_MAGIC   0x464C5452  // "FLTR"
+#define FLIGHT_LOG_VERSION 1
+
+struct BootRecord {
+  uint16_t boot;
+  uint8_t  reset_reason;  // esp_reset_reason_t
+  uint8_t  reserved;
+};
+
+// Survives soft resets, panics and watchdog resets; lost on power-on
+struct FlightLog {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t boot_count;
+  uint16_t head;
+  uint16_t count;
+  uint16_t boot_head;
+  uint16_t boot_entries;
+  FlightRecord records[FLIGHT_RECORDER_ENTRIES];
+  BootRecord boots[FLIGHT_RECORDER_BOOTS];
+};
+
+static RTC_NOINIT_ATTR FlightLog flight_log;
+
+static lv_timer_t* record_timer = NULL;
+static uint32_t busy_us = 0;
+static uint32_t interval_start_us = 0;
+
+static const char* reset_reason_name(uint8_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON:   return "poweron";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "int_wdt";
+    case ESP_RST_TASK_WDT:  return "task_wdt";
+    case ESP_RST_WDT:       return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+  }
+}
+
+static bool log_valid() {
+  return flight_log.magic == FLIGHT_LOG_MAGIC &&
+         flight_log.version == FLIGHT_LOG_VERSION &&
+         flight_log.head < FLIGHT_RECORDER_ENTRIES &&
+         flight_log.count <= FLIGHT_RECORDER_ENTRIES &&
+         flight_log.boot_head < FLIGHT_RECORDER_BOOTS &&
+         flight_log.boot_entries <= FLIGHT_RECORDER_BOOTS;
+}
+
+void flight_recorder_clear() {
+  memset(&flight_log, 0, sizeof(flight_log));
+  flight_log.magic = FLIGHT_LOG_MAGIC;
+  flight_log.version = FLIGHT_LOG_VERSION;
+}
+
+void flight_recorder_init() {
+  esp_reset_reason_t reason = esp_reset_reason();
+
+  // RTC memory holds garbage after power-on
+  if (reason == ESP_RST_POWERON || !log_valid()) {
+    flight_recorder_clear();
+  }
+
+  flight_log.boot_count++;
+  BootRecord* b = &flight_log.boots[flight_log.boot_head];
+  b->boot = flight_log.boot_count;
+  b->reset_reason = (uint8_t)reason;
+  flight_log.boot_head = (flight_log.boot_head + 1) % FLIGHT_RECORDER_BOOTS;
+  if (flight_log.boot_entries < FLIGHT_RECORDER_BOOTS) flight_log.boot_entries++;
+}
+
+static void flight_recorder_record() {
+  uint32_t now = micros();
+  uint32_t elapsed = now - interval_start_us;
+  interval_start_us = now;
+
+  FrameStats stats;
+  lvgl_get_frame_stats(&stats, true);
+
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+
+  FlightRecord* r = &flight_log.records[flight_log.head];
+  r->uptime_s = millis() / 1000;
+  r->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  r->boot = flight_log.boot_count;
+  r->frames = stats.frames > 0xFFFF ? 0xFFFF : stats.frames;
+  r->frame_avg_ms = stats.frames ? stats.time_sum_ms / stats.frames : 0;
+  r->frame_max_ms = stats.time_max_ms > 0xFFFF ? 0xFFFF : stats.time_max_ms;
+  uint32_t load = elapsed ? (uint64_t)busy_us * 100 / elapsed : 0;
+  r->loop_load_pct = load > 100 ? 100 : load;
+  r->lv_used_pct = mon.used_pct;
+  r->lv_frag_pct = mon.frag_pct;
+  busy_us = 0;
+
+  flight_log.head = (flight_log.head + 1) % FLIGHT_RECORDER_ENTRIES;
+  if (flight_log.count < FLIGHT_RECORDER_ENTRIES) flight_log.count++;
+}
+
+void flight_recorder_start() {
+  interval_start_us = micros();
+  busy_us = 0;
+  record_timer = lv_timer_create([](lv_timer_t* timer) {
+    flight_recorder_record();
+  }, FLIGHT_RECORDER_PERIOD_MS, NULL);
+}
+
+void flight_recorder_note_busy(uint32_t us) {
+  busy_us += us;
+}
+
+void flight_recorder_dump() {
+  Serial.printf("Flight recorder: boot %u, %u records\n", flight_log.boot_count, flight_log.count);
+
+  for (uint16_t i = 0; i < flight_log.boot_entries; i++) {
+    uint16_t idx = (flight_log.boot_head + FLIGHT_RECORDER_BOOTS - flight_log.boot_entries + i) % FLIGHT_RECORDER_BOOTS;
+    BootRecord* b = &flight_log.boots[idx];
+    Serial.printf("BOOT,%u,%s\n", b->boot, reset_reason_name(b->reset_reason));
+  }
+
+  Serial.println("REC,boot,uptime_s,frames,frame_avg_ms,frame_max_ms,loop_load_pct,heap_min_free,lv_used_pct,lv_frag_pct");
+  for (uint16_t i = 0; i < flight_log.count; i++) {
+    uint16_t idx = (flight_log.head + FLIGHT_RECORDER_ENTRIES - flight_log.count + i) % FLIGHT_RECORDER_ENTRIES;
+    FlightRecord* r = &flight_log.records[idx];
+    Serial.printf("REC,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", r->boot, r->uptime_s, r->frames, r->frame_avg_ms,
+                  r->frame_max_ms, r->loop_load_pct, r->heap_min_free, r->lv_used_pct, r->lv_frag_pct);
+  }
+}
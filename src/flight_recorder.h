@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// One periodic sample kept in RTC slow memory
+struct FlightRecord {
+  uint32_t uptime_s;       // Seconds since the boot that wrote the record
+  uint32_t heap_min_free;  // Internal heap low-water mark since boot
+  uint16_t boot;           // Boot number that wrote the record
+  uint16_t frames;         // LVGL refreshes in the interval
+  uint16_t frame_avg_ms;   // Average refresh time in the interval
+  uint16_t frame_max_ms;   // Slowest refresh in the interval
+  uint8_t  loop_load_pct;  // Share of the interval the loop task was busy
+  uint8_t  lv_used_pct;    // LVGL pool usage at the end of the interval
+  uint8_t  lv_frag_pct;    // LVGL pool fragmentation at the end of the interval
+  uint8_t  reserved;
+};
+
+// Validate or reset the RTC log and record this boot's reset reason
+void flight_recorder_init();
+
+// Start periodic recording (call after LVGL is initialized)
+void flight_recorder_start();
+
+// Account time the loop task spent working (excluding its idle delay)
+void flight_recorder_note_busy(uint32_t busy_us);
+
+// Print boot history and recorded samples, oldest first
+void flight_recorder_dump();
+
+// Forget everything recorded so far
+void flight_recorder_clear();
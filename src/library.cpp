@@ -0,0 +1,962 @@
+#include <SD.h>
+#include "library.h"
+#include "console.h"
+#include "storage.h"
+#include "telemetry.h"
+
+// Build files, hidden (leading dot) so the scan skips them
+#define LIB_NEW_PATH     "/.library.new"
+#define LIB_DIRS_TMP     "/.lib_dirs.tmp"
+#define LIB_RECORDS_TMP  "/.lib_recs.tmp"
+#define LIB_KEYS_TMP     "/.lib_keys.tmp"
+#define LIB_SORTED_TMP   "/.lib_sorted.tmp"
+#define LIB_RUNS_TMP     "/.lib_runs.tmp"
+#define LIB_STRINGS_TMP  "/.lib_str.tmp"
+#define LIB_TRACKS_TMP   "/.lib_trk.tmp"
+#define LIB_GROUPS_TMP   "/.lib_grp.tmp"
+#define LIB_PATHS_TMP    "/.lib_paths.tmp"
+#define LIB_PSORTED_TMP  "/.lib_psorted.tmp"
+
+#define LIB_MAGIC "CYDL"
+#define LIB_VERSION 2
+#define LIBRARY_MAX_TRACKS (LIBRARY_SORT_RUN * LIBRARY_MAX_RUNS)
+
+static_assert(LIBRARY_SORT_RUN >= LIBRARY_MAX_RUNS, "every run needs a merge buffer slot");
+static_assert(LIBRARY_TAG_BYTES >= 8 + LIBRARY_PATH_MAX + 3 * LIBRARY_STR_MAX, "a track record must fit the tag buffer");
+
+// On-disk layout: header, then the tables, then the string pool. String
+// fields are offsets into the pool.
+struct IndexHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t tracks;
+  uint32_t artists;
+  uint32_t albums;
+  uint32_t tracks_off;    // TrackRec[tracks], artist/album/title order
+  uint32_t artists_off;   // ArtistRec[artists]
+  uint32_t albums_off;    // AlbumRec[albums]
+  uint32_t titles_off;    // uint32_t[tracks], track indices in title order
+  uint32_t paths_off;     // PathRec[tracks], by path hash, for rescans
+  uint32_t strings_off;   // NUL-terminated UTF-8
+};
+
+struct TrackRec {
+  uint32_t title;
+  uint32_t path;
+  uint16_t artist;
+  uint16_t album;
+  uint32_t size;          // File size and last write when the tags were read;
+  uint32_t mtime;         // a rescan keeps the tags while both match
+};
+
+// Path lookup for rescans, ordered by hash
+struct PathRec {
+  uint32_t hash;
+  uint32_t track;
+};
+
+struct ArtistRec {
+  uint32_t name;
+  uint32_t first;         // First track; the range ends at the next artist's
+};
+
+struct AlbumRec {
+  uint32_t name;
+  uint32_t first;
+  uint16_t artist;
+  uint16_t reserved;
+};
+
+// Sort record for the external merge sort: key, then a payload
+struct SortRec {
+  char key[44];
+  uint32_t ref;
+};
+
+// Artist or album boundary found while emitting the sorted tracks
+struct GroupRec {
+  uint32_t name;
+  uint32_t first;
+  uint16_t artist;
+  uint8_t is_album;
+  uint8_t reserved;
+};
+
+struct TagText {
+  char title[LIBRARY_STR_MAX];
+  char artist[LIBRARY_STR_MAX];
+  char album[LIBRARY_STR_MAX];
+};
+
+struct CachePage {
+  uint32_t page;          // UINT32_MAX when empty
+  uint32_t stamp;
+  uint8_t data[LIBRARY_PAGE];
+};
+
+static SemaphoreHandle_t lib_lock = NULL;
+static File index_file;
+static IndexHeader hdr;
+static bool index_ready = false;
+
+static CachePage cache[LIBRARY_CACHE_PAGES];
+static uint32_t cache_clock = 0;
+
+static volatile bool scanning = false;
+static LibraryStats stats;
+
+/***************************************************************************************
+** Index reader
+***************************************************************************************/
+
+static void cache_clear() {
+  for (int i = 0; i < LIBRARY_CACHE_PAGES; i++) cache[i].page = UINT32_MAX;
+}
+
+static const uint8_t* cache_page(uint32_t page) {
+  CachePage* victim = &cache[0];
+  for (int i = 0; i < LIBRARY_CACHE_PAGES; i++) {
+    if (cache[i].page == page) {
+      cache[i].stamp = ++cache_clock;
+      stats.cache_hits++;
+      return cache[i].data;
+    }
+    if (cache[i].page == UINT32_MAX || cache[i].stamp < victim->stamp) victim = &cache[i];
+  }
+
+  stats.cache_misses++;
+  if (!index_file.seek(page * LIBRARY_PAGE)) return NULL;
+  int n = index_file.read(victim->data, LIBRARY_PAGE);
+  if (n <= 0) return NULL;
+  memset(victim->data + n, 0, LIBRARY_PAGE - n);
+  victim->page = page;
+  victim->stamp = ++cache_clock;
+  return victim->data;
+}
+
+static bool read_at(uint32_t off, void* dst, size_t len) {
+  uint8_t* d = (uint8_t*)dst;
+  while (len) {
+    const uint8_t* p = cache_page(off / LIBRARY_PAGE);
+    if (!p) return false;
+    uint32_t o = off % LIBRARY_PAGE;
+    size_t n = min(len, (size_t)(LIBRARY_PAGE - o));
+    memcpy(d, p + o, n);
+    d += n;
+    off += n;
+    len -= n;
+  }
+  return true;
+}
+
+static void read_string(uint32_t off, char* dst, size_t max) {
+  size_t i = 0;
+  off += hdr.strings_off;
+  while (i + 1 < max) {
+    const uint8_t* p = cache_page(off / LIBRARY_PAGE);
+    if (!p) break;
+    char c = p[off % LIBRARY_PAGE];
+    if (!c) break;
+    dst[i++] = c;
+    off++;
+  }
+  dst[i] = 0;
+}
+
+// Caller holds lib_lock
+static void open_index() {
+  cache_clear();
+  index_ready = false;
+  if (index_file) index_file.close();
+  index_file = SD.open(LIBRARY_PATH, FILE_READ);
+  if (!index_file) return;
+  if (index_file.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+      memcmp(hdr.magic, LIB_MAGIC, 4) != 0 || hdr.version != LIB_VERSION) {
+    index_file.close();
+    return;
+  }
+  index_ready = true;
+}
+
+uint32_t library_track_count() {
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  uint32_t n = index_ready ? hdr.tracks : 0;
+  xSemaphoreGive(lib_lock);
+  return n;
+}
+
+bool library_get_track(uint32_t index, LibraryTrack* track) {
+  bool ok = false;
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  TrackRec rec;
+  AlbumRec album;
+  ArtistRec artist;
+  if (index_ready && index < hdr.tracks && read_at(hdr.tracks_off + index * sizeof(rec), &rec, sizeof(rec)) &&
+      read_at(hdr.albums_off + rec.album * sizeof(album), &album, sizeof(album)) &&
+      read_at(hdr.artists_off + rec.artist * sizeof(artist), &artist, sizeof(artist))) {
+    read_string(rec.title, track->title, sizeof(track->title));
+    read_string(rec.path, track->path, sizeof(track->path));
+    read_string(artist.name, track->artist, sizeof(track->artist));
+    read_string(album.name, track->album, sizeof(track->album));
+    track->artist_id = rec.artist;
+    track->album_id = rec.album;
+    ok = true;
+  }
+  xSemaphoreGive(lib_lock);
+  return ok;
+}
+
+// Artists and albums share the layout of their first two fields. The table
+// and count are read under lib_lock: a finished scan swaps hdr.
+static bool get_group(bool albums, uint32_t id, char* name, size_t len, uint32_t* first, uint32_t* n) {
+  bool ok = false;
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  uint32_t table = albums ? hdr.albums_off : hdr.artists_off;
+  uint32_t rec_size = albums ? sizeof(AlbumRec) : sizeof(ArtistRec);
+  uint32_t count = albums ? hdr.albums : hdr.artists;
+  ArtistRec rec, next;
+  if (index_ready && id < count && read_at(table + id * rec_size, &rec, sizeof(rec))) {
+    next.first = hdr.tracks;
+    if (id + 1 < count) read_at(table + (id + 1) * rec_size, &next, sizeof(next));
+    read_string(rec.name, name, len);
+    *first = rec.first;
+    *n = next.first - rec.first;
+    ok = true;
+  }
+  xSemaphoreGive(lib_lock);
+  return ok;
+}
+
+bool library_get_artist(uint32_t id, char* name, size_t len, uint32_t* first, uint32_t* count) {
+  return get_group(false, id, name, len, first, count);
+}
+
+bool library_get_album(uint32_t id, char* name, size_t len, uint32_t* first, uint32_t* count) {
+  return get_group(true, id, name, len, first, count);
+}
+
+static uint32_t title_track_locked(uint32_t pos) {
+  uint32_t track = UINT32_MAX;
+  if (index_ready && pos < hdr.tracks) read_at(hdr.titles_off + pos * 4, &track, 4);
+  return track;
+}
+
+uint32_t library_title_track(uint32_t pos) {
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  uint32_t track = title_track_locked(pos);
+  xSemaphoreGive(lib_lock);
+  return track;
+}
+
+// Compare a prefix with the start of a title, ASCII case-insensitive
+static int compare_prefix(const char* prefix, const char* title) {
+  for (; *prefix; prefix++, title++) {
+    int d = toupper((uint8_t)*prefix) - toupper((uint8_t)*title);
+    if (d) return d;
+  }
+  return 0;
+}
+
+int32_t library_find_title(const char* prefix) {
+  int32_t found = -1;
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  if (index_ready) {
+    // Lower bound over the title order: about log2(tracks) page lookups
+    uint32_t lo = 0, hi = hdr.tracks;
+    char title[LIBRARY_STR_MAX];
+    TrackRec rec;
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      read_at(hdr.tracks_off + title_track_locked(mid) * sizeof(rec), &rec, sizeof(rec));
+      read_string(rec.title, title, sizeof(title));
+      if (compare_prefix(prefix, title) > 0) lo = mid + 1;
+      else hi = mid;
+    }
+    if (lo < hdr.tracks) {
+      read_at(hdr.tracks_off + title_track_locked(lo) * sizeof(rec), &rec, sizeof(rec));
+      read_string(rec.title, title, sizeof(title));
+      if (compare_prefix(prefix, title) == 0) found = lo;
+    }
+  }
+  xSemaphoreGive(lib_lock);
+  return found;
+}
+
+void library_get_stats(LibraryStats* out) {
+  *out = stats;
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  out->tracks = index_ready ? hdr.tracks : 0;
+  out->artists = index_ready ? hdr.artists : 0;
+  out->albums = index_ready ? hdr.albums : 0;
+  xSemaphoreGive(lib_lock);
+  out->scanning = scanning;
+}
+
+/***************************************************************************************
+** Tag parsing (first LIBRARY_TAG_BYTES of the file)
+***************************************************************************************/
+
+static uint32_t le32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint32_t be32(const uint8_t* p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+static uint32_t syncsafe(const uint8_t* p) { return (p[0] & 0x7F) << 21 | (p[1] & 0x7F) << 14 | (p[2] & 0x7F) << 7 | (p[3] & 0x7F); }
+
+static size_t put_utf8(char* dst, size_t i, uint32_t cp) {
+  if (cp < 0x80) {
+    if (i + 1 >= LIBRARY_STR_MAX) return i;
+    dst[i++] = cp;
+  } else if (cp < 0x800) {
+    if (i + 2 >= LIBRARY_STR_MAX) return i;
+    dst[i++] = 0xC0 | cp >> 6;
+    dst[i++] = 0x80 | (cp & 0x3F);
+  } else {
+    if (i + 3 >= LIBRARY_STR_MAX) return i;
+    dst[i++] = 0xE0 | cp >> 12;
+    dst[i++] = 0x80 | (cp >> 6 & 0x3F);
+    dst[i++] = 0x80 | (cp & 0x3F);
+  }
+  return i;
+}
+
+// Store a tag value as UTF-8 unless the field is already set.
+// enc: 0 Latin-1, 1 UTF-16 with BOM, 2 UTF-16BE, 3 UTF-8 (ID3 numbering)
+static void put_text(char* dst, const uint8_t* s, size_t len, uint8_t enc) {
+  if (dst[0]) return;
+  size_t i = 0;
+  if (enc == 1 || enc == 2) {
+    bool le = false;
+    if (enc == 1 && len >= 2) {
+      le = s[0] == 0xFF;
+      s += 2;
+      len -= 2;
+    }
+    for (size_t k = 0; k + 1 < len; k += 2) {
+      uint32_t cp = le ? s[k] | s[k + 1] << 8 : s[k] << 8 | s[k + 1];
+      if (!cp) break;
+      i = put_utf8(dst, i, cp >= 0xD800 && cp < 0xE000 ? '?' : cp);
+    }
+  } else {
+    for (size_t k = 0; k < len && s[k]; k++) {
+      if (enc == 0) {
+        i = put_utf8(dst, i, s[k]);
+      } else if (i + 1 < LIBRARY_STR_MAX) {
+        dst[i++] = s[k];
+      }
+    }
+    // Do not leave a truncated UTF-8 sequence behind
+    if (enc == 3) {
+      size_t j = i;
+      while (j > 0 && (dst[j - 1] & 0xC0) == 0x80) j--;
+      if (j > 0 && (dst[j - 1] & 0x80)) {
+        uint8_t lead = dst[j - 1];
+        size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+        if (i - (j - 1) < need) i = j - 1;
+      }
+    }
+  }
+  dst[i] = 0;
+}
+
+static void parse_id3(const uint8_t* b, size_t n, TagText* tags) {
+  if (n < 10 || memcmp(b, "ID3", 3) != 0) return;
+  uint8_t ver = b[3];
+  size_t end = min(n, (size_t)(10 + syncsafe(b + 6)));
+  size_t p = 10;
+  if (b[5] & 0x40) {
+    if (ver == 3) p += 4 + be32(b + 10);
+    if (ver == 4) p += syncsafe(b + 10);
+  }
+  size_t head = ver == 2 ? 6 : 10;
+  while (p + head <= end && b[p]) {
+    const uint8_t* f = b + p;
+    uint32_t size = ver == 2 ? (f[3] << 16 | f[4] << 8 | f[5]) : (ver == 4 ? syncsafe(f + 4) : be32(f + 4));
+    size_t data = p + head;
+    if (size == 0 || size > end - data) break;
+    char* dst = NULL;
+    if (ver == 2) {
+      if (!memcmp(f, "TT2", 3)) dst = tags->title;
+      if (!memcmp(f, "TP1", 3)) dst = tags->artist;
+      if (!memcmp(f, "TAL", 3)) dst = tags->album;
+    } else {
+      if (!memcmp(f, "TIT2", 4)) dst = tags->title;
+      if (!memcmp(f, "TPE1", 4)) dst = tags->artist;
+      if (!memcmp(f, "TALB", 4)) dst = tags->album;
+    }
+    if (dst) put_text(dst, b + data + 1, size - 1, b[data]);
+    p = data + size;
+  }
+}
+
+// Vorbis comment block (Ogg Vorbis and FLAC): vendor string, then KEY=value entries
+static void parse_vorbis_comment(const uint8_t* b, size_t n, TagText* tags) {
+  if (n < 8 || le32(b) > n - 8) return;
+  size_t p = 4 + le32(b);
+  uint32_t count = le32(b + p);
+  p += 4;
+  for (uint32_t i = 0; i < count && p + 4 <= n; i++) {
+    uint32_t len = le32(b + p);
+    p += 4;
+    if (len > n - p) break;
+    const char* c = (const char*)b + p;
+    if (len > 6 && !strncasecmp(c, "TITLE=", 6)) put_text(tags->title, b + p + 6, len - 6, 3);
+    if (len > 7 && !strncasecmp(c, "ARTIST=", 7)) put_text(tags->artist, b + p + 7, len - 7, 3);
+    if (len > 6 && !strncasecmp(c, "ALBUM=", 6)) put_text(tags->album, b + p + 6, len - 6, 3);
+    p += len;
+  }
+}
+
+static void parse_ogg(const uint8_t* b, size_t n, TagText* tags) {
+  // The comment header is the second packet, normally within the first pages
+  for (size_t p = 0; p + 7 <= n; p++) {
+    if (b[p] == 3 && !memcmp(b + p + 1, "vorbis", 6)) {
+      parse_vorbis_comment(b + p + 7, n - p - 7, tags);
+      return;
+    }
+  }
+}
+
+static void parse_flac(const uint8_t* b, size_t n, TagText* tags) {
+  if (n < 4 || memcmp(b, "fLaC", 4) != 0) return;
+  for (size_t p = 4; p + 4 <= n;) {
+    uint8_t type = b[p] & 0x7F;
+    bool last = b[p] & 0x80;
+    size_t len = b[p + 1] << 16 | b[p + 2] << 8 | b[p + 3];
+    p += 4;
+    if (type == 4) {
+      parse_vorbis_comment(b + p, min(len, n - p), tags);
+      return;
+    }
+    if (last) return;
+    p += len;
+  }
+}
+
+static void parse_riff(const uint8_t* b, size_t n, TagText* tags) {
+  if (n < 12 || memcmp(b, "RIFF", 4) != 0 || memcmp(b + 8, "WAVE", 4) != 0) return;
+  for (size_t p = 12; p + 8 <= n;) {
+    uint32_t size = le32(b + p + 4);
+    size_t data = p + 8;
+    size_t len = min((size_t)size, n - data);
+    if (!memcmp(b + p, "LIST", 4) && len >= 4 && !memcmp(b + data, "INFO", 4)) {
+      for (size_t q = data + 4; q + 8 <= data + len;) {
+        uint32_t sub = le32(b + q + 4);
+        size_t s_len = min((size_t)sub, data + len - q - 8);
+        if (!memcmp(b + q, "INAM", 4)) put_text(tags->title, b + q + 8, s_len, 0);
+        if (!memcmp(b + q, "IART", 4)) put_text(tags->artist, b + q + 8, s_len, 0);
+        if (!memcmp(b + q, "IPRD", 4)) put_text(tags->album, b + q + 8, s_len, 0);
+        if (sub > data + len - q - 8) break;  // Runs past the chunk; also keeps q from wrapping
+        q += 8 + sub + (sub & 1);
+      }
+    } else if (!strncasecmp((const char*)b + p, "id3 ", 4)) {
+      parse_id3(b + data, len, tags);
+    }
+    if (size > n - data) break;  // Runs past what was read; also keeps p from wrapping
+    p = data + size + (size & 1);
+  }
+}
+
+static const char* extension(const char* name) {
+  const char* dot = strrchr(name, '.');
+  return dot ? dot + 1 : "";
+}
+
+static bool is_audio(const char* name) {
+  const char* ext = extension(name);
+  return !strcasecmp(ext, "wav") || !strcasecmp(ext, "mp3") || !strcasecmp(ext, "ogg") || !strcasecmp(ext, "flac");
+}
+
+static void read_tags(File& f, uint8_t* buf, TagText* tags) {
+  memset(tags, 0, sizeof(*tags));
+  size_t n = f.read(buf, LIBRARY_TAG_BYTES);
+  const char* ext = extension(f.name());
+  if (!strcasecmp(ext, "mp3")) parse_id3(buf, n, tags);
+  if (!strcasecmp(ext, "ogg")) parse_ogg(buf, n, tags);
+  if (!strcasecmp(ext, "flac")) parse_flac(buf, n, tags);
+  if (!strcasecmp(ext, "wav")) parse_riff(buf, n, tags);
+
+  if (!tags->title[0]) {
+    // File name without the extension
+    const char* name = f.name();
+    size_t len = min((size_t)(extension(name) - name - 1), (size_t)LIBRARY_STR_MAX - 1);
+    memcpy(tags->title, name, len);
+    tags->title[len] = 0;
+  }
+  if (!tags->artist[0]) strcpy(tags->artist, "Unknown artist");
+  if (!tags->album[0]) strcpy(tags->album, "Unknown album");
+}
+
+/***************************************************************************************
+** Index build
+***************************************************************************************/
+
+// Upper-cased ASCII prefix, zero padded so shorter strings sort first
+static void put_key(char* key, const char* s, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    key[i] = *s ? toupper((uint8_t)*s++) : 0;
+  }
+}
+
+// FNV-1a of a name; with upper, of its upper-cased ASCII
+static uint32_t hash_name(const char* s, bool upper) {
+  uint32_t h = 2166136261u;
+  for (; *s; s++) h = (h ^ (upper ? toupper((uint8_t)*s) : (uint8_t)*s)) * 16777619u;
+  return h;
+}
+
+// Big-endian, so keys compare like the numbers
+static void put_hash(char* key, uint32_t h) {
+  for (int i = 0; i < 4; i++) key[i] = h >> (24 - 8 * i);
+}
+
+// Prefix, then a hash of the whole upper-cased name, from its first
+// character: names that share the prefix still sort next to each other,
+// so every artist and album is one range
+static void put_group_key(char* key, const char* name, size_t len) {
+  put_key(key, name, len);
+  put_hash(key + len, hash_name(name, true));
+}
+
+// Tags of 'path' from the index in use, if the file has the size and last
+// write it had when that index read them
+static bool reuse_tags(const char* path, uint32_t size, uint32_t mtime, TagText* tags) {
+  bool found = false;
+  uint32_t h = hash_name(path, false);
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  if (index_ready) {
+    // Lower bound of the hash, then every track that shares it
+    uint32_t lo = 0, hi = hdr.tracks;
+    PathRec pr;
+    while (lo < hi) {
+      uint32_t mid = (lo + hi) / 2;
+      if (!read_at(hdr.paths_off + mid * sizeof(pr), &pr, sizeof(pr))) break;
+      if (pr.hash < h) lo = mid + 1;
+      else hi = mid;
+    }
+    char old[LIBRARY_PATH_MAX];
+    TrackRec rec;
+    AlbumRec album;
+    ArtistRec artist;
+    for (; !found && lo < hdr.tracks; lo++) {
+      if (!read_at(hdr.paths_off + lo * sizeof(pr), &pr, sizeof(pr)) || pr.hash != h ||
+          !read_at(hdr.tracks_off + pr.track * sizeof(rec), &rec, sizeof(rec))) break;
+      read_string(rec.path, old, sizeof(old));
+      if (strcmp(old, path) != 0 || rec.size != size || rec.mtime != mtime) continue;
+      found = read_at(hdr.albums_off + rec.album * sizeof(album), &album, sizeof(album)) &&
+              read_at(hdr.artists_off + rec.artist * sizeof(artist), &artist, sizeof(artist));
+      if (found) {
+        read_string(rec.title, tags->title, sizeof(tags->title));
+        read_string(artist.name, tags->artist, sizeof(tags->artist));
+        read_string(album.name, tags->album, sizeof(tags->album));
+      }
+    }
+  }
+  xSemaphoreGive(lib_lock);
+  return found;
+}
+
+static int compare_rec(const void* a, const void* b) {
+  return memcmp(((const SortRec*)a)->key, ((const SortRec*)b)->key, sizeof(SortRec::key));
+}
+
+// External merge sort: sorted runs of LIBRARY_SORT_RUN records, then a k-way
+// merge that gives each run an equal slice of buf as its read buffer
+static bool sort_records(const char* in_path, const char* out_path, SortRec* buf) {
+  uint16_t run_len[LIBRARY_MAX_RUNS];
+  int runs = 0;
+  File in = SD.open(in_path, FILE_READ);
+  File tmp = SD.open(LIB_RUNS_TMP, FILE_WRITE);
+  if (!in || !tmp) return false;
+  for (;;) {
+    size_t n = in.read((uint8_t*)buf, LIBRARY_SORT_RUN * sizeof(SortRec)) / sizeof(SortRec);
+    if (n == 0) break;
+    if (runs == LIBRARY_MAX_RUNS) return false;
+    qsort(buf, n, sizeof(SortRec), compare_rec);
+    tmp.write((const uint8_t*)buf, n * sizeof(SortRec));
+    run_len[runs++] = n;
+  }
+  in.close();
+  tmp.close();
+
+  File out = SD.open(out_path, FILE_WRITE);
+  tmp = SD.open(LIB_RUNS_TMP, FILE_READ);
+  if (!out || !tmp) return false;
+
+  uint32_t slice = LIBRARY_SORT_RUN / max(runs, 1);
+  uint32_t start[LIBRARY_MAX_RUNS], taken[LIBRARY_MAX_RUNS];
+  uint16_t have[LIBRARY_MAX_RUNS], head[LIBRARY_MAX_RUNS];
+  for (int r = 0, s = 0; r < runs; s += run_len[r++]) {
+    start[r] = s;
+    taken[r] = have[r] = head[r] = 0;
+  }
+
+  for (;;) {
+    int best = -1;
+    for (int r = 0; r < runs; r++) {
+      if (head[r] == have[r]) {
+        uint32_t left = run_len[r] - taken[r];
+        if (left == 0) continue;
+        have[r] = min(left, slice);
+        head[r] = 0;
+        tmp.seek((start[r] + taken[r]) * sizeof(SortRec));
+        tmp.read((uint8_t*)&buf[r * slice], have[r] * sizeof(SortRec));
+        taken[r] += have[r];
+      }
+      if (best < 0 || compare_rec(&buf[r * slice + head[r]], &buf[best * slice + head[best]]) < 0) best = r;
+    }
+    if (best < 0) break;
+    out.write((const uint8_t*)&buf[best * slice + head[best]], sizeof(SortRec));
+    head[best]++;
+  }
+  out.close();
+  tmp.close();
+  return true;
+}
+
+// Breadth-first walk; pending directories wait in a file, not in RAM.
+// Writes each track's size, last write and strings to records and its sort
+// key to keys. Files unchanged since the index in use keep its tags unread.
+static bool scan_tree(uint8_t* buf) {
+  File dirs = SD.open(LIB_DIRS_TMP, FILE_WRITE);
+  File records = SD.open(LIB_RECORDS_TMP, FILE_WRITE);
+  File keys = SD.open(LIB_KEYS_TMP, FILE_WRITE);
+  if (!dirs || !records || !keys) return false;
+
+  dirs.write((const uint8_t*)"/", 2);
+  uint32_t dirs_len = 2, dirs_pos = 0, rec_off = 0;
+  char path[LIBRARY_PATH_MAX];
+  TagText tags;
+
+  while (dirs_pos < dirs_len && stats.scan_files < LIBRARY_MAX_TRACKS) {
+    dirs.flush();
+    File q = SD.open(LIB_DIRS_TMP, FILE_READ);
+    q.seek(dirs_pos);
+    size_t n = q.read((uint8_t*)path, sizeof(path));
+    q.close();
+    path[n ? n - 1 : 0] = 0;
+    dirs_pos += strlen(path) + 1;
+
+    File dir = SD.open(path);
+    if (!dir || !dir.isDirectory()) continue;
+    stats.scan_dirs++;
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      const char* full = f.path();
+      size_t len = strlen(full);
+      if (f.name()[0] == '.' || len >= LIBRARY_PATH_MAX) {
+        // Hidden (including the index itself) or too deep to store
+      } else if (f.isDirectory()) {
+        dirs.write((const uint8_t*)full, len + 1);
+        dirs_len += len + 1;
+      } else if (is_audio(f.name()) && stats.scan_files < LIBRARY_MAX_TRACKS) {
+        uint32_t stamp[2] = { (uint32_t)f.size(), (uint32_t)f.getLastWrite() };
+        if (reuse_tags(full, stamp[0], stamp[1], &tags)) stats.scan_reused++;
+        else read_tags(f, buf, &tags);
+        SortRec key;
+        put_group_key(key.key, tags.artist, 16);
+        put_group_key(key.key + 20, tags.album, 12);
+        put_key(key.key + 36, tags.title, 8);
+        key.ref = rec_off;
+        keys.write((const uint8_t*)&key, sizeof(key));
+
+        records.write((const uint8_t*)stamp, sizeof(stamp));
+        rec_off += sizeof(stamp);
+        const char* fields[4] = { full, tags.title, tags.artist, tags.album };
+        for (int i = 0; i < 4; i++) {
+          size_t l = strlen(fields[i]) + 1;
+          records.write((const uint8_t*)fields[i], l);
+          rec_off += l;
+        }
+        stats.scan_files++;
+      }
+      f.close();
+    }
+    dir.close();
+  }
+  dirs.close();
+  records.close();
+  keys.close();
+  return true;
+}
+
+// Walk the sorted tracks: write the string pool, track records and the
+// artist/album boundaries
+static bool emit_tracks(uint8_t* buf, uint32_t* artists, uint32_t* albums) {
+  File sorted = SD.open(LIB_SORTED_TMP, FILE_READ);
+  File records = SD.open(LIB_RECORDS_TMP, FILE_READ);
+  File strings = SD.open(LIB_STRINGS_TMP, FILE_WRITE);
+  File tracks = SD.open(LIB_TRACKS_TMP, FILE_WRITE);
+  File groups = SD.open(LIB_GROUPS_TMP, FILE_WRITE);
+  if (!sorted || !records || !strings || !tracks || !groups) return false;
+
+  char artist[LIBRARY_STR_MAX] = "", album[LIBRARY_STR_MAX] = "";
+  uint32_t pool = 0;
+  int32_t artist_id = -1, album_id = -1;
+  SortRec key;
+  for (uint32_t i = 0; sorted.read((uint8_t*)&key, sizeof(key)) == sizeof(key); i++) {
+    // size and last write, then path, title, artist, album, each NUL-terminated and bounded
+    records.seek(key.ref);
+    size_t n = records.read(buf, 8 + LIBRARY_PATH_MAX + 3 * LIBRARY_STR_MAX);
+    uint32_t stamp[2];
+    memcpy(stamp, buf, sizeof(stamp));
+    const char* f[4];
+    size_t p = sizeof(stamp);
+    for (int k = 0; k < 4; k++) {
+      f[k] = (const char*)buf + p;
+      while (p < n && buf[p]) p++;
+      p++;
+    }
+
+    TrackRec rec;
+    // Grouped case-insensitively like the keys; the first spelling names the group
+    bool new_artist = artist_id < 0 || strcasecmp(f[2], artist) != 0;
+    if (new_artist || strcasecmp(f[3], album) != 0) {
+      GroupRec g = { pool, i, 0, 0, 0 };
+      if (new_artist) {
+        strlcpy(artist, f[2], sizeof(artist));
+        strings.write((const uint8_t*)f[2], strlen(f[2]) + 1);
+        pool += strlen(f[2]) + 1;
+        artist_id++;
+        groups.write((const uint8_t*)&g, sizeof(g));
+      }
+      strlcpy(album, f[3], sizeof(album));
+      g.name = pool;
+      g.artist = artist_id;
+      g.is_album = 1;
+      strings.write((const uint8_t*)f[3], strlen(f[3]) + 1);
+      pool += strlen(f[3]) + 1;
+      album_id++;
+      groups.write((const uint8_t*)&g, sizeof(g));
+    }
+    rec.title = pool;
+    strings.write((const uint8_t*)f[1], strlen(f[1]) + 1);
+    pool += strlen(f[1]) + 1;
+    rec.path = pool;
+    strings.write((const uint8_t*)f[0], strlen(f[0]) + 1);
+    pool += strlen(f[0]) + 1;
+    rec.artist = artist_id;
+    rec.album = album_id;
+    rec.size = stamp[0];
+    rec.mtime = stamp[1];
+    tracks.write((const uint8_t*)&rec, sizeof(rec));
+  }
+  *artists = artist_id + 1;
+  *albums = album_id + 1;
+  sorted.close();
+  records.close();
+  strings.close();
+  tracks.close();
+  groups.close();
+  return true;
+}
+
+// Title sort keys and path hash keys for every track, by index
+static bool write_order_keys() {
+  File tracks = SD.open(LIB_TRACKS_TMP, FILE_READ);
+  File strings = SD.open(LIB_STRINGS_TMP, FILE_READ);
+  File keys = SD.open(LIB_KEYS_TMP, FILE_WRITE);
+  File paths = SD.open(LIB_PATHS_TMP, FILE_WRITE);
+  if (!tracks || !strings || !keys || !paths) return false;
+  TrackRec rec;
+  char title[LIBRARY_STR_MAX];
+  char path[LIBRARY_PATH_MAX];
+  for (uint32_t i = 0; tracks.read((uint8_t*)&rec, sizeof(rec)) == sizeof(rec); i++) {
+    strings.seek(rec.title);
+    size_t n = strings.read((uint8_t*)title, sizeof(title) - 1);
+    title[n] = 0;
+    SortRec key;
+    put_key(key.key, title, sizeof(key.key));
+    key.ref = i;
+    keys.write((const uint8_t*)&key, sizeof(key));
+
+    strings.seek(rec.path);
+    n = strings.read((uint8_t*)path, sizeof(path) - 1);
+    path[n] = 0;
+    memset(key.key, 0, sizeof(key.key));
+    put_hash(key.key, hash_name(path, false));
+    paths.write((const uint8_t*)&key, sizeof(key));
+  }
+  tracks.close();
+  strings.close();
+  keys.close();
+  paths.close();
+  return true;
+}
+
+static void copy_file(File& out, const char* path, uint8_t* buf, size_t len) {
+  File in = SD.open(path, FILE_READ);
+  if (!in) return;
+  size_t n;
+  while ((n = in.read(buf, len)) > 0) out.write(buf, n);
+  in.close();
+}
+
+// Header, tables and pool into one file
+static bool assemble(uint8_t* buf, size_t buf_len, uint32_t artists, uint32_t albums) {
+  File out = SD.open(LIB_NEW_PATH, FILE_WRITE);
+  if (!out) return false;
+  IndexHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, LIB_MAGIC, 4);
+  h.version = LIB_VERSION;
+  h.tracks = stats.scan_files;
+  h.artists = artists;
+  h.albums = albums;
+  out.write((const uint8_t*)&h, sizeof(h));
+
+  h.tracks_off = out.position();
+  copy_file(out, LIB_TRACKS_TMP, buf, buf_len);
+
+  // Groups hold artists and albums interleaved; one pass per table
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 0) h.artists_off = out.position();
+    else h.albums_off = out.position();
+    File groups = SD.open(LIB_GROUPS_TMP, FILE_READ);
+    GroupRec g;
+    while (groups.read((uint8_t*)&g, sizeof(g)) == sizeof(g)) {
+      if (g.is_album != pass) continue;
+      if (pass == 0) {
+        ArtistRec a = { g.name, g.first };
+        out.write((const uint8_t*)&a, sizeof(a));
+      } else {
+        AlbumRec a = { g.name, g.first, g.artist, 0 };
+        out.write((const uint8_t*)&a, sizeof(a));
+      }
+    }
+    groups.close();
+  }
+
+  h.titles_off = out.position();
+  File sorted = SD.open(LIB_SORTED_TMP, FILE_READ);
+  SortRec key;
+  while (sorted.read((uint8_t*)&key, sizeof(key)) == sizeof(key)) out.write((const uint8_t*)&key.ref, 4);
+  sorted.close();
+
+  h.paths_off = out.position();
+  sorted = SD.open(LIB_PSORTED_TMP, FILE_READ);
+  while (sorted.read((uint8_t*)&key, sizeof(key)) == sizeof(key)) {
+    PathRec r = { be32((const uint8_t*)key.key), key.ref };
+    out.write((const uint8_t*)&r, sizeof(r));
+  }
+  sorted.close();
+
+  h.strings_off = out.position();
+  copy_file(out, LIB_STRINGS_TMP, buf, buf_len);
+
+  out.seek(0);
+  out.write((const uint8_t*)&h, sizeof(h));
+  out.close();
+  return true;
+}
+
+static void remove_temps() {
+  static const char* temps[] = { LIB_DIRS_TMP, LIB_RECORDS_TMP, LIB_KEYS_TMP, LIB_SORTED_TMP,
+                                 LIB_RUNS_TMP, LIB_STRINGS_TMP, LIB_TRACKS_TMP, LIB_GROUPS_TMP,
+                                 LIB_PATHS_TMP, LIB_PSORTED_TMP };
+  for (const char* t : temps) SD.remove(t);
+}
+
+static bool build_index(uint8_t* buf, size_t buf_len) {
+  uint32_t artists = 0, albums = 0;
+  return scan_tree(buf) &&
+         sort_records(LIB_KEYS_TMP, LIB_SORTED_TMP, (SortRec*)buf) &&
+         emit_tracks(buf, &artists, &albums) &&
+         write_order_keys() &&
+         sort_records(LIB_KEYS_TMP, LIB_SORTED_TMP, (SortRec*)buf) &&
+         sort_records(LIB_PATHS_TMP, LIB_PSORTED_TMP, (SortRec*)buf) &&
+         assemble(buf, buf_len, artists, albums);
+}
+
+static void scan_task(void* arg) {
+  telemetry_register_task("lib_scan", NULL);
+  uint32_t t = millis();
+  // One buffer for the sort runs, the tag bytes, track records and copy chunks
+  size_t buf_len = max(LIBRARY_SORT_RUN * sizeof(SortRec), (size_t)LIBRARY_TAG_BYTES);
+  uint8_t* buf = (uint8_t*)malloc(buf_len);
+  stats.scan_files = 0;
+  stats.scan_reused = 0;
+  stats.scan_dirs = 0;
+
+  bool ok = buf && build_index(buf, buf_len);
+  free(buf);
+  remove_temps();
+  if (ok) {
+    xSemaphoreTake(lib_lock, portMAX_DELAY);
+    index_file.close();
+    SD.remove(LIBRARY_PATH);
+    SD.rename(LIB_NEW_PATH, LIBRARY_PATH);
+    open_index();
+    xSemaphoreGive(lib_lock);
+    stats.scan_ms = millis() - t;
+  }
+  Serial.printf("LIB,scan,%s,files=%u,reused=%u,dirs=%u,ms=%u\n", ok ? "ok" : "FAIL",
+                stats.scan_files, stats.scan_reused, stats.scan_dirs, millis() - t);
+  scanning = false;
+  telemetry_unregister_task(NULL);
+  vTaskDelete(NULL);
+}
+
+bool library_scan_start() {
+  if (scanning || !storage_mounted()) return false;
+  scanning = true;
+  if (xTaskCreatePinnedToCore(scan_task, "lib_scan", LIBRARY_SCAN_STACK, NULL, 1, NULL, AUDIO_CORE) != pdPASS) {
+    scanning = false;
+    return false;
+  }
+  return true;
+}
+
+/***************************************************************************************
+** Console
+***************************************************************************************/
+
+static void print_track(uint32_t index) {
+  LibraryTrack t;
+  if (library_get_track(index, &t)) {
+    Serial.printf("  %u: %s - %s - %s (%s)\n", index, t.artist, t.album, t.title, t.path);
+  }
+}
+
+static void cmd_lib(int argc, char** argv) {
+  uint32_t value = 0;
+  if (argc > 1 && strcmp(argv[1], "scan") == 0) {
+    if (!library_scan_start()) Serial.println("lib: no card, or a scan is running");
+  } else if (argc > 1 && strcmp(argv[1], "list") == 0) {
+    if (argc > 2) console_parse_uint(argv[2], UINT32_MAX, &value);
+    for (uint32_t i = value; i < value + 10 && i < library_track_count(); i++) print_track(i);
+  } else if (argc > 1 && strcmp(argv[1], "artists") == 0) {
+    if (argc > 2) console_parse_uint(argv[2], UINT32_MAX, &value);
+    char name[LIBRARY_STR_MAX];
+    uint32_t first, count;
+    for (uint32_t i = value; i < value + 10 && library_get_artist(i, name, sizeof(name), &first, &count); i++) {
+      Serial.printf("  %u: %s (%u tracks from %u)\n", i, name, count, first);
+    }
+  } else if (argc > 2 && strcmp(argv[1], "find") == 0) {
+    uint32_t t = micros();
+    int32_t pos = library_find_title(argv[2]);
+    t = micros() - t;
+    Serial.printf("LIB,find,%s,pos=%d,us=%u\n", argv[2], pos, t);
+    for (int32_t i = pos; pos >= 0 && i < pos + 10 && i < (int32_t)library_track_count(); i++) {
+      print_track(library_title_track(i));
+    }
+  } else if (argc > 1) {
+    Serial.println("usage: lib [scan|list <n>|artists <n>|find <prefix>]");
+    return;
+  }
+
+  LibraryStats s;
+  library_get_stats(&s);
+  Serial.printf("LIB,tracks=%u,artists=%u,albums=%u,scanning=%d,scan_files=%u,scan_reused=%u,scan_dirs=%u,"
+                "scan_ms=%u,cache_hits=%u,cache_misses=%u,ram=%u\n",
+                s.tracks, s.artists, s.albums, s.scanning, s.scan_files, s.scan_reused, s.scan_dirs, s.scan_ms,
+                s.cache_hits, s.cache_misses, (unsigned)(sizeof(cache) + sizeof(hdr)));
+}
+
+void library_init() {
+  lib_lock = xSemaphoreCreateMutex();
+  cache_clear();
+  console_register("lib", "[scan|list <n>|artists <n>|find <prefix>] music library index", cmd_lib);
+  if (!storage_mounted()) return;
+
+  xSemaphoreTake(lib_lock, portMAX_DELAY);
+  open_index();
+  xSemaphoreGive(lib_lock);
+  if (!index_ready) library_scan_start();
+}
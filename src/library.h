@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// One track, strings copied out of the index
+struct LibraryTrack {
+  char title[LIBRARY_STR_MAX];
+  char artist[LIBRARY_STR_MAX];
+  char album[LIBRARY_STR_MAX];
+  char path[LIBRARY_PATH_MAX];
+  uint16_t artist_id;
+  uint16_t album_id;
+};
+
+struct LibraryStats {
+  uint32_t tracks;
+  uint32_t artists;
+  uint32_t albums;
+  bool scanning;
+  uint32_t scan_files;        // Audio files seen by the running (or last) scan
+  uint32_t scan_reused;       // Of those, unchanged files whose tags came from the old index
+  uint32_t scan_dirs;
+  uint32_t scan_ms;           // Duration of the last completed scan
+  uint32_t cache_hits;        // Index page reads served from RAM
+  uint32_t cache_misses;
+};
+
+// Open the index on the card (reads the header only) and register the 'lib'
+// console command. Starts a scan if there is no index yet.
+void library_init();
+
+// Rebuild the index in the background (lowest priority task on AUDIO_CORE).
+// The old index stays usable until the new one replaces it. Files with the
+// path, size and last write they had in the old index keep their tags
+// without being read; the sorted tables are always written anew.
+bool library_scan_start();
+
+// Tracks are ordered by artist, album, then title; artists and albums by
+// name, each with the range of tracks it covers. Reads go through a small
+// page cache, so browsing touches only the pages it shows.
+uint32_t library_track_count();
+bool library_get_track(uint32_t index, LibraryTrack* track);
+bool library_get_artist(uint32_t id, char* name, size_t len, uint32_t* first, uint32_t* count);
+bool library_get_album(uint32_t id, char* name, size_t len, uint32_t* first, uint32_t* count);
+
+// Title order: track index at a position, and the first position whose title
+// starts with prefix (case-insensitive), or -1
+uint32_t library_title_track(uint32_t pos);
+int32_t library_find_title(const char* prefix);
+
+void library_get_stats(LibraryStats* stats);
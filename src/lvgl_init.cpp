@@ -1,18 +1,39 @@
 #include "lvgl_init.h"
 #include "display.h"
 #include "touch.h"
+#include "boot.h"
+#include "rgb565_swar.h"
+#include "refresh_plan.h"
 
 // LVGL display driver
 static lv_disp_drv_t disp_drv;
+static lv_disp_t* disp = NULL;
 static lv_indev_drv_t indev_drv;
 
 // LVGL display buffer
 static lv_disp_draw_buf_t draw_buf;
 static lv_color_t buf[SCREEN_WIDTH * LVGL_BUFFER_ROWS];
+static uint16_t buf_rows = LVGL_BUFFER_ROWS;
+
+// The rounder only aligns chunks to tile rows when a chunk holds one; that
+// must hold along the long side too, or rotated apps flush only partial tiles
+static_assert(!DISPLAY_TILE_FILTER || SCREEN_WIDTH * LVGL_BUFFER_ROWS >= SCREEN_HEIGHT * DISPLAY_TILE_SIZE,
+              "LVGL buffer too small for a landscape tile row");
 
 // LVGL timer for ticks
 static hw_timer_t * lvglTimer = NULL;
 
+// Render statistics
+static FrameStats frame_stats;
+
+static void lvgl_monitor_cb(lv_disp_drv_t *disp, uint32_t time, uint32_t px) {
+  frame_stats.frames++;
+  frame_stats.time_sum_ms += time;
+  frame_stats.px_sum += px;
+  if (time > frame_stats.time_max_ms) frame_stats.time_max_ms = time;
+  boot_note_frame();
+}
+
 void lvgl_init_system() {
   // Initialize LVGL
   lv_init();
@@ -24,11 +45,22 @@ void lvgl_init_system() {
 void lvgl_init_display() {
   // Configure display driver
   lv_disp_drv_init(&disp_drv);
-  disp_drv.hor_res = SCREEN_WIDTH;
-  disp_drv.ver_res = SCREEN_HEIGHT;
+  disp_drv.hor_res = display_get_tft()->width();   // Follows the panel rotation
+  disp_drv.ver_res = display_get_tft()->height();
   disp_drv.flush_cb = display_flush_cb;
+#if DISPLAY_TILE_FILTER
+  disp_drv.rounder_cb = display_rounder_cb;
+#endif
+  disp_drv.monitor_cb = lvgl_monitor_cb;
   disp_drv.draw_buf = &draw_buf;
-  lv_disp_drv_register(&disp_drv);
+#if LVGL_SWAR_BLEND
+  disp_drv.draw_ctx_init = swar_lv_draw_ctx_init;
+  disp_drv.draw_ctx_size = sizeof(lv_draw_sw_ctx_t);
+#endif
+  disp = lv_disp_drv_register(&disp_drv);
+#if REFRESH_PLANNER
+  refresh_plan_init(disp);
+#endif
 }
 
 void lvgl_init_input() {
@@ -47,6 +79,55 @@ void lvgl_init_timer() {
   timerAlarmEnable(lvglTimer);
 }
 
+void lvgl_get_frame_stats(FrameStats* stats, bool reset) {
+  *stats = frame_stats;
+  if (reset) {
+    memset(&frame_stats, 0, sizeof(frame_stats));
+  }
+}
+
+void lvgl_set_refresh_period(uint32_t ms) {
+  if (disp && disp->refr_timer) {
+    lv_timer_set_period(disp->refr_timer, ms);
+  }
+}
+
+uint32_t lvgl_get_refresh_period() {
+  return (disp && disp->refr_timer) ? disp->refr_timer->period : LV_DISP_DEF_REFR_PERIOD;
+}
+
+bool lvgl_set_buffer_rows(uint16_t rows) {
+  // Only shrinking within the static buffer is possible
+  if (rows == 0 || rows > LVGL_BUFFER_ROWS) return false;
+
+  // Must not run inside lv_timer_handler (called from the main loop)
+  buf_rows = rows;
+  lv_disp_draw_buf_init(&draw_buf, buf, NULL, SCREEN_WIDTH * rows);
+  if (disp) lv_obj_invalidate(lv_disp_get_scr_act(disp));
+  return true;
+}
+
+uint16_t lvgl_get_buffer_rows() {
+  return buf_rows;
+}
+
+void lvgl_set_rotation(uint8_t rotation) {
+  // The panel does the rotation (MADCTL), so frames cost the same in any orientation
+  TFT_eSPI* tft = display_get_tft();
+  tft->setRotation(rotation & 3);
+  display_invalidate_all_tiles();
+  touch_set_rotation(rotation & 3);
+
+  // Must not run inside lv_timer_handler (called from the main loop)
+  disp_drv.hor_res = tft->width();
+  disp_drv.ver_res = tft->height();
+  if (disp) lv_disp_drv_update(disp, &disp_drv);
+}
+
+uint8_t lvgl_get_rotation() {
+  return display_get_tft()->getRotation();
+}
+
 void lvgl_task_handler() {
   lv_timer_handler(); // Handle LVGL tasks
 }
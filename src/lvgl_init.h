@@ -9,6 +9,28 @@ void lvgl_init_display();
 void lvgl_init_input();
 void lvgl_init_timer();
 
+// Render statistics accumulated from the display driver's monitor callback
+struct FrameStats {
+  uint32_t frames;        // Refresh cycles that drew something
+  uint32_t time_sum_ms;   // Total render + flush time
+  uint32_t time_max_ms;   // Slowest refresh
+  uint32_t px_sum;        // Pixels rendered
+};
+
+// Copy the statistics gathered since the last reset
+void lvgl_get_frame_stats(FrameStats* stats, bool reset);
+
+// Runtime tuning of the refresh period and draw buffer height
+void lvgl_set_refresh_period(uint32_t ms);
+uint32_t lvgl_get_refresh_period();
+bool lvgl_set_buffer_rows(uint16_t rows);
+uint16_t lvgl_get_buffer_rows();
+
+// Switch panel orientation (0/2 portrait, 1/3 landscape) and update the LVGL
+// resolution and the touch transform with it
+void lvgl_set_rotation(uint8_t rotation);
+uint8_t lvgl_get_rotation();
+
 // LVGL timer handler
 void lvgl_task_handler();
 
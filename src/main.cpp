@@ -7,47 +7,94 @@
 #include "display.h"
 #include "touch.h"
 #include "lvgl_init.h"
-
-// Forward declarations
-extern void ui_create();
+#include "telemetry.h"
+#include "flight_recorder.h"
+#include "console.h"
+#include "benchmark.h"
+#include "boot.h"
+#include "theme.h"
+#include "app_manager.h"
+#include "audio.h"
+#include "storage.h"
+#include "library.h"
+#include "player.h"
+#include "spectrum.h"
+#include "ui.h"
+#include "clock_face.h"
+#include "wallclock.h"
 
 void setup() {
   // Initialize serial for debugging
   Serial.begin(115200);
   Serial.println("ESP32 LVGL Project Starting...");
+  boot_mark("serial");
+
+  // Report what happened before this boot
+  flight_recorder_init();
+  flight_recorder_dump();
   
   // Initialize display
   display_init();
   display_set_backlight(180);  // Set backlight to maximum brightness
   Serial.println("Display initialized");
+  boot_mark("display");
   
   // Initialize touch
   touch_init();
   Serial.println("Touch initialized");
+  boot_mark("touch");
   
   // Uncomment to run calibration
   // touch_calibrate();
   
   // Initialize LVGL
   lvgl_init_system();
+  telemetry_init();
+  telemetry_register_task("loop", NULL);
   lvgl_init_display();
   lvgl_init_input();
   lvgl_init_timer();
+  flight_recorder_start();
   Serial.println("LVGL initialized");
+  boot_mark("lvgl");
   
-  // Create UI
-  ui_create();
+  // Create UI (screens are built on first switch)
+  theme_init(lv_disp_get_default());
+  app_register(&ui_home_app);
+  app_register(&clock_app);
+  telemetry_begin_scenario("ui_create");
+  app_switch_name("home");
   Serial.println("UI created");
+  boot_mark("ui");
+  telemetry_begin_scenario("idle");
+  telemetry_print();
+
+  console_init();
+  benchmark_init();
+  app_manager_init();
+  audio_init();
+  spectrum_init();
+  storage_init();
+  library_init();
+  player_init();
+  wallclock_init();
   
   Serial.println("Setup complete");
+  boot_mark("setup");
 }
 
 void loop() {
+  uint32_t start = micros();
+
   // Handle LVGL tasks
   lvgl_task_handler();
    // Check for screen timeout
   check_screen_timeout();
+  // Handle serial commands
+  console_poll();
+
+  flight_recorder_note_busy(micros() - start);
 
-  // Small delay to prevent watchdog triggers
-  delay(5);
+  // Short delay, or light sleep until the next clock tick when idle
+  wallclock_idle(5);
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include <atomic>
+#include "player.h"
+#include "adpcm.h"
+#include "audio.h"
+#include "console.h"
+#include "library.h"
+#include "storage.h"
+#include "telemetry.h"
+
+#define REQ_NONE -1
+#define REQ_STOP -2
+
+// An open track: the current one and the one queued after it
+struct Slot {
+  StorageStream* stream;
+  AdpcmDecoder* dec;
+  int32_t pos;              // Queue position, -1 when closed
+  uint32_t open_us;
+};
+
+// Queue, guarded by lock; everything else belongs to the player task
+static SemaphoreHandle_t lock = NULL;
+static char queue[PLAYER_QUEUE_MAX][LIBRARY_PATH_MAX];
+static uint32_t queue_len = 0;
+
+static std::atomic<int32_t> request(REQ_NONE);
+static TaskHandle_t task = NULL;
+static Slot slots[2];
+static uint8_t cur = 0;
+static int32_t next_scan = 0;       // First queue position not tried as the next track
+static uint32_t seen_seq = 0;
+static PlayerStats stats;
+
+static size_t stream_read(void* ctx, uint8_t* buf, size_t len) {
+  return storage_stream_read((StorageStream*)ctx, buf, len);
+}
+
+static void slot_close(Slot* s) {
+  if (s->stream) storage_stream_close(s->stream);
+  s->stream = NULL;
+  s->pos = -1;
+}
+
+// Open the file at a queue position up to its first audio block
+static bool slot_open(Slot* s, int32_t pos) {
+  char path[LIBRARY_PATH_MAX];
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool valid = pos < (int32_t)queue_len;
+  if (valid) strlcpy(path, queue[pos], sizeof(path));
+  xSemaphoreGive(lock);
+  if (!valid) return false;
+
+  uint32_t t = micros();
+  s->stream = storage_stream_open(path);
+  if (!s->stream) return false;
+  if (!adpcm_open(s->dec, stream_read, s->stream)) {
+    Serial.printf("PLAYER,skip,%s\n", path);
+    slot_close(s);
+    return false;
+  }
+  s->open_us = micros() - t;
+  if (s->open_us > stats.open_max_us) stats.open_max_us = s->open_us;
+  s->pos = pos;
+  return true;
+}
+
+static void start(int32_t pos) {
+  for (; pos < (int32_t)queue_len; pos++) {
+    if (!slot_open(&slots[0], pos)) continue;
+    cur = 0;
+    stats.current = pos;
+    next_scan = pos + 1;
+    AudioTransition t;
+    seen_seq = audio_get_transition(&t);
+    audio_play(adpcm_source(slots[0].dec));
+    return;
+  }
+}
+
+// The engine moved on to the queued track: release the finished one
+static void note_transition(const AudioTransition* t) {
+  Slot* done = &slots[cur];
+  Slot* next = &slots[cur ^ 1];
+  uint32_t gap_us = (uint32_t)((uint64_t)t->gap_frames * 1000000 / t->sample_rate);
+  // PLAYER,transition,<from>,<to>,gap_frames,gap_us,preroll_frames,splice_us,open_us
+  Serial.printf("PLAYER,transition,%d,%d,gap_frames=%u,gap_us=%u,preroll=%u,splice_us=%u,open_us=%u\n",
+                done->pos, next->pos, t->gap_frames, gap_us, t->preroll_frames, t->splice_us, next->open_us);
+  if (t->gap_frames > stats.gap_frames_max) stats.gap_frames_max = t->gap_frames;
+  stats.transitions++;
+
+  slot_close(done);
+  cur ^= 1;
+  stats.current = next->pos;
+  next_scan = next->pos + 1;
+}
+
+static void player_loop(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PLAYER_POLL_MS));
+
+    int32_t req = request.exchange(REQ_NONE);
+    if (req != REQ_NONE) {
+      audio_stop();  // The feeder lets go of both decoders
+      slot_close(&slots[0]);
+      slot_close(&slots[1]);
+      stats.current = -1;
+      if (req >= 0) start(req);
+    }
+    if (stats.current < 0) continue;
+
+    AudioTransition t;
+    if (audio_get_transition(&t) != seen_seq) {
+      seen_seq = t.seq;
+      if (slots[cur ^ 1].pos >= 0) note_transition(&t);
+    }
+
+    // Open the following track early, the engine decodes its start ahead
+    Slot* next = &slots[cur ^ 1];
+    while (next->pos < 0 && next_scan < (int32_t)queue_len) {
+      if (slot_open(next, next_scan)) audio_queue(adpcm_source(next->dec));
+      next_scan++;
+    }
+
+    if (next->pos < 0 && audio_get_state() == AUDIO_STOPPED) {
+      slot_close(&slots[cur]);
+      stats.current = -1;
+    }
+  }
+}
+
+bool player_enqueue(const char* path) {
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool ok = queue_len < PLAYER_QUEUE_MAX && strlen(path) < LIBRARY_PATH_MAX;
+  if (ok) strlcpy(queue[queue_len++], path, LIBRARY_PATH_MAX);
+  xSemaphoreGive(lock);
+  if (ok && task) xTaskNotifyGive(task);  // May be the next track of the current one
+  return ok;
+}
+
+void player_clear() {
+  player_stop();
+  // Positions held by the task stay valid until it handles the stop. With
+  // no task (player_init failed) nothing plays and nothing would handle it.
+  while (task && request.load() != REQ_NONE) delay(1);
+  xSemaphoreTake(lock, portMAX_DELAY);
+  queue_len = 0;
+  xSemaphoreGive(lock);
+}
+
+void player_start(uint32_t pos) {
+  if (!task) return;
+  request = (int32_t)pos;
+  xTaskNotifyGive(task);
+}
+
+void player_skip() {
+  if (stats.current >= 0) player_start(stats.current + 1);
+}
+
+void player_stop() {
+  if (!task) return;
+  request = REQ_STOP;
+  xTaskNotifyGive(task);
+}
+
+void player_get_stats(PlayerStats* out) {
+  *out = stats;
+  out->queued = queue_len;
+}
+
+static void cmd_play(int argc, char** argv) {
+  uint32_t value = 0, count = 1;
+  if (argc > 2 && strcmp(argv[1], "add") == 0) {
+    if (!player_enqueue(argv[2])) Serial.println("play: queue full");
+  } else if (argc > 2 && strcmp(argv[1], "lib") == 0 && console_parse_uint(argv[2], UINT32_MAX, &value)) {
+    if (argc > 3) console_parse_uint(argv[3], PLAYER_QUEUE_MAX, &count);
+    LibraryTrack track;
+    for (uint32_t i = value; i < value + count && library_get_track(i, &track); i++) {
+      if (!player_enqueue(track.path)) break;
+    }
+  } else if (argc > 1 && strcmp(argv[1], "start") == 0) {
+    if (argc > 2) console_parse_uint(argv[2], PLAYER_QUEUE_MAX, &value);
+    player_start(value);
+  } else if (argc > 1 && strcmp(argv[1], "skip") == 0) {
+    player_skip();
+  } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+    player_stop();
+  } else if (argc > 1 && strcmp(argv[1], "clear") == 0) {
+    player_clear();
+  } else if (argc > 1) {
+    Serial.println("usage: play [add <path>|lib <index> [count]|start [pos]|skip|stop|clear]");
+    return;
+  }
+
+  PlayerStats s;
+  player_get_stats(&s);
+  Serial.printf("PLAYER,queued=%u,current=%d,transitions=%u,gap_frames_max=%u,open_max_us=%u\n",
+                s.queued, s.current, s.transitions, s.gap_frames_max, s.open_max_us);
+}
+
+void player_init() {
+  lock = xSemaphoreCreateMutex();
+  stats.current = -1;
+  for (int i = 0; i < 2; i++) {
+    slots[i].dec = (AdpcmDecoder*)malloc(sizeof(AdpcmDecoder));
+    slots[i].stream = NULL;
+    slots[i].pos = -1;
+  }
+  if (!slots[0].dec || !slots[1].dec) return;
+
+  // Below the storage task, which serves its reads
+  xTaskCreatePinnedToCore(player_loop, "player", PLAYER_TASK_STACK, NULL, PLAYER_TASK_PRIORITY, &task, AUDIO_CORE);
+  telemetry_register_task("player", task);
+  console_register("play", "[add <path>|lib <index> [count]|start [pos]|skip|stop|clear] gapless play queue", cmd_play);
+}
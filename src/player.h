@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+struct PlayerStats {
+  uint32_t queued;          // Tracks in the queue
+  int32_t current;          // Queue position playing, -1 when stopped
+  uint32_t transitions;     // Track changes without a stop
+  uint32_t gap_frames_max;  // Worst silence heard at a transition
+  uint32_t open_max_us;     // Slowest file open and header parse (what a cold start would add)
+};
+
+// Start the player task (low priority, AUDIO_CORE) and register the 'play'
+// console command
+void player_init();
+
+// Queue of IMA-ADPCM WAV files on the card. While a track plays the next
+// one is opened and queued in the audio engine, which decodes its start
+// ahead and splices it right after the last frame of the current one.
+bool player_enqueue(const char* path);
+void player_clear();                // Stop and empty the queue
+void player_start(uint32_t pos);    // Play from a queue position (skips files that do not open)
+void player_skip();
+void player_stop();
+
+void player_get_stats(PlayerStats* stats);
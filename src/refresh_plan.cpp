@@ -0,0 +1,152 @@
+#include "refresh_plan.h"
+
+// CASET + RASET with 4 data bytes each, then RAMWR
+#define WINDOW_CMD_BYTES 11
+
+static int32_t window_cost = 0;  // Byte equivalents of one flushed window
+static RefreshPlanStats stats;
+
+static lv_area_t areas[LV_INV_BUF_SIZE];
+static lv_area_t lvgl_areas[LV_INV_BUF_SIZE];
+
+// Rows LVGL renders per chunk for an area this wide
+static int32_t chunk_rows(lv_disp_t* disp, int32_t w) {
+  int32_t rows = disp->driver->draw_buf->size / w;
+#if DISPLAY_TILE_FILTER
+  if (rows >= DISPLAY_TILE_SIZE) rows = rows / DISPLAY_TILE_SIZE * DISPLAY_TILE_SIZE;
+#endif
+  return rows > 0 ? rows : 1;
+}
+
+static int32_t area_windows(lv_disp_t* disp, const lv_area_t* a) {
+  int32_t rows = chunk_rows(disp, lv_area_get_width(a));
+  return (lv_area_get_height(a) + rows - 1) / rows;
+}
+
+static int32_t area_cost(lv_disp_t* disp, const lv_area_t* a) {
+  return area_windows(disp, a) * window_cost + lv_area_get_size(a) * 2;
+}
+
+static bool area_contains(const lv_area_t* outer, const lv_area_t* inner) {
+  return inner->x1 >= outer->x1 && inner->y1 >= outer->y1 && inner->x2 <= outer->x2 && inner->y2 <= outer->y2;
+}
+
+// Same rule as lv_refr_join_area(), for the comparison figures
+static int lvgl_join(lv_area_t* a, int n) {
+  bool joined[LV_INV_BUF_SIZE] = { false };
+  for (int in = 0; in < n; in++) {
+    if (joined[in]) continue;
+    for (int from = 0; from < n; from++) {
+      if (joined[from] || in == from || !_lv_area_is_on(&a[in], &a[from])) continue;
+      lv_area_t j;
+      _lv_area_join(&j, &a[in], &a[from]);
+      if (lv_area_get_size(&j) < lv_area_get_size(&a[in]) + lv_area_get_size(&a[from])) {
+        a[in] = j;
+        joined[from] = true;
+      }
+    }
+  }
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (!joined[i]) a[m++] = a[i];
+  }
+  return m;
+}
+
+// Greedy merging: join the pair that lowers the total cost most, until no pair does
+static int plan(lv_disp_t* disp, lv_area_t* a, int n) {
+  int32_t cost[LV_INV_BUF_SIZE];
+  for (int i = 0; i < n; i++) cost[i] = area_cost(disp, &a[i]);
+
+  while (n > 1) {
+    int32_t best_gain = 0;
+    int bi = -1, bj = -1;
+    lv_area_t best;
+    for (int i = 0; i < n; i++) {
+      for (int j = i + 1; j < n; j++) {
+        lv_area_t m;
+        _lv_area_join(&m, &a[i], &a[j]);
+        int32_t gain = cost[i] + cost[j] - area_cost(disp, &m);
+        if (gain > best_gain) {
+          best_gain = gain;
+          bi = i;
+          bj = j;
+          best = m;
+        }
+      }
+    }
+    if (bi < 0) break;
+
+    a[bi] = best;
+    cost[bi] = area_cost(disp, &best);
+    a[bj] = a[--n];
+    cost[bj] = cost[n];
+
+    // Drop areas the merged window now covers
+    for (int k = 0; k < n; k++) {
+      if (k != bi && area_contains(&a[bi], &a[k])) {
+        a[k] = a[--n];
+        cost[k] = cost[n];
+        if (bi == n) bi = k;
+        k--;
+      }
+    }
+  }
+  return n;
+}
+
+static void plan_refr_timer(lv_timer_t* timer) {
+  lv_disp_t* disp = (lv_disp_t*)timer->user_data;
+
+  // Layout changes invalidate areas too, so settle them before planning
+  if (disp->act_scr) {
+    lv_obj_update_layout(disp->act_scr);
+    if (disp->prev_scr) lv_obj_update_layout(disp->prev_scr);
+    lv_obj_update_layout(disp->top_layer);
+    lv_obj_update_layout(disp->sys_layer);
+  }
+
+  int n = 0;
+  for (uint16_t i = 0; i < disp->inv_p; i++) {
+    if (!disp->inv_area_joined[i]) areas[n++] = disp->inv_areas[i];
+  }
+
+  if (n > 0 && !disp->driver->full_refresh) {
+    memcpy(lvgl_areas, areas, n * sizeof(lv_area_t));
+    int n_lvgl = lvgl_join(lvgl_areas, n);
+    int n_plan = plan(disp, areas, n);
+
+    stats.frames++;
+    stats.areas_in += n;
+    for (int i = 0; i < n_lvgl; i++) {
+      stats.windows_lvgl += area_windows(disp, &lvgl_areas[i]);
+      stats.bytes_lvgl += lv_area_get_size(&lvgl_areas[i]) * 2;
+    }
+    for (int i = 0; i < n_plan; i++) {
+      stats.windows_planned += area_windows(disp, &areas[i]);
+      stats.bytes_planned += lv_area_get_size(&areas[i]) * 2;
+    }
+
+    // Hand the planned set to LVGL
+    for (int i = 0; i < n_plan; i++) {
+      disp->inv_areas[i] = areas[i];
+      disp->inv_area_joined[i] = 0;
+    }
+    disp->inv_p = n_plan;
+  }
+
+  _lv_disp_refr_timer(timer);
+}
+
+void refresh_plan_init(lv_disp_t* disp) {
+  if (!disp || !disp->refr_timer) return;
+
+  // Per-window overhead in bytes at the panel SPI clock
+  window_cost = WINDOW_CMD_BYTES + (int32_t)((uint64_t)REFRESH_PLAN_WINDOW_US * SPI_FREQUENCY / 8 / 1000000);
+  lv_timer_set_cb(disp->refr_timer, plan_refr_timer);
+}
+
+void refresh_plan_get_stats(RefreshPlanStats* out, bool reset) {
+  *out = stats;
+  if (reset) memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include "config.h"
+
+// Refresh planner: runs before each LVGL refresh and merges the invalidated
+// areas into the set of windows with the lowest estimated SPI cost, counting
+// a fixed cost per window (commands, transaction, render pass) plus 2 bytes
+// per pixel. Areas taller than a draw buffer chunk cost one window per chunk.
+
+struct RefreshPlanStats {
+  uint32_t frames;           // Refreshes with at least one dirty area
+  uint32_t areas_in;         // Areas invalidated
+  uint32_t windows_lvgl;     // Windows LVGL's own joining would flush
+  uint32_t windows_planned;  // Windows after planning
+  uint32_t bytes_lvgl;       // Panel bytes for LVGL's own joining
+  uint32_t bytes_planned;    // Panel bytes after planning
+};
+
+// Hook the planner into the display's refresh timer
+void refresh_plan_init(lv_disp_t* disp);
+
+void refresh_plan_get_stats(RefreshPlanStats* stats, bool reset);
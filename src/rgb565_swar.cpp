@@ -0,0 +1,230 @@
+#include "rgb565_swar.h"
+
+// A word holding pixels p1:p0 is split into two words whose colour fields have
+// at least five spare bits above them, so a whole word can be scaled by a 0-32
+// alpha with one multiply and no carries between fields:
+//   x = w & MASK_X        -> B0 (0-4), R0 (11-15), G1 (21-26)
+//   y = (w >> 5) & MASK_Y -> G0 (0-5), B1 (11-15), R1 (22-26)
+#define MASK_X 0x07E0F81Fu
+#define MASK_Y 0x07C0F83Fu
+
+// Single pixel spread as G in the high half and R, B in the low half
+#define MASK_E 0x07E0F81Fu
+
+static inline uint16_t swap16(uint16_t c) {
+  return (c >> 8) | (c << 8);
+}
+
+static inline uint32_t swap16x2(uint32_t w) {
+  return ((w & 0x00FF00FFu) << 8) | ((w >> 8) & 0x00FF00FFu);
+}
+
+static inline uint32_t alpha5(uint8_t a8) {
+  return (a8 + 4) >> 3;
+}
+
+static inline uint32_t alpha5_from4(uint8_t a4) {
+  return (a4 * 17 + 4) >> 3;
+}
+
+static inline uint16_t blend1(uint16_t bg, uint16_t fg, uint32_t a) {
+  uint32_t e = (bg | ((uint32_t)bg << 16)) & MASK_E;
+  uint32_t f = (fg | ((uint32_t)fg << 16)) & MASK_E;
+  e = ((e * (32 - a) + f * a) >> 5) & MASK_E;
+  return (uint16_t)(e | (e >> 16));
+}
+
+// Blend a pixel pair sharing one alpha; fx_a and fy_a are the split colour times alpha
+static inline uint32_t blend2(uint32_t w, uint32_t fx_a, uint32_t fy_a, uint32_t ia) {
+  uint32_t x = w & MASK_X;
+  uint32_t y = (w >> 5) & MASK_Y;
+  x = ((x * ia + fx_a) >> 5) & MASK_X;
+  y = ((y * ia + fy_a) >> 5) & MASK_Y;
+  return x | (y << 5);
+}
+
+template <bool SW> static inline uint16_t load1(const uint16_t* p) { return SW ? swap16(*p) : *p; }
+template <bool SW> static inline void store1(uint16_t* p, uint16_t c) { *p = SW ? swap16(c) : c; }
+template <bool SW> static inline uint32_t load2(const uint32_t* p) { return SW ? swap16x2(*p) : *p; }
+template <bool SW> static inline void store2(uint32_t* p, uint32_t w) { *p = SW ? swap16x2(w) : w; }
+
+/***************************************************************************************
+** Kernels
+***************************************************************************************/
+
+template <bool SW> static void FAST_MEM_ATTR fill_t(uint16_t* dst, uint16_t color, uint32_t len) {
+  uint16_t c = SW ? swap16(color) : color;
+  if (len && ((uintptr_t)dst & 2)) { *dst++ = c; len--; }
+
+  uint32_t c2 = c | ((uint32_t)c << 16);
+  uint32_t* d = (uint32_t*)dst;
+  while (len >= 8) {
+    d[0] = c2; d[1] = c2; d[2] = c2; d[3] = c2;
+    d += 4;
+    len -= 8;
+  }
+  while (len >= 2) { *d++ = c2; len -= 2; }
+  if (len) *(uint16_t*)d = c;
+}
+
+template <bool SW> static void FAST_MEM_ATTR blend_const_t(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len) {
+  uint32_t a = alpha5(alpha);
+  if (a == 0) return;
+  if (a == 32) { fill_t<SW>(dst, color, len); return; }
+  uint32_t ia = 32 - a;
+
+  if (len && ((uintptr_t)dst & 2)) { store1<SW>(dst, blend1(load1<SW>(dst), color, a)); dst++; len--; }
+
+  uint32_t c2 = color | ((uint32_t)color << 16);
+  uint32_t fx_a = (c2 & MASK_X) * a;
+  uint32_t fy_a = ((c2 >> 5) & MASK_Y) * a;
+  uint32_t* d = (uint32_t*)dst;
+  for (; len >= 2; len -= 2, d++) store2<SW>(d, blend2(load2<SW>(d), fx_a, fy_a, ia));
+
+  if (len) store1<SW>((uint16_t*)d, blend1(load1<SW>((uint16_t*)d), color, a));
+}
+
+// Shared body for the mask blends; alpha_at(i) returns the 0-32 alpha of pixel i
+template <bool SW, typename AlphaAt>
+static inline __attribute__((always_inline)) void blend_mask_t(uint16_t* dst, uint16_t color, uint32_t len, AlphaAt alpha_at) {
+  uint16_t cs = SW ? swap16(color) : color;
+  uint32_t cs2 = cs | ((uint32_t)cs << 16);
+  uint32_t c2 = color | ((uint32_t)color << 16);
+  uint32_t fx = c2 & MASK_X;
+  uint32_t fy = (c2 >> 5) & MASK_Y;
+  uint32_t i = 0;
+
+  if (len && ((uintptr_t)dst & 2)) {
+    uint32_t a = alpha_at(0);
+    if (a == 32) *dst = cs;
+    else if (a) store1<SW>(dst, blend1(load1<SW>(dst), color, a));
+    i = 1;
+  }
+
+  uint32_t* d = (uint32_t*)(dst + i);
+  for (; i + 1 < len; i += 2, d++) {
+    uint32_t a0 = alpha_at(i);
+    uint32_t a1 = alpha_at(i + 1);
+    if (a0 == a1) {
+      // Masks are mostly runs of fully transparent or opaque pixels
+      if (a0 == 0) continue;
+      if (a0 == 32) { *d = cs2; continue; }
+      store2<SW>(d, blend2(load2<SW>(d), fx * a0, fy * a0, 32 - a0));
+    } else {
+      uint16_t* p = (uint16_t*)d;
+      if (a0) store1<SW>(p, blend1(load1<SW>(p), color, a0));
+      if (a1) store1<SW>(p + 1, blend1(load1<SW>(p + 1), color, a1));
+    }
+  }
+
+  if (i < len) {
+    uint32_t a = alpha_at(i);
+    uint16_t* p = (uint16_t*)d;
+    if (a) store1<SW>(p, blend1(load1<SW>(p), color, a));
+  }
+}
+
+template <bool SW> static void FAST_MEM_ATTR blend_a8_t(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len) {
+  blend_mask_t<SW>(dst, color, len, [mask](uint32_t i) { return alpha5(mask[i]); });
+}
+
+template <bool SW> static void FAST_MEM_ATTR blend_a4_t(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len) {
+  blend_mask_t<SW>(dst, color, len, [mask4](uint32_t i) {
+    return alpha5_from4((i & 1) ? (mask4[i >> 1] & 0x0F) : (mask4[i >> 1] >> 4));
+  });
+}
+
+void swar_fill(uint16_t* dst, uint16_t color, uint32_t len) { fill_t<false>(dst, color, len); }
+void swar_blend_const(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len) { blend_const_t<false>(dst, color, alpha, len); }
+void swar_blend_a8(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len) { blend_a8_t<false>(dst, color, mask, len); }
+void swar_blend_a4(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len) { blend_a4_t<false>(dst, color, mask4, len); }
+
+void swar_fill_sw(uint16_t* dst, uint16_t color, uint32_t len) { fill_t<true>(dst, color, len); }
+void swar_blend_const_sw(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len) { blend_const_t<true>(dst, color, alpha, len); }
+void swar_blend_a8_sw(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len) { blend_a8_t<true>(dst, color, mask, len); }
+void swar_blend_a4_sw(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len) { blend_a4_t<true>(dst, color, mask4, len); }
+
+/***************************************************************************************
+** Scalar references (per channel, same 0-32 alpha rounding)
+***************************************************************************************/
+
+static inline uint16_t scalar_blend(uint16_t bg, uint16_t fg, uint32_t a) {
+  uint32_t r = (((fg >> 11) & 0x1F) * a + ((bg >> 11) & 0x1F) * (32 - a)) >> 5;
+  uint32_t g = (((fg >> 5) & 0x3F) * a + ((bg >> 5) & 0x3F) * (32 - a)) >> 5;
+  uint32_t b = ((fg & 0x1F) * a + (bg & 0x1F) * (32 - a)) >> 5;
+  return (r << 11) | (g << 5) | b;
+}
+
+void scalar_blend_const(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len) {
+  uint32_t a = alpha5(alpha);
+  for (uint32_t i = 0; i < len; i++) dst[i] = scalar_blend(dst[i], color, a);
+}
+
+void scalar_blend_a8(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) dst[i] = scalar_blend(dst[i], color, alpha5(mask[i]));
+}
+
+void scalar_blend_a4(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t a4 = (i & 1) ? (mask4[i >> 1] & 0x0F) : (mask4[i >> 1] >> 4);
+    dst[i] = scalar_blend(dst[i], color, alpha5_from4(a4));
+  }
+}
+
+#ifndef CYD_HOST
+/***************************************************************************************
+** LVGL blend hook
+***************************************************************************************/
+
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0
+static void FAST_MEM_ATTR swar_lv_blend(lv_draw_ctx_t* draw_ctx, const lv_draw_sw_blend_dsc_t* dsc) {
+  if (dsc->mask_buf && dsc->mask_res == LV_DRAW_MASK_RES_TRANSP) return;
+
+  const lv_opa_t* mask = NULL;
+  if (dsc->mask_buf && dsc->mask_res != LV_DRAW_MASK_RES_FULL_COVER) mask = dsc->mask_buf;
+
+  // Only plain colour fills are handled here, everything else goes to LVGL
+  lv_disp_t* disp = _lv_refr_get_disp_refreshing();
+  if (dsc->src_buf != NULL || dsc->blend_mode != LV_BLEND_MODE_NORMAL || dsc->opa <= LV_OPA_MIN ||
+      disp->driver->set_px_cb != NULL || disp->driver->screen_transp || (mask && dsc->opa < LV_OPA_MAX)) {
+    lv_draw_sw_blend_basic(draw_ctx, dsc);
+    return;
+  }
+
+  lv_area_t blend_area;
+  if (!_lv_area_intersect(&blend_area, dsc->blend_area, draw_ctx->clip_area)) return;
+
+  lv_coord_t dest_stride = lv_area_get_width(draw_ctx->buf_area);
+  uint16_t* dest = (uint16_t*)draw_ctx->buf + dest_stride * (blend_area.y1 - draw_ctx->buf_area->y1) +
+                   (blend_area.x1 - draw_ctx->buf_area->x1);
+
+  lv_coord_t mask_stride = 0;
+  if (mask) {
+    mask_stride = lv_area_get_width(dsc->mask_area);
+    mask += mask_stride * (blend_area.y1 - dsc->mask_area->y1) + (blend_area.x1 - dsc->mask_area->x1);
+  }
+
+  int32_t w = lv_area_get_width(&blend_area);
+  int32_t h = lv_area_get_height(&blend_area);
+  uint16_t color = dsc->color.full;
+
+  for (int32_t y = 0; y < h; y++, dest += dest_stride) {
+    if (mask) {
+      swar_blend_a8(dest, color, mask, w);
+      mask += mask_stride;
+    } else if (dsc->opa >= LV_OPA_MAX) {
+      swar_fill(dest, color, w);
+    } else {
+      swar_blend_const(dest, color, dsc->opa, w);
+    }
+  }
+}
+#endif
+
+void swar_lv_draw_ctx_init(lv_disp_drv_t* drv, lv_draw_ctx_t* draw_ctx) {
+  lv_draw_sw_init_ctx(drv, draw_ctx);
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0
+  ((lv_draw_sw_ctx_t*)draw_ctx)->blend = swar_lv_blend;
+#endif
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#ifndef CYD_HOST
+#include <lvgl.h>
+#endif
+#include "config.h"
+
+// RGB565 fill and blend kernels working on two pixels per 32-bit word.
+// Alpha is 0-255 and is quantised to 0-32 internally, as TFT_eSPI's fastBlend.
+// The "_sw" variants work on byte-swapped buffers (panel order, as sprites and
+// the smooth_raster spans), colours are always passed in native RGB565.
+
+void swar_fill(uint16_t* dst, uint16_t color, uint32_t len);
+void swar_blend_const(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len);
+void swar_blend_a8(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len);
+void swar_blend_a4(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len);  // High nibble first
+
+void swar_fill_sw(uint16_t* dst, uint16_t color, uint32_t len);
+void swar_blend_const_sw(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len);
+void swar_blend_a8_sw(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len);
+void swar_blend_a4_sw(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len);
+
+// Per-pixel reference versions with identical rounding, for checks and benchmarks
+void scalar_blend_const(uint16_t* dst, uint16_t color, uint8_t alpha, uint32_t len);
+void scalar_blend_a8(uint16_t* dst, uint16_t color, const uint8_t* mask, uint32_t len);
+void scalar_blend_a4(uint16_t* dst, uint16_t color, const uint8_t* mask4, uint32_t len);
+
+#ifndef CYD_HOST
+// LVGL draw context init that routes plain colour fills and A8-masked fills
+// through the kernels (set as lv_disp_drv_t::draw_ctx_init)
+void swar_lv_draw_ctx_init(lv_disp_drv_t* drv, lv_draw_ctx_t* draw_ctx);
+#endif
@@ -0,0 +1,155 @@
+#include "smooth_raster.h"
+#include "rgb565_swar.h"
+
+// Distances are in Q6 fixed point (1/64 pixel), the segment parameter h in Q16
+#define FP_SHIFT 6
+#define FP_ONE   (1 << FP_SHIFT)
+#define H_ONE    65536
+
+// Same coverage thresholds as TFT_eSPI (1/32 pixel)
+#define ALPHA_LO (FP_ONE / 32)
+#define ALPHA_HI (FP_ONE - ALPHA_LO)
+
+// Two output rows so a DMA transfer can run while the next row is computed
+static uint16_t span_buf[2][RASTER_MAX_SPAN];
+static uint16_t bg_buf[RASTER_MAX_SPAN];
+static uint8_t  alpha_buf[RASTER_MAX_SPAN];
+static uint8_t  span_sel = 0;
+
+static uint32_t isqrt32(uint32_t n) {
+  uint32_t res = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > n) bit >>= 2;
+  while (bit) {
+    if (n >= res + bit) {
+      n -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
+
+void raster_wedge_line(TFT_eSPI* tft, float ax, float ay, float bx, float by, float ar, float br,
+                       uint32_t fg_color, uint32_t bg_color) {
+  if ((ar < 0.0f) || (br < 0.0f)) return;
+  if ((fabsf(ax - bx) < 0.01f) && (fabsf(ay - by) < 0.01f)) bx += 0.01f;  // Avoid divide by zero
+
+  // Bounding box, clipped to the panel
+  int32_t x0 = (int32_t)floorf(fminf(ax - ar, bx - br));
+  int32_t x1 = (int32_t) ceilf(fmaxf(ax + ar, bx + br));
+  int32_t y0 = (int32_t)floorf(fminf(ay - ar, by - br));
+  int32_t y1 = (int32_t) ceilf(fmaxf(ay + ar, by + br));
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 >= tft->width()) x1 = tft->width() - 1;
+  if (y1 >= tft->height()) y1 = tft->height() - 1;
+  if (x1 - x0 >= RASTER_MAX_SPAN) x1 = x0 + RASTER_MAX_SPAN - 1;
+  if (x0 > x1 || y0 > y1) return;
+
+  const int32_t AX  = lroundf(ax * FP_ONE);
+  const int32_t AY  = lroundf(ay * FP_ONE);
+  const int32_t BAX = lroundf((bx - ax) * FP_ONE);
+  const int32_t BAY = lroundf((by - ay) * FP_ONE);
+  int64_t len2 = (int64_t)BAX * BAX + (int64_t)BAY * BAY;
+  if (len2 == 0) len2 = 1;
+
+  // Radius at a (plus half a pixel, as TFT_eSPI) and its change along the segment
+  const int32_t R0 = lroundf((ar + 0.5f) * FP_ONE);
+  const int32_t DR = lroundf((ar - br) * FP_ONE);
+
+  // h advances by a constant per pixel along a row. It is accumulated with 16
+  // extra fraction bits so the error stays far below a pixel across the span.
+  const int64_t dh = (((int64_t)BAX * FP_ONE * H_ONE) << 16) / len2;
+
+  const bool read_bg = (bg_color == 0x00FFFFFF);
+  const uint16_t fg = fg_color;
+  const uint16_t bg = bg_color;
+
+  // Rows are prepared in panel byte order
+  bool swap = tft->getSwapBytes();
+  tft->setSwapBytes(false);
+  tft->startWrite();
+
+  for (int32_t yp = y0; yp <= y1; yp++) {
+    const int32_t pay = yp * FP_ONE - AY;
+    int32_t pax = x0 * FP_ONE - AX;
+    int64_t h = ((((int64_t)pax * BAX + (int64_t)pay * BAY) * H_ONE) << 16) / len2;
+
+    int32_t xl = 0;
+    int32_t n = 0;
+    bool partial = false;
+
+    // The shape is convex, so each row has a single covered span
+    for (int32_t xp = x0; xp <= x1; xp++, pax += FP_ONE, h += dh) {
+      int32_t hc = h < 0 ? 0 : (h >= ((int64_t)H_ONE << 16) ? H_ONE : (int32_t)(h >> 16));
+      int32_t dx = pax - (int32_t)(((int64_t)BAX * hc) >> 16);
+      int32_t dy = pay - (int32_t)(((int64_t)BAY * hc) >> 16);
+      uint32_t d2 = (uint32_t)(dx * dx) + (uint32_t)(dy * dy);
+      int32_t r = R0 - (int32_t)(((int64_t)DR * hc) >> 16);
+
+      // Compare squared distances first, only edge pixels need a square root
+      int32_t lo = r - ALPHA_LO;
+      if (lo <= 0 || d2 >= (uint32_t)(lo * lo)) {
+        if (n) break;
+        continue;
+      }
+
+      uint8_t a;
+      int32_t hi = r - ALPHA_HI;
+      if (hi > 0 && d2 < (uint32_t)(hi * hi)) {
+        a = 255;
+      } else {
+        int32_t alpha = r - (int32_t)isqrt32(d2);
+        a = alpha >= FP_ONE ? 255 : (uint8_t)((alpha * 255) >> FP_SHIFT);
+        partial = true;
+      }
+
+      if (!n) xl = xp;
+      alpha_buf[n++] = a;
+    }
+    if (!n) continue;
+
+    // One read turnaround per row for the whole span
+    if (read_bg && partial) {
+      if (tft->DMA_Enabled) tft->dmaWait();
+      tft->readRect(xl, yp, n, 1, bg_buf);
+    }
+
+    // Background first, then the coverage blended over it two pixels at a time
+    uint16_t* out = span_buf[span_sel];
+    if (!partial) {
+      swar_fill_sw(out, fg, n);
+    } else {
+      if (read_bg) memcpy(out, bg_buf, n * sizeof(uint16_t));
+      else swar_fill_sw(out, bg, n);
+      swar_blend_a8_sw(out, fg, alpha_buf, n);
+    }
+
+    if (tft->DMA_Enabled) {
+      tft->dmaWait();  // The address window cannot change under a running transfer
+      tft->setAddrWindow(xl, yp, n, 1);
+      tft->pushPixelsDMA(out, n);
+      span_sel ^= 1;
+    } else {
+      tft->setAddrWindow(xl, yp, n, 1);
+      tft->pushPixels(out, n);
+    }
+  }
+
+  if (tft->DMA_Enabled) tft->dmaWait();
+  tft->endWrite();
+  tft->setSwapBytes(swap);
+}
+
+void raster_wide_line(TFT_eSPI* tft, float ax, float ay, float bx, float by, float wd,
+                      uint32_t fg_color, uint32_t bg_color) {
+  raster_wedge_line(tft, ax, ay, bx, by, wd / 2.0f, wd / 2.0f, fg_color, bg_color);
+}
+
+void raster_spot(TFT_eSPI* tft, float ax, float ay, float r, uint32_t fg_color, uint32_t bg_color) {
+  // A filled circle is a wedge line of zero length
+  raster_wedge_line(tft, ax, ay, ax, ay, r, r, fg_color, bg_color);
+}
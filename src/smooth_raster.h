@@ -0,0 +1,15 @@
+#pragma once
+
+#include <TFT_eSPI.h>
+#include "config.h"
+
+// Span-buffered replacements for TFT_eSPI::drawWedgeLine, drawWideLine and
+// drawSpot. Coverage is computed in fixed point, each row is sent with one
+// pushPixels (or DMA) call, and an unknown background (bg_color = 0x00FFFFFF)
+// is fetched with one readRect per row instead of readPixel per edge pixel.
+void raster_wedge_line(TFT_eSPI* tft, float ax, float ay, float bx, float by, float ar, float br,
+                       uint32_t fg_color, uint32_t bg_color = 0x00FFFFFF);
+void raster_wide_line(TFT_eSPI* tft, float ax, float ay, float bx, float by, float wd,
+                      uint32_t fg_color, uint32_t bg_color = 0x00FFFFFF);
+void raster_spot(TFT_eSPI* tft, float ax, float ay, float r,
+                 uint32_t fg_color, uint32_t bg_color = 0x00FFFFFF);
@@ -0,0 +1,293 @@
+#include "spectrum.h"
+#include "audio.h"
+#include "console.h"
+#include "display.h"
+#include "theme.h"
+
+#define HALF (SPECTRUM_FFT_N / 2)
+
+// Twiddles e^(-2*pi*i*k/N) for k < N/2, and a Hann window, Q15
+static int16_t tw_re[HALF], tw_im[HALF];
+static float tw_ref[HALF], tw_imf[HALF];
+static int16_t window[SPECTRUM_FFT_N];
+
+// First FFT bin of each bar, log spaced, plus the end
+static uint16_t bar_bin[SPECTRUM_BARS + 1];
+
+// Work buffers, shared by all visualizers (they all run in the LVGL thread)
+static int16_t samples[SPECTRUM_FFT_N];
+static int16_t buf_re[SPECTRUM_FFT_N], buf_im[SPECTRUM_FFT_N];
+static float buf_ref[SPECTRUM_FFT_N], buf_imf[SPECTRUM_FFT_N];
+
+static SpectrumStats stats;
+
+struct Spectrum {
+  lv_timer_t* timer;
+  uint32_t last_ms;
+  bool repaint;                     // LVGL painted the background over the bars
+  uint8_t shown[SPECTRUM_BARS];     // Bar heights on the panel
+};
+
+template <typename T>
+static void bit_reverse(T* re, T* im) {
+  for (uint32_t i = 1, j = 0; i < SPECTRUM_FFT_N; i++) {
+    uint32_t bit = HALF;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j |= bit;
+    if (i < j) {
+      T t = re[i]; re[i] = re[j]; re[j] = t;
+      t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+  }
+}
+
+void spectrum_fft_q15(int16_t* re, int16_t* im) {
+  bit_reverse(re, im);
+  for (uint32_t len = 2, step = HALF; len <= SPECTRUM_FFT_N; len <<= 1, step >>= 1) {
+    uint32_t half = len >> 1;
+    for (uint32_t j = 0; j < half; j++) {
+      int32_t wr = tw_re[j * step], wi = tw_im[j * step];
+      for (uint32_t a = j; a < SPECTRUM_FFT_N; a += len) {
+        uint32_t b = a + half;
+        int32_t tr = (re[b] * wr - im[b] * wi) >> 15;
+        int32_t ti = (re[b] * wi + im[b] * wr) >> 15;
+        int32_t ar = re[a], ai = im[a];
+        // Halving each stage keeps every butterfly within 16 bits
+        re[b] = (int16_t)((ar - tr) >> 1);
+        im[b] = (int16_t)((ai - ti) >> 1);
+        re[a] = (int16_t)((ar + tr) >> 1);
+        im[a] = (int16_t)((ai + ti) >> 1);
+      }
+    }
+  }
+}
+
+void spectrum_fft_float(float* re, float* im) {
+  bit_reverse(re, im);
+  for (uint32_t len = 2, step = HALF; len <= SPECTRUM_FFT_N; len <<= 1, step >>= 1) {
+    uint32_t half = len >> 1;
+    for (uint32_t j = 0; j < half; j++) {
+      float wr = tw_ref[j * step], wi = tw_imf[j * step];
+      for (uint32_t a = j; a < SPECTRUM_FFT_N; a += len) {
+        uint32_t b = a + half;
+        float tr = re[b] * wr - im[b] * wi;
+        float ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
+
+// log2 with 4 fraction bits
+static int32_t log2_q4(uint32_t v) {
+  if (v == 0) return 0;
+  int32_t e = 31 - __builtin_clz(v);
+  uint32_t frac = e >= 4 ? (v >> (e - 4)) & 15 : (v << (4 - e)) & 15;
+  return e * 16 + frac;
+}
+
+// Bin power (of the transform divided by N) to a bar height, log scale
+static uint8_t power_to_height(uint32_t power, int32_t height) {
+  int32_t l = log2_q4(power) - SPECTRUM_FLOOR_LOG2 * 16;
+  if (l <= 0) return 0;
+  int32_t h = l * height / ((SPECTRUM_TOP_LOG2 - SPECTRUM_FLOOR_LOG2) * 16);
+  return (uint8_t)(h < height ? h : height);
+}
+
+// Bar heights of the latest tap window, false when nothing plays
+static bool analyze(uint8_t* level, int32_t height) {
+  if (!audio_read_tap(samples, SPECTRUM_FFT_N, SPECTRUM_DECIMATE)) return false;
+
+  uint32_t power[HALF];
+  if (stats.use_float) {
+    for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) {
+      buf_ref[i] = samples[i] * (float)window[i] * (1.0f / (32768.0f * SPECTRUM_FFT_N));
+      buf_imf[i] = 0;
+    }
+    spectrum_fft_float(buf_ref, buf_imf);
+    for (uint32_t k = 1; k < HALF; k++) {
+      float p = buf_ref[k] * buf_ref[k] + buf_imf[k] * buf_imf[k];
+      power[k] = p < 2147483647.0f ? (uint32_t)p : 2147483647u;
+    }
+  } else {
+    for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) {
+      buf_re[i] = (int16_t)((samples[i] * window[i]) >> 15);
+      buf_im[i] = 0;
+    }
+    spectrum_fft_q15(buf_re, buf_im);
+    for (uint32_t k = 1; k < HALF; k++) {
+      power[k] = (uint32_t)(buf_re[k] * buf_re[k]) + (uint32_t)(buf_im[k] * buf_im[k]);
+    }
+  }
+
+  // Each bar shows its loudest bin
+  for (uint32_t b = 0; b < SPECTRUM_BARS; b++) {
+    uint32_t p = 0;
+    for (uint32_t k = bar_bin[b]; k < bar_bin[b + 1]; k++) p = max(p, power[k]);
+    level[b] = power_to_height(p, height);
+  }
+  return true;
+}
+
+static void frame_cb(lv_timer_t* timer) {
+  lv_obj_t* obj = (lv_obj_t*)timer->user_data;
+  Spectrum* s = (Spectrum*)lv_obj_get_user_data(obj);
+  if (lv_obj_get_screen(obj) != lv_scr_act() || !lv_obj_is_visible(obj)) return;
+
+  uint32_t now = millis();
+  if (s->last_ms && now - s->last_ms > SPECTRUM_PERIOD_MS * 3 / 2) stats.late++;
+  s->last_ms = now;
+
+  lv_area_t area;
+  lv_obj_get_content_coords(obj, &area);
+  int32_t height = min<int32_t>(lv_area_get_height(&area), 255);
+  int32_t bar_w = lv_area_get_width(&area) / SPECTRUM_BARS;
+  if (height <= 0 || bar_w < 2) return;
+
+  uint32_t t = micros();
+  uint8_t level[SPECTRUM_BARS];
+  if (!analyze(level, height)) memset(level, 0, sizeof(level));
+  uint32_t t_analyze = micros() - t;
+
+  // Grow or shrink each bar by the difference only. After LVGL redrew any
+  // part of the area (only its clip, perhaps) nothing on the panel is known,
+  // so every column is painted in full: background above, bar below.
+  bool repaint = s->repaint;
+  s->repaint = false;
+  t = micros();
+  TFT_eSPI* tft = display_get_tft();
+  uint16_t fg = lv_color_to16(SPOTIFY_GREEN);
+  uint16_t bg = lv_color_to16(SPOTIFY_BLACK);
+  int32_t base = area.y2 + 1;
+  int32_t x_min = INT32_MAX, x_max = 0, y_min = base;
+  tft->startWrite();
+  for (uint32_t b = 0; b < SPECTRUM_BARS; b++) {
+    int32_t old_h = s->shown[b];
+    int32_t new_h = max<int32_t>(level[b], old_h - SPECTRUM_FALL);
+    if (new_h == old_h && !repaint) continue;
+
+    int32_t x = area.x1 + b * bar_w;
+    int32_t top = base - max(new_h, old_h);
+    if (repaint) {
+      top = base - height;
+      tft->fillRect(x, top, bar_w - 1, height - new_h, bg);
+      tft->fillRect(x, base - new_h, bar_w - 1, new_h, fg);
+      stats.px_sum += (bar_w - 1) * height;
+    } else if (new_h > old_h) {
+      tft->fillRect(x, base - new_h, bar_w - 1, new_h - old_h, fg);
+      stats.px_sum += (bar_w - 1) * (new_h - old_h);
+    } else {
+      tft->fillRect(x, top, bar_w - 1, old_h - new_h, bg);
+      stats.px_sum += (bar_w - 1) * (old_h - new_h);
+    }
+    s->shown[b] = new_h;
+    x_min = min(x_min, x);
+    x_max = max(x_max, x + bar_w - 1);
+    y_min = min(y_min, top);
+  }
+  tft->endWrite();
+  if (x_min <= x_max) display_invalidate_tiles(x_min, y_min, x_max - x_min + 1, base - y_min);
+  uint32_t t_draw = micros() - t;
+
+  stats.frames++;
+  if (t_analyze > stats.analyze_max_us) stats.analyze_max_us = t_analyze;
+  if (t_draw > stats.draw_max_us) stats.draw_max_us = t_draw;
+}
+
+static void event_cb(lv_event_t* e) {
+  lv_obj_t* obj = lv_event_get_target(e);
+  Spectrum* s = (Spectrum*)lv_obj_get_user_data(obj);
+  lv_event_code_t code = lv_event_get_code(e);
+
+  if (code == LV_EVENT_DRAW_MAIN) {
+    s->repaint = true;
+  } else if (code == LV_EVENT_DELETE) {
+    lv_timer_del(s->timer);
+    lv_mem_free(s);
+  }
+}
+
+lv_obj_t* spectrum_create(lv_obj_t* parent) {
+  lv_obj_t* obj = lv_obj_create(parent);
+  lv_obj_clear_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_set_style_bg_color(obj, SPOTIFY_BLACK, 0);
+  lv_obj_set_style_bg_opa(obj, LV_OPA_COVER, 0);
+  lv_obj_set_style_border_width(obj, 0, 0);
+  lv_obj_set_style_radius(obj, 0, 0);
+
+  Spectrum* s = (Spectrum*)lv_mem_alloc(sizeof(Spectrum));
+  memset(s, 0, sizeof(*s));
+  s->repaint = true;
+  s->timer = lv_timer_create(frame_cb, SPECTRUM_PERIOD_MS, obj);
+  lv_obj_set_user_data(obj, s);
+  lv_obj_add_event_cb(obj, event_cb, LV_EVENT_ALL, NULL);
+  return obj;
+}
+
+void spectrum_get_stats(SpectrumStats* out, bool reset) {
+  *out = stats;
+  if (reset) {
+    stats.frames = 0;
+    stats.late = 0;
+    stats.analyze_max_us = 0;
+    stats.draw_max_us = 0;
+    stats.px_sum = 0;
+  }
+}
+
+static void build_tables() {
+  for (uint32_t k = 0; k < HALF; k++) {
+    float a = -2.0f * (float)M_PI * k / SPECTRUM_FFT_N;
+    tw_ref[k] = cosf(a);
+    tw_imf[k] = sinf(a);
+    tw_re[k] = (int16_t)lrintf(min(tw_ref[k] * 32768.0f, 32767.0f));
+    tw_im[k] = (int16_t)lrintf(min(tw_imf[k] * 32768.0f, 32767.0f));
+  }
+  for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) {
+    float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (SPECTRUM_FFT_N - 1));
+    window[i] = (int16_t)lrintf(min(w * 32768.0f, 32767.0f));
+  }
+
+  // Bar b starts at bin (N/2)^(b/BARS), at least one bin per bar, DC skipped
+  bar_bin[0] = 1;
+  for (uint32_t b = 1; b <= SPECTRUM_BARS; b++) {
+    uint32_t k = (uint32_t)lrintf(powf(HALF, (float)b / SPECTRUM_BARS));
+    bar_bin[b] = (uint16_t)min<uint32_t>(max<uint32_t>(k, bar_bin[b - 1] + 1), HALF);
+  }
+  bar_bin[SPECTRUM_BARS] = HALF;
+}
+
+// Time both paths on the same input, the faster one draws
+static void calibrate() {
+  for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) samples[i] = (int16_t)(random(-16384, 16384));
+  uint32_t t = micros();
+  for (int r = 0; r < 8; r++) {
+    for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) { buf_re[i] = samples[i]; buf_im[i] = 0; }
+    spectrum_fft_q15(buf_re, buf_im);
+  }
+  stats.q15_us = (micros() - t) / 8;
+  t = micros();
+  for (int r = 0; r < 8; r++) {
+    for (uint32_t i = 0; i < SPECTRUM_FFT_N; i++) { buf_ref[i] = samples[i]; buf_imf[i] = 0; }
+    spectrum_fft_float(buf_ref, buf_imf);
+  }
+  stats.float_us = (micros() - t) / 8;
+  stats.use_float = stats.float_us < stats.q15_us;
+}
+
+static void cmd_spectrum(int argc, char** argv) {
+  SpectrumStats s;
+  spectrum_get_stats(&s, true);
+  Serial.printf("SPECTRUM,path=%s,q15_us=%u,float_us=%u,frames=%u,late=%u,analyze_max_us=%u,draw_max_us=%u,px_per_frame=%u\n",
+                s.use_float ? "float" : "q15", s.q15_us, s.float_us, s.frames, s.late,
+                s.analyze_max_us, s.draw_max_us, s.frames ? s.px_sum / s.frames : 0);
+}
+
+void spectrum_init() {
+  build_tables();
+  calibrate();
+  console_register("spectrum", "visualizer FFT path and frame statistics", cmd_spectrum);
+}
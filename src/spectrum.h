@@ -0,0 +1,34 @@
+#pragma once
+
+#include <lvgl.h>
+#include "config.h"
+
+#define SPECTRUM_FFT_N (1 << SPECTRUM_FFT_LOG2)
+
+struct SpectrumStats {
+  bool use_float;             // Path chosen by the calibration in spectrum_init
+  uint32_t q15_us;            // One FFT, fixed point
+  uint32_t float_us;          // One FFT, single-precision FPU
+  uint32_t frames;
+  uint32_t late;              // Frames started over 1.5 periods after the previous one
+  uint32_t analyze_max_us;    // Tap read, window, FFT and bar levels
+  uint32_t draw_max_us;       // Panel writes
+  uint32_t px_sum;            // Pixels written to the panel
+};
+
+// Build the FFT tables, time both FFT paths and keep the faster one, and
+// register the 'spectrum' console command
+void spectrum_init();
+
+// Spectrum bars of the audio being played, SPECTRUM_PERIOD_MS per frame.
+// The object is only a placeholder: bars are drawn straight to the panel
+// from an LVGL timer, growing or shrinking only the bars that changed, and
+// repainted in full whenever LVGL redraws the area. Nothing may overlap it.
+lv_obj_t* spectrum_create(lv_obj_t* parent);
+
+// In-place forward FFTs of SPECTRUM_FFT_N points, radix-2. The fixed-point
+// one halves every stage, so its output is the transform divided by N.
+void spectrum_fft_q15(int16_t* re, int16_t* im);
+void spectrum_fft_float(float* re, float* im);
+
+void spectrum_get_stats(SpectrumStats* stats, bool reset);
@@ -0,0 +1,242 @@
+#include <LittleFS.h>
+#include "splash.h"
+
+#define SPLASH_MAGIC 0x4C505331  // "1SPL"
+#define SPLASH_TMP_PATH "/splash.tmp"
+#define SPLASH_IO_SIZE 512
+
+// File layout: header, then PackBits-style packets over 16-bit pixels.
+// Control byte 0-127: literal of (c + 1) pixels follows.
+// Control byte 128-255: run of (c - 126) copies of the next pixel.
+// Pixels are stored in panel byte order, as returned by readRect().
+struct SplashHeader {
+  uint32_t magic;
+  uint16_t width;
+  uint16_t height;
+  uint8_t  rotation;
+  uint8_t  reserved[3];
+  uint32_t hash;      // FNV-1a over all pixels
+  uint32_t size;      // Bytes of packet data
+};
+
+static bool fs_mounted = false;
+
+static bool mount(bool format) {
+  if (!fs_mounted) fs_mounted = LittleFS.begin(format);
+  return fs_mounted;
+}
+
+static inline uint32_t fnv1a(uint32_t hash, uint16_t px) {
+  hash = (hash ^ (px & 0xFF)) * 16777619u;
+  return (hash ^ (px >> 8)) * 16777619u;
+}
+
+/***************************************************************************************
+** Decoder
+***************************************************************************************/
+
+struct Reader {
+  File* file;
+  uint8_t buf[SPLASH_IO_SIZE];
+  uint16_t pos, len;
+};
+
+static bool read_byte(Reader* r, uint8_t* b) {
+  if (r->pos == r->len) {
+    r->len = r->file->read(r->buf, SPLASH_IO_SIZE);
+    r->pos = 0;
+    if (r->len == 0) return false;
+  }
+  *b = r->buf[r->pos++];
+  return true;
+}
+
+static bool read_pixel(Reader* r, uint16_t* px) {
+  uint8_t lo, hi;
+  if (!read_byte(r, &lo) || !read_byte(r, &hi)) return false;
+  *px = lo | (hi << 8);
+  return true;
+}
+
+bool splash_show(TFT_eSPI* tft) {
+  if (!mount(false)) return false;
+
+  File file = LittleFS.open(SPLASH_PATH, "r");
+  if (!file) return false;
+
+  SplashHeader hdr;
+  if (file.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != SPLASH_MAGIC ||
+      (uint32_t)hdr.width * hdr.height != (uint32_t)SCREEN_WIDTH * SCREEN_HEIGHT) {
+    file.close();
+    return false;
+  }
+
+  // The frame is drawn in the orientation it was captured in. MADCTL only
+  // affects later writes, so switching back afterwards leaves it intact.
+  uint8_t rotation = tft->getRotation();
+  tft->setRotation(hdr.rotation);
+
+  static Reader reader;
+  reader.file = &file;
+  reader.pos = reader.len = 0;
+
+  uint16_t lit[128];
+  uint32_t remaining = (uint32_t)hdr.width * hdr.height;
+  bool ok = true;
+
+  tft->startWrite();
+  tft->setAddrWindow(0, 0, hdr.width, hdr.height);
+  while (remaining && ok) {
+    uint8_t c;
+    if (!read_byte(&reader, &c)) { ok = false; break; }
+
+    if (c < 128) {
+      uint16_t n = c + 1;
+      for (uint16_t i = 0; i < n && ok; i++) ok = read_pixel(&reader, &lit[i]);
+      if (!ok || n > remaining) { ok = false; break; }
+      tft->pushPixels(lit, n);
+      remaining -= n;
+    } else {
+      uint16_t n = c - 126;
+      uint16_t px;
+      if (!read_pixel(&reader, &px) || n > remaining) { ok = false; break; }
+      tft->pushBlock((px >> 8) | (px << 8), n);  // pushBlock takes native order
+      remaining -= n;
+    }
+  }
+  // Blank whatever a truncated file did not cover
+  if (remaining) tft->pushBlock(TFT_BLACK, remaining);
+  tft->endWrite();
+
+  tft->setRotation(rotation);
+  file.close();
+  return ok;
+}
+
+/***************************************************************************************
+** Encoder
+***************************************************************************************/
+
+struct Writer {
+  File* file;
+  uint8_t buf[SPLASH_IO_SIZE];
+  uint16_t len;
+  uint32_t size;
+  uint16_t lit[128];
+  uint8_t  lit_n;
+  uint16_t run_px;
+  uint8_t  run_n;
+};
+
+static void write_bytes(Writer* w, const uint8_t* data, uint16_t n) {
+  while (n--) {
+    w->buf[w->len++] = *data++;
+    w->size++;
+    if (w->len == SPLASH_IO_SIZE) {
+      w->file->write(w->buf, w->len);
+      w->len = 0;
+    }
+  }
+}
+
+static void flush_literals(Writer* w) {
+  if (!w->lit_n) return;
+  uint8_t c = w->lit_n - 1;
+  write_bytes(w, &c, 1);
+  write_bytes(w, (const uint8_t*)w->lit, w->lit_n * 2);
+  w->lit_n = 0;
+}
+
+static void end_run(Writer* w) {
+  if (w->run_n == 0) return;
+  if (w->run_n >= 2) {
+    flush_literals(w);
+    uint8_t c = w->run_n + 126;
+    write_bytes(w, &c, 1);
+    write_bytes(w, (const uint8_t*)&w->run_px, 2);
+  } else {
+    w->lit[w->lit_n++] = w->run_px;
+    if (w->lit_n == 128) flush_literals(w);
+  }
+  w->run_n = 0;
+}
+
+static void encode_pixel(Writer* w, uint16_t px) {
+  if (w->run_n && px == w->run_px && w->run_n < 129) {
+    w->run_n++;
+    return;
+  }
+  end_run(w);
+  w->run_px = px;
+  w->run_n = 1;
+}
+
+bool splash_save(TFT_eSPI* tft) {
+  if (!mount(true)) return false;
+
+  int16_t width = tft->width();
+  int16_t height = tft->height();
+  uint16_t* row = (uint16_t*)malloc(width * sizeof(uint16_t));
+  if (!row) return false;
+
+  // First pass: hash only, so an unchanged frame costs no flash write
+  uint32_t hash = 2166136261u;
+  for (int16_t y = 0; y < height; y++) {
+    tft->readRect(0, y, width, 1, row);
+    for (int16_t x = 0; x < width; x++) hash = fnv1a(hash, row[x]);
+  }
+
+  File old = LittleFS.open(SPLASH_PATH, "r");
+  if (old) {
+    SplashHeader hdr;
+    bool same = old.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == SPLASH_MAGIC &&
+                hdr.hash == hash && hdr.width == width && hdr.rotation == tft->getRotation();
+    old.close();
+    if (same) {
+      free(row);
+      return true;
+    }
+  }
+
+  File file = LittleFS.open(SPLASH_TMP_PATH, "w");
+  if (!file) {
+    free(row);
+    return false;
+  }
+
+  SplashHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  file.write((const uint8_t*)&hdr, sizeof(hdr));  // Filled in once the size is known
+
+  static Writer writer;
+  writer.file = &file;
+  writer.len = 0;
+  writer.size = 0;
+  writer.lit_n = 0;
+  writer.run_n = 0;
+
+  // Second pass: encode
+  for (int16_t y = 0; y < height; y++) {
+    tft->readRect(0, y, width, 1, row);
+    for (int16_t x = 0; x < width; x++) encode_pixel(&writer, row[x]);
+  }
+  end_run(&writer);
+  flush_literals(&writer);
+  if (writer.len) file.write(writer.buf, writer.len);
+  free(row);
+
+  hdr.magic = SPLASH_MAGIC;
+  hdr.width = width;
+  hdr.height = height;
+  hdr.rotation = tft->getRotation();
+  hdr.hash = hash;
+  hdr.size = writer.size;
+  file.seek(0);
+  file.write((const uint8_t*)&hdr, sizeof(hdr));
+  file.close();
+
+  // Replace the old frame only once the new one is complete
+  if (LittleFS.rename(SPLASH_TMP_PATH, SPLASH_PATH)) return true;
+  LittleFS.remove(SPLASH_PATH);
+  return LittleFS.rename(SPLASH_TMP_PATH, SPLASH_PATH);
+}
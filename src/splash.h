@@ -0,0 +1,10 @@
+#pragma once
+
+#include <TFT_eSPI.h>
+#include "config.h"
+
+// Blit the cached frame right after tft.init(), returns false if there is none
+bool splash_show(TFT_eSPI* tft);
+
+// Read the panel back and store it RLE-compressed in flash (skipped if unchanged)
+bool splash_save(TFT_eSPI* tft);
@@ -0,0 +1,375 @@
+#include "sprite_dma.h"
+
+#define NO_TRANSP 0xFFFFFFFFu
+
+// Two output rows so a DMA transfer can run while the next row is computed
+static uint16_t line_buf[2][SPRITE_MAX_SPAN] __attribute__((aligned(4)));
+static uint16_t bg_buf[SPRITE_MAX_SPAN];
+static uint8_t  alpha_buf[SPRITE_MAX_SPAN];
+static uint8_t  line_sel = 0;
+
+// RGB332 to RGB565, built on first use
+static uint16_t rgb332_lut[256];
+static bool rgb332_ready = false;
+
+// Raw view of a sprite's memory (rotation 0 layout)
+struct SpriteSrc {
+  const uint8_t* data;
+  int32_t  w, h;
+  int32_t  stride;       // Bytes per row
+  uint16_t lut[16];      // 4bpp palette or 1bpp bg/fg, native colours
+  uint32_t transp_raw;   // Raw pixel value treated as transparent, or NO_TRANSP
+};
+
+static inline uint16_t swap16(uint16_t c) {
+  return (c >> 8) | (c << 8);
+}
+
+static bool src_init(TFT_eSPI* tft, TFT_eSprite* spr, uint32_t transp, SpriteSrc* s) {
+  if (!spr->created() || spr->getRotation() != 0) return false;
+
+  s->data = (const uint8_t*)spr->getPointer();
+  s->w = spr->width();
+  s->h = spr->height();
+  s->transp_raw = NO_TRANSP;
+  bool has_transp = transp != 0x00FFFFFF;
+
+  switch (spr->getColorDepth()) {
+    case 16:
+      s->stride = s->w * 2;
+      if (has_transp) s->transp_raw = swap16(transp);  // Sprite memory is byte-swapped
+      break;
+    case 8:
+      s->stride = s->w;
+      if (!rgb332_ready) {
+        for (int i = 0; i < 256; i++) rgb332_lut[i] = tft->color8to16(i);
+        rgb332_ready = true;
+      }
+      if (has_transp) {
+        uint8_t c8 = tft->color16to8(transp);
+        if (rgb332_lut[c8] == (uint16_t)transp) s->transp_raw = c8;
+      }
+      break;
+    case 4:
+      s->stride = ((s->w + 1) & ~1) >> 1;
+      for (int i = 0; i < 16; i++) s->lut[i] = spr->getPaletteColor(i);
+      if (has_transp) s->transp_raw = transp & 0x0F;  // Palette index, as pushRotated
+      break;
+    case 1:
+      s->stride = (s->w + 7) >> 3;
+      s->lut[0] = tft->bitmap_bg;
+      s->lut[1] = tft->bitmap_fg;
+      if (has_transp) s->transp_raw = transp == tft->bitmap_fg ? 1 : (transp == tft->bitmap_bg ? 0 : NO_TRANSP);
+      break;
+    default:
+      return false;
+  }
+  return s->data != NULL;
+}
+
+template <uint8_t BPP>
+static inline uint32_t src_raw(const SpriteSrc* s, int32_t x, int32_t y) {
+  const uint8_t* row = s->data + y * s->stride;
+  if (BPP == 16) return ((const uint16_t*)row)[x];
+  if (BPP == 8) return row[x];
+  if (BPP == 4) return (x & 1) ? (row[x >> 1] & 0x0F) : (row[x >> 1] >> 4);
+  return (row[x >> 3] >> (7 - (x & 7))) & 1;
+}
+
+template <uint8_t BPP>
+static inline uint16_t src_color(const SpriteSrc* s, uint32_t raw) {
+  if (BPP == 16) return swap16(raw);
+  if (BPP == 8) return rgb332_lut[raw];
+  return s->lut[raw];
+}
+
+/***************************************************************************************
+** Row samplers. (sx, sy) is the source position of the first pixel in Q16, with
+** integer values on pixel centres; (dx, dy) is the step per destination pixel.
+***************************************************************************************/
+
+template <uint8_t BPP, SpriteSampling MODE>
+static void sample_row(const SpriteSrc* s, int32_t sx, int32_t sy, int32_t dx, int32_t dy,
+                       int32_t n, uint16_t* color, uint8_t* alpha) {
+  for (int32_t i = 0; i < n; i++, sx += dx, sy += dy) {
+    alpha[i] = 0;
+
+    if (MODE == SPRITE_SAMPLE_NEAREST) {
+      int32_t xi = (sx + 0x8000) >> 16;
+      int32_t yi = (sy + 0x8000) >> 16;
+      if ((uint32_t)xi >= (uint32_t)s->w || (uint32_t)yi >= (uint32_t)s->h) continue;
+      uint32_t raw = src_raw<BPP>(s, xi, yi);
+      if (raw == s->transp_raw) continue;
+      color[i] = src_color<BPP>(s, raw);
+      alpha[i] = 255;
+      continue;
+    }
+
+    int32_t x0 = sx >> 16;
+    int32_t y0 = sy >> 16;
+    if (x0 < -1 || x0 >= s->w || y0 < -1 || y0 >= s->h) continue;
+
+    // 2x2 neighbourhood, weights sum to 65536. Pixels outside the sprite or
+    // matching the transparent colour add nothing, which anti-aliases the edges.
+    uint32_t fx = (sx >> 8) & 0xFF;
+    uint32_t fy = (sy >> 8) & 0xFF;
+    uint32_t wt[4] = { (256 - fx) * (256 - fy), fx * (256 - fy), (256 - fx) * fy, fx * fy };
+    uint32_t wsum = 0, best = 0;
+    uint32_t r = 0, g = 0, b = 0;
+    uint16_t c_best = 0;
+
+    for (int k = 0; k < 4; k++) {
+      int32_t xk = x0 + (k & 1);
+      int32_t yk = y0 + (k >> 1);
+      if (!wt[k] || (uint32_t)xk >= (uint32_t)s->w || (uint32_t)yk >= (uint32_t)s->h) continue;
+      uint32_t raw = src_raw<BPP>(s, xk, yk);
+      if (raw == s->transp_raw) continue;
+      uint16_t c = src_color<BPP>(s, raw);
+      wsum += wt[k];
+      if (MODE == SPRITE_SAMPLE_BILINEAR) {
+        r += (c >> 11) * wt[k];
+        g += ((c >> 5) & 0x3F) * wt[k];
+        b += (c & 0x1F) * wt[k];
+      } else if (wt[k] > best) {
+        best = wt[k];
+        c_best = c;
+      }
+    }
+    if (!wsum) continue;
+
+    if (MODE == SPRITE_SAMPLE_BILINEAR) {
+      uint32_t half = wsum >> 1;
+      color[i] = ((r + half) / wsum) << 11 | ((g + half) / wsum) << 5 | ((b + half) / wsum);
+    } else {
+      color[i] = c_best;
+    }
+    alpha[i] = wsum >= 65280 ? 255 : wsum >> 8;
+  }
+}
+
+typedef void (*sample_row_t)(const SpriteSrc*, int32_t, int32_t, int32_t, int32_t, int32_t, uint16_t*, uint8_t*);
+
+template <uint8_t BPP>
+static sample_row_t pick_sampler(SpriteSampling mode) {
+  switch (mode) {
+    case SPRITE_SAMPLE_EDGE_AA:  return sample_row<BPP, SPRITE_SAMPLE_EDGE_AA>;
+    case SPRITE_SAMPLE_BILINEAR: return sample_row<BPP, SPRITE_SAMPLE_BILINEAR>;
+    default:                     return sample_row<BPP, SPRITE_SAMPLE_NEAREST>;
+  }
+}
+
+/***************************************************************************************
+** Rotated push
+***************************************************************************************/
+
+bool sprite_push_rotated(TFT_eSPI* tft, TFT_eSprite* spr, int16_t x, int16_t y, int16_t angle,
+                         SpriteSampling sampling, uint32_t transp, uint32_t bg_color) {
+  SpriteSrc src;
+  if (!src_init(tft, spr, transp, &src)) return false;
+
+  sample_row_t sampler;
+  switch (spr->getColorDepth()) {
+    case 16: sampler = pick_sampler<16>(sampling); break;
+    case 8:  sampler = pick_sampler<8>(sampling); break;
+    case 4:  sampler = pick_sampler<4>(sampling); break;
+    default: sampler = pick_sampler<1>(sampling); break;
+  }
+
+  float rad = angle * 0.0174532925f;
+  float cosa = cosf(rad);
+  float sina = sinf(rad);
+  const int32_t C = lroundf(cosa * 65536.0f);
+  const int32_t S = lroundf(sina * 65536.0f);
+  const int32_t px = spr->getPivotX();
+  const int32_t py = spr->getPivotY();
+
+  // Destination bounds of the sprite grown by one pixel for the anti-aliased fringe
+  float xmin = 1e9f, xmax = -1e9f, ymin = 1e9f, ymax = -1e9f;
+  for (int k = 0; k < 4; k++) {
+    float a = ((k & 1) ? src.w : -1) - px;
+    float b = ((k & 2) ? src.h : -1) - py;
+    float du = cosa * a - sina * b;
+    float dv = sina * a + cosa * b;
+    xmin = fminf(xmin, du); xmax = fmaxf(xmax, du);
+    ymin = fminf(ymin, dv); ymax = fmaxf(ymax, dv);
+  }
+  int32_t x0 = x + (int32_t)floorf(xmin);
+  int32_t x1 = x + (int32_t)ceilf(xmax);
+  int32_t y0 = y + (int32_t)floorf(ymin);
+  int32_t y1 = y + (int32_t)ceilf(ymax);
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 >= tft->width()) x1 = tft->width() - 1;
+  if (y1 >= tft->height()) y1 = tft->height() - 1;
+  if (x1 - x0 >= SPRITE_MAX_SPAN) x1 = x0 + SPRITE_MAX_SPAN - 1;
+  if (x0 > x1 || y0 > y1) return true;
+
+  const int32_t n_max = x1 - x0 + 1;
+  const bool read_bg = (bg_color == 0x00FFFFFF);
+  const uint16_t bg = bg_color;
+
+  // Rows are prepared in panel byte order
+  bool swap = tft->getSwapBytes();
+  tft->setSwapBytes(false);
+  tft->startWrite();
+
+  for (int32_t yp = y0; yp <= y1; yp++) {
+    int32_t du = x0 - x;
+    int32_t dv = yp - y;
+    int32_t sx = C * du + S * dv + (px << 16);
+    int32_t sy = -S * du + C * dv + (py << 16);
+
+    uint16_t* out = line_buf[line_sel];
+    sampler(&src, sx, sy, C, -S, n_max, out, alpha_buf);
+
+    // Each covered run goes out on its own, transparent pixels between runs
+    // are left alone on the panel
+    bool pushed = false;
+    for (int32_t l = 0; l < n_max;) {
+      if (!alpha_buf[l]) { l++; continue; }
+      int32_t r = l;
+      bool partial = false;
+      while (r + 1 < n_max && alpha_buf[r + 1]) r++;
+      for (int32_t i = l; i <= r && !partial; i++) partial = alpha_buf[i] != 255;
+      int32_t n = r - l + 1;
+
+      // One read turnaround per run
+      if (read_bg && partial) {
+        if (tft->DMA_Enabled) tft->dmaWait();
+        tft->readRect(x0 + l, yp, n, 1, bg_buf);
+      }
+
+      for (int32_t i = l; i <= r; i++) {
+        uint8_t a = alpha_buf[i];
+        if (a == 255) {
+          out[i] = swap16(out[i]);
+        } else {
+          uint16_t b = read_bg ? swap16(bg_buf[i - l]) : bg;
+          out[i] = swap16(fastBlend(a, out[i], b));
+        }
+      }
+
+      // DMA from a 4-byte aligned start, or the driver copies the buffer.
+      // out[l - 1] is transparent, and outside any run still in flight.
+      uint16_t* run = out + l;
+      if (l & 1) {
+        memmove(run - 1, run, n * sizeof(uint16_t));
+        run--;
+      }
+
+      if (tft->DMA_Enabled) {
+        tft->dmaWait();  // The address window cannot change under a running transfer
+        tft->setAddrWindow(x0 + l, yp, n, 1);
+        tft->pushPixelsDMA(run, n);
+        pushed = true;
+      } else {
+        tft->setAddrWindow(x0 + l, yp, n, 1);
+        tft->pushPixels(run, n);
+      }
+      l = r + 1;
+    }
+    if (pushed) line_sel ^= 1;
+  }
+
+  if (tft->DMA_Enabled) tft->dmaWait();
+  tft->endWrite();
+  tft->setSwapBytes(swap);
+  return true;
+}
+
+/***************************************************************************************
+** Palette expansion push
+***************************************************************************************/
+
+// Lookup tables in panel byte order for the current push
+static uint16_t lut_sw[256];
+static uint32_t pair_lut[256];  // 4bpp: one byte to two pixels, first pixel in the low half
+
+static void expand_row(const SpriteSrc* s, uint8_t bpp, int32_t y, int32_t x, int32_t n, uint16_t* out) {
+  const uint8_t* row = s->data + y * s->stride;
+  switch (bpp) {
+    case 8:
+      row += x;
+      for (int32_t i = 0; i < n; i++) out[i] = lut_sw[row[i]];
+      break;
+    case 4: {
+      int32_t i = 0;
+      if (x & 1) out[i++] = lut_sw[row[x >> 1] & 0x0F];
+      const uint8_t* p = row + ((x + i) >> 1);
+      for (; i + 1 < n; i += 2) {
+        uint32_t pair = pair_lut[*p++];
+        out[i] = pair;
+        out[i + 1] = pair >> 16;
+      }
+      if (i < n) out[i] = lut_sw[*p >> 4];
+      break;
+    }
+    default:
+      for (int32_t i = 0; i < n; i++) out[i] = lut_sw[(row[(x + i) >> 3] >> (7 - ((x + i) & 7))) & 1];
+      break;
+  }
+}
+
+bool sprite_push(TFT_eSPI* tft, TFT_eSprite* spr, int32_t x, int32_t y) {
+  SpriteSrc src;
+  if (!src_init(tft, spr, 0x00FFFFFF, &src)) return false;
+  uint8_t bpp = spr->getColorDepth();
+
+  // Clip to the panel
+  int32_t cx = x < 0 ? -x : 0;
+  int32_t cy = y < 0 ? -y : 0;
+  int32_t w = src.w - cx;
+  int32_t h = src.h - cy;
+  if (x + cx + w > tft->width()) w = tft->width() - x - cx;
+  if (y + cy + h > tft->height()) h = tft->height() - y - cy;
+  if (w > SPRITE_MAX_SPAN) w = SPRITE_MAX_SPAN;
+  if (w <= 0 || h <= 0) return true;
+
+  switch (bpp) {
+    case 8:
+      for (int i = 0; i < 256; i++) lut_sw[i] = swap16(rgb332_lut[i]);
+      break;
+    case 4:
+      for (int i = 0; i < 16; i++) lut_sw[i] = swap16(src.lut[i]);
+      for (int i = 0; i < 256; i++) pair_lut[i] = lut_sw[i >> 4] | ((uint32_t)lut_sw[i & 0x0F] << 16);
+      break;
+    case 1:
+      lut_sw[0] = swap16(src.lut[0]);
+      lut_sw[1] = swap16(src.lut[1]);
+      break;
+  }
+
+  // Whole rows per chunk, as many as fit in a line buffer. 16bpp rows go out
+  // straight from sprite memory, one at a time if clipping breaks them up.
+  int32_t rows = SPRITE_MAX_SPAN / w;
+  if (bpp == 16 && w != src.w) rows = 1;
+
+  bool swap = tft->getSwapBytes();
+  tft->setSwapBytes(false);
+  tft->startWrite();
+  tft->setAddrWindow(x + cx, y + cy, w, h);
+
+  for (int32_t row = 0; row < h; row += rows) {
+    int32_t n_rows = rows < h - row ? rows : h - row;
+    uint16_t* out;
+
+    if (bpp == 16) {
+      out = (uint16_t*)(src.data + (cy + row) * src.stride) + cx;  // Already in panel order
+    } else {
+      out = line_buf[line_sel];
+      for (int32_t r = 0; r < n_rows; r++) expand_row(&src, bpp, cy + row + r, cx, w, out + r * w);
+    }
+
+    if (tft->DMA_Enabled) {
+      tft->pushPixelsDMA(out, n_rows * w);  // Waits for the previous chunk
+      line_sel ^= 1;
+    } else {
+      tft->pushPixels(out, n_rows * w);
+    }
+  }
+
+  if (tft->DMA_Enabled) tft->dmaWait();
+  tft->endWrite();
+  tft->setSwapBytes(swap);
+  return true;
+}
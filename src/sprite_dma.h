@@ -0,0 +1,26 @@
+#pragma once
+
+#include <TFT_eSPI.h>
+#include "config.h"
+
+enum SpriteSampling {
+  SPRITE_SAMPLE_NEAREST,   // Same output as TFT_eSprite::pushRotated
+  SPRITE_SAMPLE_EDGE_AA,   // Nearest colour, coverage from the 2x2 neighbourhood
+  SPRITE_SAMPLE_BILINEAR   // Colour and coverage both interpolated
+};
+
+// Rotated push of a 16, 8, 4 or 1 bpp sprite (sprite rotation 0) to the panel.
+// The sprite pivot lands on (x, y), angle is in degrees clockwise. Pixels
+// matching transp (a colour, or a palette index for 4bpp) and the area outside
+// the sprite are transparent. Partly covered pixels are blended with bg_color,
+// or with the panel contents (one readRect per run) for 0x00FFFFFF.
+// Each covered run of a row is sent by DMA while the next one is computed;
+// transparent pixels are never written.
+bool sprite_push_rotated(TFT_eSPI* tft, TFT_eSprite* spr, int16_t x, int16_t y, int16_t angle,
+                         SpriteSampling sampling = SPRITE_SAMPLE_EDGE_AA,
+                         uint32_t transp = 0x00FFFFFF, uint32_t bg_color = 0x00FFFFFF);
+
+// Unrotated push of a 16, 8, 4 or 1 bpp sprite (sprite rotation 0), clipped to
+// the panel. Palette and RGB332 pixels are expanded into two line buffers that
+// alternate, so expansion of one chunk overlaps the DMA transfer of the other.
+bool sprite_push(TFT_eSPI* tft, TFT_eSprite* spr, int32_t x, int32_t y);
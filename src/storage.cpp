@@ -0,0 +1,338 @@
+#include <atomic>
+#include <SD.h>
+#include <SPI.h>
+#include <esp_heap_caps.h>
+#include "storage.h"
+#include "console.h"
+#include "telemetry.h"
+
+struct StorageStream {
+  bool used;
+  File file;
+  uint32_t size;
+  bool file_end;                  // Storage task read the last block
+  uint8_t* buf[2];                // STORAGE_BLOCK each
+  uint32_t len[2];                // Valid bytes, 0 marks the end of the file
+  std::atomic<bool> ready[2];     // Set by the storage task, cleared by the reader
+  uint8_t fill;                   // Next buffer the storage task fills
+  uint8_t cur;                    // Buffer the reader consumes
+  uint32_t pos;                   // Read offset in buf[cur]
+  SemaphoreHandle_t filled;       // Given after each fill
+};
+
+struct StorageLog {
+  bool used;
+  File file;
+  uint8_t* buf[2];                // STORAGE_LOG_BUF each
+  uint32_t len[2];
+  bool pending[2];                // Handed to the storage task
+  uint8_t cur;                    // Buffer being appended to
+  uint32_t first_ms;              // When buf[cur] got its first byte
+};
+
+static SPIClass sd_spi(HSPI);
+static bool mounted = false;
+
+// sd_lock guards the files and the stream/log tables; log_lock only the log
+// buffers, so log writers never wait for the card
+static SemaphoreHandle_t sd_lock = NULL;
+static SemaphoreHandle_t log_lock = NULL;
+static TaskHandle_t io_task = NULL;
+
+static StorageStream streams[STORAGE_MAX_STREAMS];
+static StorageLog logs[STORAGE_MAX_LOGS];
+static StorageStats stats;
+
+static void note_io(bool write, uint32_t bytes, uint32_t us) {
+  if (write) {
+    stats.write_ops++;
+    stats.write_bytes += bytes;
+    stats.write_us += us;
+    if (us > stats.write_max_us) stats.write_max_us = us;
+  } else {
+    stats.read_ops++;
+    stats.read_bytes += bytes;
+    stats.read_us += us;
+    if (us > stats.read_max_us) stats.read_max_us = us;
+  }
+}
+
+/***************************************************************************************
+** Storage task
+***************************************************************************************/
+
+// Refill every free read-ahead buffer, in order. Blocks are whole multiples
+// of the sector size from offset 0, so FatFs reads them straight into the
+// buffer with multi-block transfers.
+static void fill_streams() {
+  for (int i = 0; i < STORAGE_MAX_STREAMS; i++) {
+    StorageStream* s = &streams[i];
+    xSemaphoreTake(sd_lock, portMAX_DELAY);
+    while (s->used && !s->file_end && !s->ready[s->fill]) {
+      uint8_t f = s->fill;
+      uint32_t t = micros();
+      int n = s->file.read(s->buf[f], STORAGE_BLOCK);
+      note_io(false, n > 0 ? n : 0, micros() - t);
+      if (n <= 0) {
+        n = 0;
+        s->file_end = true;
+      }
+      s->len[f] = n;
+      s->ready[f] = true;
+      s->fill = f ^ 1;
+      xSemaphoreGive(s->filled);
+    }
+    xSemaphoreGive(sd_lock);
+  }
+}
+
+// Write pending log buffers, oldest first. A partial buffer is handed over
+// once it is STORAGE_LOG_FLUSH_MS old, or always with force. Caller holds sd_lock.
+static void flush_log(StorageLog* log, bool force) {
+  xSemaphoreTake(log_lock, portMAX_DELAY);
+  uint8_t c = log->cur;
+  bool aged = !log->pending[c] && log->len[c] &&
+              (force || millis() - log->first_ms >= STORAGE_LOG_FLUSH_MS);
+  if (aged) {
+    log->pending[c] = true;
+    log->cur = c ^ 1;
+  }
+  // With both pending, cur was handed over first
+  uint8_t order[2] = { log->cur, (uint8_t)(log->cur ^ 1) };
+  xSemaphoreGive(log_lock);
+
+  for (int k = 0; k < 2; k++) {
+    uint8_t b = order[k];
+    if (!log->pending[b]) continue;
+    uint32_t t = micros();
+    log->file.write(log->buf[b], log->len[b]);
+    if (log->len[b] < STORAGE_LOG_BUF) log->file.flush();  // Partial: make it durable now
+    note_io(true, log->len[b], micros() - t);
+
+    xSemaphoreTake(log_lock, portMAX_DELAY);
+    log->len[b] = 0;
+    log->pending[b] = false;
+    xSemaphoreGive(log_lock);
+  }
+}
+
+static void storage_loop(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_LOG_FLUSH_MS / 4));
+    fill_streams();
+    for (int i = 0; i < STORAGE_MAX_LOGS; i++) {
+      xSemaphoreTake(sd_lock, portMAX_DELAY);
+      if (logs[i].used) flush_log(&logs[i], false);
+      xSemaphoreGive(sd_lock);
+    }
+  }
+}
+
+/***************************************************************************************
+** Streams
+***************************************************************************************/
+
+StorageStream* storage_stream_open(const char* path) {
+  if (!mounted) return NULL;
+  StorageStream* s = NULL;
+  xSemaphoreTake(sd_lock, portMAX_DELAY);
+  for (int i = 0; i < STORAGE_MAX_STREAMS && !s; i++) {
+    if (!streams[i].used) s = &streams[i];
+  }
+  if (s) {
+    s->buf[0] = (uint8_t*)heap_caps_malloc(STORAGE_BLOCK, MALLOC_CAP_DMA);
+    s->buf[1] = (uint8_t*)heap_caps_malloc(STORAGE_BLOCK, MALLOC_CAP_DMA);
+    s->file = SD.open(path, FILE_READ);
+    if (!s->file || !s->buf[0] || !s->buf[1]) {
+      if (s->file) s->file.close();
+      free(s->buf[0]);
+      free(s->buf[1]);
+      s = NULL;
+    } else {
+      s->size = s->file.size();
+      s->file_end = false;
+      s->ready[0] = s->ready[1] = false;
+      s->fill = s->cur = 0;
+      s->pos = 0;
+      xSemaphoreTake(s->filled, 0);
+      s->used = true;
+    }
+  }
+  xSemaphoreGive(sd_lock);
+  if (s) xTaskNotifyGive(io_task);  // Start the read-ahead right away
+  return s;
+}
+
+size_t storage_stream_read(StorageStream* s, uint8_t* buf, size_t len) {
+  size_t done = 0;
+  bool stalled = false;
+  while (done < len) {
+    uint8_t c = s->cur;
+    if (!s->ready[c]) {
+      if (!stalled) stats.stalls++;
+      stalled = true;
+      xTaskNotifyGive(io_task);
+      xSemaphoreTake(s->filled, pdMS_TO_TICKS(100));
+      continue;
+    }
+    if (s->len[c] == 0) break;  // End of file
+
+    size_t n = min(len - done, (size_t)(s->len[c] - s->pos));
+    memcpy(buf + done, s->buf[c] + s->pos, n);
+    done += n;
+    s->pos += n;
+    if (s->pos == s->len[c]) {
+      s->pos = 0;
+      s->cur = c ^ 1;
+      s->ready[c] = false;
+      xTaskNotifyGive(io_task);
+    }
+  }
+  return done;
+}
+
+uint32_t storage_stream_size(StorageStream* s) {
+  return s->size;
+}
+
+void storage_stream_close(StorageStream* s) {
+  if (!s) return;
+  xSemaphoreTake(sd_lock, portMAX_DELAY);
+  s->used = false;
+  s->file.close();
+  free(s->buf[0]);
+  free(s->buf[1]);
+  s->buf[0] = s->buf[1] = NULL;
+  xSemaphoreGive(sd_lock);
+}
+
+/***************************************************************************************
+** Logs
+***************************************************************************************/
+
+StorageLog* storage_log_open(const char* path) {
+  if (!mounted) return NULL;
+  StorageLog* log = NULL;
+  xSemaphoreTake(sd_lock, portMAX_DELAY);
+  for (int i = 0; i < STORAGE_MAX_LOGS && !log; i++) {
+    if (!logs[i].used) log = &logs[i];
+  }
+  if (log) {
+    log->buf[0] = (uint8_t*)heap_caps_malloc(STORAGE_LOG_BUF, MALLOC_CAP_DMA);
+    log->buf[1] = (uint8_t*)heap_caps_malloc(STORAGE_LOG_BUF, MALLOC_CAP_DMA);
+    log->file = SD.open(path, FILE_APPEND);
+    if (!log->file || !log->buf[0] || !log->buf[1]) {
+      if (log->file) log->file.close();
+      free(log->buf[0]);
+      free(log->buf[1]);
+      log = NULL;
+    } else {
+      log->len[0] = log->len[1] = 0;
+      log->pending[0] = log->pending[1] = false;
+      log->cur = 0;
+      log->used = true;
+    }
+  }
+  xSemaphoreGive(sd_lock);
+  return log;
+}
+
+void storage_log_write(StorageLog* log, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  bool handed = false;
+  xSemaphoreTake(log_lock, portMAX_DELAY);
+  while (len) {
+    uint8_t c = log->cur;
+    if (log->pending[c]) {
+      stats.log_dropped += len;  // Card is behind; never block the caller
+      break;
+    }
+    if (log->len[c] == 0) log->first_ms = millis();
+    size_t n = min(len, (size_t)(STORAGE_LOG_BUF - log->len[c]));
+    memcpy(log->buf[c] + log->len[c], p, n);
+    log->len[c] += n;
+    p += n;
+    len -= n;
+    if (log->len[c] == STORAGE_LOG_BUF) {
+      log->pending[c] = true;
+      log->cur = c ^ 1;
+      handed = true;
+    }
+  }
+  xSemaphoreGive(log_lock);
+  if (handed) xTaskNotifyGive(io_task);
+}
+
+void storage_log_close(StorageLog* log) {
+  if (!log) return;
+  xSemaphoreTake(sd_lock, portMAX_DELAY);
+  flush_log(log, true);
+  log->used = false;
+  log->file.close();
+  free(log->buf[0]);
+  free(log->buf[1]);
+  log->buf[0] = log->buf[1] = NULL;
+  xSemaphoreGive(sd_lock);
+}
+
+/***************************************************************************************
+** Mount, statistics and console
+***************************************************************************************/
+
+void storage_get_stats(StorageStats* out, bool reset) {
+  *out = stats;
+  if (reset) memset(&stats, 0, sizeof(stats));
+}
+
+bool storage_mounted() {
+  return mounted;
+}
+
+bool storage_idle() {
+  if (!mounted) return true;
+  if (!xSemaphoreTake(sd_lock, 0)) return false;  // The storage task is at the card
+  bool idle = true;
+  for (int i = 0; i < STORAGE_MAX_STREAMS; i++) {
+    if (streams[i].used) idle = false;
+  }
+  xSemaphoreTake(log_lock, portMAX_DELAY);
+  for (int i = 0; i < STORAGE_MAX_LOGS; i++) {
+    if (logs[i].used && (logs[i].len[0] || logs[i].len[1])) idle = false;
+  }
+  xSemaphoreGive(log_lock);
+  xSemaphoreGive(sd_lock);
+  return idle;
+}
+
+static uint32_t kbps(uint32_t bytes, uint32_t us) {
+  return us ? (uint64_t)bytes * 1000000 / 1024 / us : 0;
+}
+
+static void cmd_sd(int argc, char** argv) {
+  StorageStats s;
+  storage_get_stats(&s, argc > 1 && strcmp(argv[1], "reset") == 0);
+  Serial.printf("SD,mounted=%d,size_mb=%u,reads=%u,read_kbps=%u,read_max_us=%u,"
+                "writes=%u,write_kbps=%u,write_max_us=%u,stalls=%u,log_dropped=%u\n",
+                mounted, mounted ? (uint32_t)(SD.cardSize() >> 20) : 0,
+                s.read_ops, kbps(s.read_bytes, s.read_us), s.read_max_us,
+                s.write_ops, kbps(s.write_bytes, s.write_us), s.write_max_us, s.stalls, s.log_dropped);
+}
+
+bool storage_init() {
+  sd_lock = xSemaphoreCreateMutex();
+  log_lock = xSemaphoreCreateMutex();
+  console_register("sd", "[reset] SD throughput, latency and read-ahead statistics", cmd_sd);
+
+  sd_spi.begin(SD_SPI_SCK, SD_SPI_MISO, SD_SPI_MOSI, SD_CS);
+  mounted = SD.begin(SD_CS, sd_spi, SD_SPI_FREQUENCY, "/sd", STORAGE_MAX_FILES);
+  if (!mounted) return false;
+
+  for (int i = 0; i < STORAGE_MAX_STREAMS; i++) {
+    streams[i].filled = xSemaphoreCreateBinary();
+  }
+  // Below the audio tasks: a slow card must not delay the I2S output
+  xTaskCreatePinnedToCore(storage_loop, "sd_io", STORAGE_TASK_STACK, NULL, STORAGE_TASK_PRIORITY,
+                          &io_task, AUDIO_CORE);
+  telemetry_register_task("sd_io", io_task);
+  return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+struct StorageStream;
+struct StorageLog;
+
+// Counters for all SD traffic (reads and writes happen on the storage task)
+struct StorageStats {
+  uint32_t read_ops;        // File reads issued (STORAGE_BLOCK each, sector aligned)
+  uint32_t read_bytes;
+  uint32_t read_us;         // Time spent in reads
+  uint32_t read_max_us;     // Slowest read
+  uint32_t write_ops;       // Coalesced log writes
+  uint32_t write_bytes;
+  uint32_t write_us;
+  uint32_t write_max_us;
+  uint32_t stalls;          // Stream reads that waited for the read-ahead
+  uint32_t log_dropped;     // Log bytes dropped with both log buffers waiting
+};
+
+// Mount the card on its own SPI bus (HSPI), start the storage task on
+// AUDIO_CORE and register the 'sd' console command. False without a card.
+bool storage_init();
+bool storage_mounted();
+
+// Sequential read stream. Two STORAGE_BLOCK buffers are kept full ahead of
+// the reader by the storage task, so reads only wait when the card falls
+// behind. Reads may come from any one task.
+StorageStream* storage_stream_open(const char* path);
+size_t storage_stream_read(StorageStream* s, uint8_t* buf, size_t len);  // 0 at end of file
+uint32_t storage_stream_size(StorageStream* s);
+void storage_stream_close(StorageStream* s);
+
+// Append-only log. Writes are copied into a RAM buffer and never block; the
+// storage task writes full buffers, or partial ones after STORAGE_LOG_FLUSH_MS.
+StorageLog* storage_log_open(const char* path);
+void storage_log_write(StorageLog* log, const void* data, size_t len);
+void storage_log_close(StorageLog* log);  // Writes what is buffered
+
+void storage_get_stats(StorageStats* stats, bool reset);
+
+// No stream open, no log bytes waiting for the card and no card I/O running:
+// nothing a light sleep would stall
+bool storage_idle();
@@ -0,0 +1,181 @@
+#include <esp_heap_caps.h>
+#include <lvgl.h>
+#include "telemetry.h"
+#include "display.h"
+
+// High-water marks collected while a scenario is active
+struct ScenarioMarks {
+  const char* name;
+  uint32_t samples;
+  uint8_t  lv_used_pct_max;
+  uint8_t  lv_frag_pct_max;
+  uint32_t lv_biggest_min;
+  uint32_t internal_free_min;
+  uint32_t internal_largest_min;
+  uint32_t dma_free_min;
+  uint32_t dma_largest_min;
+  uint32_t stack_min[TELEMETRY_MAX_TASKS];
+  uint32_t flush_bytes;        // Panel bytes LVGL flushed while active
+  uint32_t flush_saved;        // ... of which the tile filter skipped
+};
+
+struct TrackedTask {
+  const char* name;
+  TaskHandle_t handle;         // NULL once the task has ended; its marks stay
+};
+
+static ScenarioMarks scenarios[TELEMETRY_MAX_SCENARIOS];
+static uint8_t scenario_count = 0;
+static ScenarioMarks* current = NULL;
+
+static TrackedTask tasks[TELEMETRY_MAX_TASKS];
+static uint8_t task_count = 0;
+static SemaphoreHandle_t task_lock = NULL;  // Tasks may end while the loop samples them
+
+static lv_timer_t* sample_timer = NULL;
+static FlushStats last_flush;
+
+static void reset_marks(ScenarioMarks* marks, const char* name) {
+  marks->name = name;
+  marks->samples = 0;
+  marks->lv_used_pct_max = 0;
+  marks->lv_frag_pct_max = 0;
+  marks->lv_biggest_min = UINT32_MAX;
+  marks->internal_free_min = UINT32_MAX;
+  marks->internal_largest_min = UINT32_MAX;
+  marks->dma_free_min = UINT32_MAX;
+  marks->dma_largest_min = UINT32_MAX;
+  for (uint8_t i = 0; i < TELEMETRY_MAX_TASKS; i++) {
+    marks->stack_min[i] = UINT32_MAX;
+  }
+  marks->flush_bytes = 0;
+  marks->flush_saved = 0;
+}
+
+void telemetry_init() {
+  if (!task_lock) task_lock = xSemaphoreCreateMutex();
+  scenario_count = 0;
+  current = NULL;
+  telemetry_begin_scenario("boot");
+
+  // Periodic sampling from the LVGL timer list, so samples see the UI at rest
+  sample_timer = lv_timer_create([](lv_timer_t* timer) {
+    telemetry_sample();
+  }, TELEMETRY_SAMPLE_MS, NULL);
+}
+
+bool telemetry_register_task(const char* name, TaskHandle_t task) {
+  xSemaphoreTake(task_lock, portMAX_DELAY);
+  uint8_t i = 0;
+  while (i < task_count && strcmp(tasks[i].name, name) != 0) i++;
+  bool ok = i < TELEMETRY_MAX_TASKS;
+  if (ok) {
+    tasks[i].name = name;
+    tasks[i].handle = task ? task : xTaskGetCurrentTaskHandle();
+    if (i == task_count) task_count++;
+  }
+  xSemaphoreGive(task_lock);
+  if (!ok) Serial.printf("MEM,task_table_full,%s,max=%u\n", name, TELEMETRY_MAX_TASKS);
+  return ok;
+}
+
+void telemetry_unregister_task(TaskHandle_t task) {
+  if (!task) task = xTaskGetCurrentTaskHandle();
+  xSemaphoreTake(task_lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < task_count; i++) {
+    if (tasks[i].handle != task) continue;
+    // Last look at its stack, then keep only the marks
+    uint32_t hwm = uxTaskGetStackHighWaterMark(task);
+    if (current && hwm < current->stack_min[i]) current->stack_min[i] = hwm;
+    tasks[i].handle = NULL;
+  }
+  xSemaphoreGive(task_lock);
+}
+
+void telemetry_read(MemorySnapshot* snap) {
+  lv_mem_monitor_t mon;
+  lv_mem_monitor(&mon);
+  snap->lv_free = mon.free_size;
+  snap->lv_biggest = mon.free_biggest_size;
+  snap->lv_used_pct = mon.used_pct;
+  snap->lv_frag_pct = mon.frag_pct;
+
+  snap->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  snap->internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  snap->dma_free = heap_caps_get_free_size(MALLOC_CAP_DMA);
+  snap->dma_largest = heap_caps_get_largest_free_block(MALLOC_CAP_DMA);
+}
+
+void telemetry_sample() {
+  if (!current) return;
+
+  MemorySnapshot snap;
+  telemetry_read(&snap);
+
+  current->samples++;
+  if (snap.lv_used_pct > current->lv_used_pct_max) current->lv_used_pct_max = snap.lv_used_pct;
+  if (snap.lv_frag_pct > current->lv_frag_pct_max) current->lv_frag_pct_max = snap.lv_frag_pct;
+  if (snap.lv_biggest < current->lv_biggest_min) current->lv_biggest_min = snap.lv_biggest;
+  if (snap.internal_free < current->internal_free_min) current->internal_free_min = snap.internal_free;
+  if (snap.internal_largest < current->internal_largest_min) current->internal_largest_min = snap.internal_largest;
+  if (snap.dma_free < current->dma_free_min) current->dma_free_min = snap.dma_free;
+  if (snap.dma_largest < current->dma_largest_min) current->dma_largest_min = snap.dma_largest;
+
+  // Flush traffic since the last sample belongs to this scenario
+  FlushStats flush;
+  display_get_flush_stats(&flush);
+  current->flush_bytes += flush.bytes_total - last_flush.bytes_total;
+  current->flush_saved += flush.bytes_saved - last_flush.bytes_saved;
+  last_flush = flush;
+
+  // ESP-IDF reports the stack high-water mark in bytes
+  xSemaphoreTake(task_lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < task_count; i++) {
+    if (!tasks[i].handle) continue;
+    uint32_t hwm = uxTaskGetStackHighWaterMark(tasks[i].handle);
+    if (hwm < current->stack_min[i]) current->stack_min[i] = hwm;
+  }
+  xSemaphoreGive(task_lock);
+}
+
+void telemetry_begin_scenario(const char* name) {
+  // Close the previous scenario with a final sample
+  telemetry_sample();
+
+  for (uint8_t i = 0; i < scenario_count; i++) {
+    if (strcmp(scenarios[i].name, name) == 0) {
+      current = &scenarios[i];  // Re-entering keeps the existing marks
+      telemetry_sample();
+      return;
+    }
+  }
+
+  if (scenario_count >= TELEMETRY_MAX_SCENARIOS) {
+    current = NULL;
+    return;
+  }
+
+  current = &scenarios[scenario_count++];
+  reset_marks(current, name);
+  telemetry_sample();
+}
+
+void telemetry_print() {
+  telemetry_sample();
+
+  for (uint8_t i = 0; i < scenario_count; i++) {
+    ScenarioMarks* s = &scenarios[i];
+    Serial.printf("MEM,%s,samples=%u,lv_used_max=%u%%,lv_frag_max=%u%%,lv_biggest_min=%u,"
+                  "int_free_min=%u,int_largest_min=%u,dma_free_min=%u,dma_largest_min=%u",
+                  s->name, s->samples, s->lv_used_pct_max, s->lv_frag_pct_max, s->lv_biggest_min,
+                  s->internal_free_min, s->internal_largest_min, s->dma_free_min, s->dma_largest_min);
+    for (uint8_t t = 0; t < task_count; t++) {
+      Serial.printf(",stack_%s=%u", tasks[t].name, s->stack_min[t]);
+    }
+    Serial.printf(",flush_bytes=%u,flush_saved=%u", s->flush_bytes, s->flush_saved);
+    Serial.println();
+  }
+
+  Serial.printf("MEM,total,lv_pool=%u,int_min_ever=%u\n",
+                (unsigned)LV_MEM_SIZE, heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// One sample of the memory budget
+struct MemorySnapshot {
+  uint32_t lv_free;            // LVGL pool free bytes
+  uint32_t lv_biggest;         // LVGL pool largest free block
+  uint8_t  lv_used_pct;        // LVGL pool usage
+  uint8_t  lv_frag_pct;        // LVGL pool fragmentation
+  uint32_t internal_free;      // Internal heap free bytes
+  uint32_t internal_largest;   // Internal heap largest free block
+  uint32_t dma_free;           // DMA capable heap free bytes
+  uint32_t dma_largest;        // DMA capable heap largest free block
+};
+
+// Memory telemetry initialization (call after lvgl_init_system)
+void telemetry_init();
+
+// Track the stack high-water mark of a task (NULL = calling task). A name
+// seen before takes over its slot, so a task started again keeps one column.
+// Prints a MEM,task_table_full line and returns false past TELEMETRY_MAX_TASKS.
+bool telemetry_register_task(const char* name, TaskHandle_t task);
+
+// Stop tracking a task that is about to delete itself (NULL = calling task);
+// its marks so far stay in the MEM lines
+void telemetry_unregister_task(TaskHandle_t task);
+
+// Take a sample and fold it into the current scenario's high-water marks
+void telemetry_sample();
+void telemetry_read(MemorySnapshot* snap);
+
+// Group samples under a UI scenario name (e.g. "boot", "idle", "panel")
+void telemetry_begin_scenario(const char* name);
+
+// Print one machine-readable MEM line per scenario seen so far
+void telemetry_print();
@@ -0,0 +1,72 @@
+#include "theme.h"
+
+static lv_theme_t theme;
+static bool styles_ready = false;
+
+static lv_style_t style_screen;
+static lv_style_t style_label;
+static lv_style_t style_slider_main;
+static lv_style_t style_slider_indicator;
+static lv_style_t style_slider_knob;
+static lv_style_t style_panel;
+static lv_style_t style_value;
+
+static void init_styles() {
+  lv_style_init(&style_screen);
+  lv_style_set_bg_color(&style_screen, SPOTIFY_BLACK);
+
+  lv_style_init(&style_label);
+  lv_style_set_text_color(&style_label, SPOTIFY_WHITE);
+  lv_style_set_text_font(&style_label, &lv_font_montserrat_12);
+
+  lv_style_init(&style_slider_main);
+  lv_style_set_bg_color(&style_slider_main, SPOTIFY_LIGHT_GREY);
+
+  lv_style_init(&style_slider_indicator);
+  lv_style_set_bg_color(&style_slider_indicator, SPOTIFY_GREEN);
+
+  lv_style_init(&style_slider_knob);
+  lv_style_set_bg_color(&style_slider_knob, SPOTIFY_WHITE);
+
+  lv_style_init(&style_panel);
+  lv_style_set_bg_color(&style_panel, SPOTIFY_DARK_GREY);
+  lv_style_set_radius(&style_panel, 0);
+  lv_style_set_border_width(&style_panel, 0);
+  lv_style_set_pad_all(&style_panel, 2);
+
+  lv_style_init(&style_value);
+  lv_style_set_pad_all(&style_value, 0);
+  lv_style_set_text_align(&style_value, LV_TEXT_ALIGN_RIGHT);
+
+  styles_ready = true;
+}
+
+static void theme_apply(lv_theme_t* th, lv_obj_t* obj) {
+  if (lv_obj_get_parent(obj) == NULL) {
+    lv_obj_add_style(obj, &style_screen, 0);
+  } else if (lv_obj_check_type(obj, &lv_label_class)) {
+    lv_obj_add_style(obj, &style_label, 0);
+  } else if (lv_obj_check_type(obj, &lv_slider_class)) {
+    lv_obj_add_style(obj, &style_slider_main, LV_PART_MAIN);
+    lv_obj_add_style(obj, &style_slider_indicator, LV_PART_INDICATOR);
+    lv_obj_add_style(obj, &style_slider_knob, LV_PART_KNOB);
+  }
+}
+
+void theme_init(lv_disp_t* disp) {
+  if (!styles_ready) init_styles();
+
+  // Start from the active (default) theme so widget geometry stays the same
+  theme = *lv_disp_get_theme(disp);
+  lv_theme_set_parent(&theme, lv_disp_get_theme(disp));
+  lv_theme_set_apply_cb(&theme, theme_apply);
+  lv_disp_set_theme(disp, &theme);
+}
+
+void theme_add_panel_style(lv_obj_t* obj) {
+  lv_obj_add_style(obj, &style_panel, 0);
+}
+
+void theme_add_value_style(lv_obj_t* label) {
+  lv_obj_add_style(label, &style_value, 0);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <lvgl.h>
+
+// Spotify palette
+#define SPOTIFY_BLACK lv_color_hex(0x121212)
+#define SPOTIFY_GREEN lv_color_hex(0x1DB954)
+#define SPOTIFY_WHITE lv_color_hex(0xFFFFFF)
+#define SPOTIFY_LIGHT_GREY lv_color_hex(0xB3B3B3)
+#define SPOTIFY_DARK_GREY lv_color_hex(0x282828)
+
+// Install the theme on a display (on top of the default theme). Screens,
+// labels and sliders created afterwards share statically allocated styles
+// instead of allocating local styles in the LVGL pool.
+void theme_init(lv_disp_t* disp);
+
+// Shared styles for objects the theme cannot recognise by class
+void theme_add_panel_style(lv_obj_t* obj);        // Pull-down panel: dark grey, square, 2 px padding
+void theme_add_value_style(lv_obj_t* label);      // Right-aligned readout without padding
@@ -1,5 +1,6 @@
 #include "touch.h"
 #include "display.h"
+#include "splash.h"
 
 // Touch controller object
 static XPT2046_Touchscreen ts(TOUCH_CS, TOUCH_IRQ);
@@ -7,6 +8,24 @@ static XPT2046_Touchscreen ts(TOUCH_CS, TOUCH_IRQ);
 // Calibration data
 static CalibrationData calData;
 
+// Panel rotation the touch points are mapped to
+static uint8_t touch_rotation = DISPLAY_ROTATION;
+
+void touch_set_rotation(uint8_t rotation) {
+  touch_rotation = rotation & 3;
+}
+
+// Portrait (rotation 0) point to the current rotation, as the ST7789 MADCTL modes
+static void FAST_MEM_ATTR rotate_point(int16_t* x, int16_t* y) {
+  int16_t px = *x, py = *y;
+  switch (touch_rotation) {
+    case 1: *x = py;                     *y = SCREEN_WIDTH - 1 - px;  break;
+    case 2: *x = SCREEN_WIDTH - 1 - px;  *y = SCREEN_HEIGHT - 1 - py; break;
+    case 3: *x = SCREEN_HEIGHT - 1 - py; *y = px;                     break;
+    default: break;
+  }
+}
+
 void touch_init() {
   // Initialize SPI for touch
   SPI.begin(TOUCH_SPI_SCK, TOUCH_SPI_MISO, TOUCH_SPI_MOSI, TOUCH_CS);
@@ -73,6 +92,11 @@ void touch_save_calibration() {
 void sleep_screen() {
   display_set_backlight(0);  // Turn off backlight
   screen_on = false;
+
+#if SPLASH_ENABLED
+  // Keep the current frame for an instant-on boot
+  splash_save(display_get_tft());
+#endif
   Serial.println("Screen sleeping");
 }
 
@@ -90,13 +114,17 @@ void reset_screen_timeout() {
   }
 }
 
+bool screen_is_on() {
+  return screen_on;
+}
+
 void check_screen_timeout() {
   if (screen_on && (millis() - last_activity_time > SCREEN_TIMEOUT_MS)) {
       sleep_screen();
   }
 }
 
-void touch_read_cb(lv_indev_drv_t *drv, lv_indev_data_t *data) {
+void FAST_MEM_ATTR touch_read_cb(lv_indev_drv_t *drv, lv_indev_data_t *data) {
   static TS_Point last_point;
   if (ts.tirqTouched()) {
     
@@ -113,8 +141,9 @@ void touch_read_cb(lv_indev_drv_t *drv, lv_indev_data_t *data) {
       last_point.y = map(p.y, calData.yMax, calData.yMin, 0, SCREEN_HEIGHT);  // Y normal
       
       // Apply constraints
-      last_point.x = constrain(last_point.x, 0, SCREEN_WIDTH);
-      last_point.y = constrain(last_point.y, 0, SCREEN_HEIGHT);
+      last_point.x = constrain(last_point.x, 0, SCREEN_WIDTH - 1);
+      last_point.y = constrain(last_point.y, 0, SCREEN_HEIGHT - 1);
+      rotate_point(&last_point.x, &last_point.y);
       
       data->state = LV_INDEV_STATE_PR;
       Serial.printf("Raw: X=%d, Y=%d | Mapped: X=%d, Y=%d\n", p.x, p.y, last_point.x, last_point.y);
@@ -12,6 +12,9 @@ void touch_calibrate();
 // LVGL touch read callback
 void touch_read_cb(lv_indev_drv_t *drv, lv_indev_data_t *data);
 
+// Map touches to the panel rotation (calibration stays in rotation 0)
+void touch_set_rotation(uint8_t rotation);
+
 // Calibration data structure
 struct CalibrationData {
   int xMin, xMax, yMin, yMax;
@@ -22,5 +25,6 @@ void touch_load_calibration();
 void touch_save_calibration();
 
 void check_screen_timeout();
+bool screen_is_on();
 void reset_screen_timeout();
 void update_voltage_display();
\ No newline at end of file
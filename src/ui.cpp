@@ -4,13 +4,9 @@
 #include "display.h"
 #include "touch.h"
 #include "symbol.h"
-
-// Spotify colors
-#define SPOTIFY_BLACK lv_color_hex(0x121212)
-#define SPOTIFY_GREEN lv_color_hex(0x1DB954)
-#define SPOTIFY_WHITE lv_color_hex(0xFFFFFF)
-#define SPOTIFY_LIGHT_GREY lv_color_hex(0xB3B3B3)
-#define SPOTIFY_DARK_GREY lv_color_hex(0x282828)
+#include "telemetry.h"
+#include "theme.h"
+#include "ui.h"
 
 // UI elements
 static lv_obj_t* brightness_panel;
@@ -41,12 +37,36 @@ void set_led_brightness(uint8_t brightness) {
     analogWrite(LED_PIN_GREEN, pwm_value);
     analogWrite(LED_PIN_BLUE, pwm_value);
     
-    // Update the LED value label if it exists
+    // Update the slider and LED value label if they exist
+    if (led_slider) {
+        lv_slider_set_value(led_slider, brightness, LV_ANIM_OFF);
+    }
     if (led_value_label) {
         lv_label_set_text_fmt(led_value_label, "%d%%", (brightness * 100) / 255);
     }
 }
 
+uint8_t get_led_brightness() {
+    return current_led_brightness;
+}
+
+void set_screen_brightness(uint8_t brightness) {
+    current_screen_brightness = brightness;
+    display_set_backlight(brightness);
+
+    // Keep the slider and label in sync when set from outside the UI
+    if (brightness_slider) {
+        lv_slider_set_value(brightness_slider, brightness, LV_ANIM_OFF);
+    }
+    if (brightness_value_label) {
+        lv_label_set_text_fmt(brightness_value_label, "%d%%", (brightness * 100) / 255);
+    }
+}
+
+uint8_t get_screen_brightness() {
+    return current_screen_brightness;
+}
+
 void update_voltage_display() {
     if (!voltagedisplay || !panel_visible || !screen_on) return;
     
@@ -95,8 +115,6 @@ void create_led_icon(lv_obj_t* parent) {
     // Create label to show LED brightness value
     led_value_label = lv_label_create(parent);
     lv_label_set_text(led_value_label, "0%");
-    lv_obj_set_style_text_color(led_value_label, SPOTIFY_WHITE, 0);
-    lv_obj_set_style_text_font(led_value_label, &lv_font_montserrat_12, 0);
     lv_obj_align(led_value_label, LV_ALIGN_TOP_RIGHT, -1, 57);
 }
 
@@ -115,8 +133,6 @@ void create_brightness_icon(lv_obj_t* parent) {
     // Create label to show brightness value
     brightness_value_label = lv_label_create(parent);
     lv_label_set_text(brightness_value_label, "100%");
-    lv_obj_set_style_text_color(brightness_value_label, SPOTIFY_WHITE, 0);
-    lv_obj_set_style_text_font(brightness_value_label, &lv_font_montserrat_12, 0);
     lv_obj_align(brightness_value_label, LV_ALIGN_TOP_RIGHT, -1, 17);
 }
 
@@ -128,11 +144,6 @@ void create_led_slider(lv_obj_t* parent) {
     lv_slider_set_range(led_slider, 0, 255);
     lv_slider_set_value(led_slider, current_led_brightness, LV_ANIM_OFF);
     lv_obj_add_event_cb(led_slider, led_slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
-    
-    // Slider styling
-    lv_obj_set_style_bg_color(led_slider, SPOTIFY_LIGHT_GREY, LV_PART_MAIN);
-    lv_obj_set_style_bg_color(led_slider, SPOTIFY_GREEN, LV_PART_INDICATOR);
-    lv_obj_set_style_bg_color(led_slider, SPOTIFY_WHITE, LV_PART_KNOB);
 }
 
 void create_brightness_slider(lv_obj_t* parent) {
@@ -142,11 +153,6 @@ void create_brightness_slider(lv_obj_t* parent) {
     lv_slider_set_range(brightness_slider, 10, 255);
     lv_slider_set_value(brightness_slider, current_screen_brightness, LV_ANIM_OFF);
     lv_obj_add_event_cb(brightness_slider, brightness_slider_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
-    
-    // Slider styling
-    lv_obj_set_style_bg_color(brightness_slider, SPOTIFY_LIGHT_GREY, LV_PART_MAIN);
-    lv_obj_set_style_bg_color(brightness_slider, SPOTIFY_GREEN, LV_PART_INDICATOR);
-    lv_obj_set_style_bg_color(brightness_slider, SPOTIFY_WHITE, LV_PART_KNOB);
 }
 
 void create_voltage_display(lv_obj_t* parent) {
@@ -156,22 +162,15 @@ void create_voltage_display(lv_obj_t* parent) {
     // Position at the absolute top-right corner of the panel
     lv_obj_align(voltagedisplay, LV_ALIGN_TOP_RIGHT, -1, 1);
     
-    // Style the label
-    lv_obj_set_style_text_color(voltagedisplay, SPOTIFY_WHITE, 0);
-    lv_obj_set_style_text_font(voltagedisplay, &lv_font_montserrat_12, 0);
+    // No padding and right-aligned text, from the shared theme styles
+    theme_add_value_style(voltagedisplay);
     
     // Make sure label is visible and has enough space
     lv_obj_set_width(voltagedisplay, 60);
     lv_obj_clear_flag(voltagedisplay, LV_OBJ_FLAG_OVERFLOW_VISIBLE); // Ensure text stays within bounds
     
-    // Remove any padding that might push it away from the edge
-    lv_obj_set_style_pad_all(voltagedisplay, 0, 0);
-    
     // Set long mode to make sure text is fully visible
     lv_label_set_long_mode(voltagedisplay, LV_LABEL_LONG_CLIP);
-    
-    // Set text alignment to right
-    lv_obj_set_style_text_align(voltagedisplay, LV_TEXT_ALIGN_RIGHT, 0);
 }
 // Function to update all UI values after waking from sleep
 void update_ui_values() {
@@ -242,6 +241,7 @@ static void brightness_gesture_cb(lv_event_t* e) {
     if (dir == LV_DIR_BOTTOM && !panel_visible) {
         // Set flag first before animation
         panel_visible = true;
+        telemetry_begin_scenario("panel");
         
         // Start voltage updates immediately
         toggle_voltage_timer(true);
@@ -262,16 +262,14 @@ static void brightness_gesture_cb(lv_event_t* e) {
         lv_anim_start(&a);
         panel_visible = false;
         toggle_voltage_timer(false); // Stop voltage updates
+        telemetry_begin_scenario("idle");
     }
 }
 
 void create_pull_panel(lv_obj_t* parent) {
     brightness_panel = lv_obj_create(parent);
     lv_obj_set_size(brightness_panel, LV_PCT(100), 100);
-    lv_obj_set_style_bg_color(brightness_panel, SPOTIFY_DARK_GREY, 0);
-    lv_obj_set_style_radius(brightness_panel, 0, 0);
-    lv_obj_set_style_border_width(brightness_panel, 0, 0);
-    lv_obj_set_style_pad_all(brightness_panel, 2, 0);
+    theme_add_panel_style(brightness_panel);
     lv_obj_align(brightness_panel, LV_ALIGN_TOP_MID, 0, -100);
 
     // Create voltage display
@@ -295,10 +293,7 @@ void on_wake_from_sleep() {
     }
 }
 
-void ui_create() {
-    lv_obj_t *scr = lv_scr_act();
-    lv_obj_set_style_bg_color(scr, SPOTIFY_BLACK, 0);
-
+void ui_create(lv_obj_t* scr) {
     create_pull_panel(scr);
     lv_obj_add_event_cb(scr, brightness_gesture_cb, LV_EVENT_GESTURE, NULL);
     
@@ -310,6 +305,27 @@ void ui_create() {
     }
 }
 
+// The screen is being deleted: forget the widgets so setters from the
+// console or sleep handling do not touch freed objects
+static void ui_destroy() {
+    toggle_voltage_timer(false);
+    brightness_panel = NULL;
+    led_slider = NULL;
+    voltagedisplay = NULL;
+    brightness_slider = NULL;
+    led_icon = NULL;
+    brightness_icon = NULL;
+    led_value_label = NULL;
+    brightness_value_label = NULL;
+    panel_visible = false;
+}
+
+static void ui_suspend() {
+    toggle_voltage_timer(false);
+}
+
+const AppDesc ui_home_app = { "home", ui_create, ui_destroy, ui_suspend, on_wake_from_sleep };
+
 // Call this function in your code when the device wakes from sleep
 // Add this to wherever you handle screen wakeup in your main code
 
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <lvgl.h>
+#include "app_manager.h"
+
+// Build the brightness/LED UI on a screen
+void ui_create(lv_obj_t* scr);
+
+// The UI as an app, with teardown and suspend hooks for the app manager
+extern const AppDesc ui_home_app;
+
+// LED and screen brightness (0-255), kept in sync with the sliders
+void set_led_brightness(uint8_t brightness);
+uint8_t get_led_brightness();
+void set_screen_brightness(uint8_t brightness);
+uint8_t get_screen_brightness();
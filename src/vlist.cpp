@@ -0,0 +1,196 @@
+#include "vlist.h"
+
+struct VList {
+  uint32_t count;
+  lv_coord_t row_h;
+  int32_t offset;           // Scroll position in pixels (top of the viewport)
+  int32_t velocity;         // Momentum in 1/256 px per tick
+  int32_t drag;             // Distance dragged since the press
+  vlist_bind_cb_t bind;
+  void* user_data;
+  uint16_t pool;            // Row objects
+  lv_obj_t** rows;
+  uint32_t* bound;          // Data row shown by each row object
+  lv_timer_t* momentum;
+  uint32_t selected;
+  uint32_t binds;
+};
+
+static VList* get(lv_obj_t* list) {
+  return (VList*)lv_obj_get_user_data(list);
+}
+
+static int32_t max_offset(lv_obj_t* list, VList* v) {
+  int32_t m = (int32_t)v->count * v->row_h - lv_obj_get_content_height(list);
+  return m > 0 ? m : 0;
+}
+
+// Row k lives in slot k % pool, so scrolling by one row rebinds one object
+static void layout(lv_obj_t* list, VList* v, bool rebind) {
+  int32_t first = v->offset / v->row_h - VLIST_MARGIN_ROWS;
+  if (first < 0) first = 0;
+  for (uint32_t k = first; k < (uint32_t)first + v->pool; k++) {
+    uint16_t slot = k % v->pool;
+    lv_obj_t* row = v->rows[slot];
+    if (k >= v->count) {
+      lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+      v->bound[slot] = UINT32_MAX;
+      continue;
+    }
+    if (rebind || v->bound[slot] != k) {
+      v->bind(row, k, v->user_data);
+      v->bound[slot] = k;
+      v->binds++;
+    }
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_set_y(row, (int32_t)k * v->row_h - v->offset);  // Always within the viewport's range
+  }
+}
+
+// Enough rows for the viewport, one partly visible row and the margin on
+// both sides. Grows only (a rotation or parent resize can make the viewport
+// taller); the slot of each row changes with the pool, so false when nothing
+// was added and the bound rows are still valid.
+static bool size_pool(lv_obj_t* list, VList* v) {
+  lv_coord_t h = lv_obj_get_content_height(list);
+  uint16_t pool = (h + v->row_h - 1) / v->row_h + 1 + 2 * VLIST_MARGIN_ROWS;
+  if (pool <= v->pool) return false;
+  lv_obj_t** rows = (lv_obj_t**)lv_mem_realloc(v->rows, pool * sizeof(lv_obj_t*));
+  if (!rows) return false;
+  v->rows = rows;
+  uint32_t* bound = (uint32_t*)lv_mem_realloc(v->bound, pool * sizeof(uint32_t));
+  if (!bound) return false;  // rows stays larger than needed, harmless
+  v->bound = bound;
+  for (uint16_t i = v->pool; i < pool; i++) {
+    lv_obj_t* row = lv_label_create(list);
+    lv_obj_set_size(row, LV_PCT(100), v->row_h);
+    lv_label_set_long_mode(row, LV_LABEL_LONG_DOT);
+    lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+    v->rows[i] = row;
+  }
+  v->pool = pool;
+  for (uint16_t i = 0; i < pool; i++) {
+    lv_obj_add_flag(v->rows[i], LV_OBJ_FLAG_HIDDEN);
+    v->bound[i] = UINT32_MAX;
+  }
+  return true;
+}
+
+static void scroll_to_offset(lv_obj_t* list, VList* v, int32_t offset) {
+  int32_t max = max_offset(list, v);
+  if (offset > max) offset = max;
+  if (offset < 0) offset = 0;
+  if (offset == v->offset) return;
+  v->offset = offset;
+  layout(list, v, false);
+}
+
+static void momentum_cb(lv_timer_t* timer) {
+  lv_obj_t* list = (lv_obj_t*)timer->user_data;
+  VList* v = get(list);
+  int32_t before = v->offset;
+  scroll_to_offset(list, v, v->offset - v->velocity / 256);
+  v->velocity = v->velocity * VLIST_FRICTION / 256;
+  if (v->offset == before || abs(v->velocity) < 256) {
+    v->velocity = 0;
+    lv_timer_pause(timer);
+  }
+}
+
+static void event_cb(lv_event_t* e) {
+  lv_obj_t* list = lv_event_get_target(e);
+  VList* v = get(list);
+  lv_event_code_t code = lv_event_get_code(e);
+
+  if (code == LV_EVENT_PRESSED) {
+    v->velocity = 0;
+    v->drag = 0;
+    lv_timer_pause(v->momentum);
+  } else if (code == LV_EVENT_PRESSING) {
+    lv_point_t vect;
+    lv_indev_get_vect(lv_indev_get_act(), &vect);
+    v->drag += abs(vect.y);
+    // Smoothed finger speed becomes the fling velocity
+    v->velocity = (v->velocity + vect.y * 256) / 2;
+    scroll_to_offset(list, v, v->offset - vect.y);
+  } else if (code == LV_EVENT_RELEASED) {
+    if (abs(v->velocity) >= 256) lv_timer_resume(v->momentum);
+  } else if (code == LV_EVENT_CLICKED) {
+    if (v->drag > VLIST_TAP_SLOP) return;
+    lv_point_t p;
+    lv_indev_get_point(lv_indev_get_act(), &p);
+    lv_area_t area;
+    lv_obj_get_content_coords(list, &area);
+    uint32_t index = (v->offset + p.y - area.y1) / v->row_h;
+    if (index < v->count) {
+      v->selected = index;
+      lv_event_send(list, LV_EVENT_VALUE_CHANGED, NULL);
+    }
+  } else if (code == LV_EVENT_SIZE_CHANGED) {
+    bool grown = size_pool(list, v);
+    int32_t max = max_offset(list, v);
+    if (v->offset > max) v->offset = max;
+    layout(list, v, grown);
+  } else if (code == LV_EVENT_DELETE) {
+    lv_timer_del(v->momentum);
+    lv_mem_free(v->rows);
+    lv_mem_free(v->bound);
+    lv_mem_free(v);
+  }
+}
+
+lv_obj_t* vlist_create(lv_obj_t* parent, uint32_t count, lv_coord_t row_height,
+                       vlist_bind_cb_t bind, void* user_data) {
+  lv_obj_t* list = lv_obj_create(parent);
+  lv_obj_clear_flag(list, LV_OBJ_FLAG_SCROLLABLE);  // Scrolled here, not by LVGL
+  lv_obj_set_size(list, LV_PCT(100), LV_PCT(100));
+  lv_obj_update_layout(list);
+
+  VList* v = (VList*)lv_mem_alloc(sizeof(VList));
+  memset(v, 0, sizeof(*v));
+  v->count = count;
+  v->row_h = row_height;
+  v->bind = bind;
+  v->user_data = user_data;
+  v->selected = UINT32_MAX;
+
+  size_pool(list, v);
+  lv_obj_set_user_data(list, v);
+
+  v->momentum = lv_timer_create(momentum_cb, VLIST_MOMENTUM_MS, list);
+  lv_timer_pause(v->momentum);
+  lv_obj_add_event_cb(list, event_cb, LV_EVENT_ALL, NULL);
+
+  layout(list, v, true);
+  return list;
+}
+
+void vlist_set_count(lv_obj_t* list, uint32_t count) {
+  VList* v = get(list);
+  v->count = count;
+  int32_t max = max_offset(list, v);
+  if (v->offset > max) v->offset = max;
+  layout(list, v, true);
+}
+
+void vlist_refresh(lv_obj_t* list) {
+  layout(list, get(list), true);
+}
+
+void vlist_scroll_by(lv_obj_t* list, int32_t dy) {
+  VList* v = get(list);
+  scroll_to_offset(list, v, v->offset + dy);
+}
+
+void vlist_scroll_to(lv_obj_t* list, uint32_t index) {
+  VList* v = get(list);
+  scroll_to_offset(list, v, (int32_t)index * v->row_h);
+}
+
+uint32_t vlist_get_selected(lv_obj_t* list) {
+  return get(list)->selected;
+}
+
+uint32_t vlist_get_bind_count(lv_obj_t* list) {
+  return get(list)->binds;
+}
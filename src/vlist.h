@@ -0,0 +1,31 @@
+#pragma once
+
+#include <lvgl.h>
+#include "config.h"
+
+// Fill a row label for data row 'index'
+typedef void (*vlist_bind_cb_t)(lv_obj_t* row, uint32_t index, void* user_data);
+
+// Virtualized list: only enough label rows for the viewport plus
+// VLIST_MARGIN_ROWS on each side exist (more are added if the list grows
+// taller); they are moved and rebound from bind as the list scrolls. The
+// scroll offset is kept in 32 bits, so the list is not limited by LVGL's
+// coordinate range. Drag scrolling with momentum is built in. Sends
+// LV_EVENT_VALUE_CHANGED on a row tap.
+lv_obj_t* vlist_create(lv_obj_t* parent, uint32_t count, lv_coord_t row_height,
+                       vlist_bind_cb_t bind, void* user_data);
+
+// Change the number of data rows (rebinds everything visible)
+void vlist_set_count(lv_obj_t* list, uint32_t count);
+
+// Rebind the visible rows after the data changed
+void vlist_refresh(lv_obj_t* list);
+
+void vlist_scroll_by(lv_obj_t* list, int32_t dy);
+void vlist_scroll_to(lv_obj_t* list, uint32_t index);
+
+// Data row of the last tap
+uint32_t vlist_get_selected(lv_obj_t* list);
+
+// Rows bound since creation (how much rebinding scrolling costs)
+uint32_t vlist_get_bind_count(lv_obj_t* list);
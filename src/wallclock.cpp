@@ -0,0 +1,378 @@
+#include <sys/time.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include "wallclock.h"
+#include "audio.h"
+#include "console.h"
+#include "library.h"
+#include "storage.h"
+#include "touch.h"
+
+#define EPOCH_MIN 1577836800    // 2020-01-01: anything earlier was never set
+
+struct Subscriber {
+  WallclockRes res;
+  wallclock_tick_cb_t cb;
+  void* user_data;
+};
+
+static Subscriber subs[WALLCLOCK_MAX_SUBS];
+static uint8_t sub_count = 0;
+static lv_timer_t* tick_timer = NULL;
+static struct tm last_tm;
+static bool have_last = false;
+
+// Discipline
+static int64_t last_sync_us = 0;        // esp_timer time of the last applied fix, 0 to relearn
+static int64_t drift_applied_us = 0;    // Drift corrected up to this esp_timer time
+static int32_t drift_ppb = 0;
+
+static WallclockStats stats;
+
+static int64_t now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// Add to whatever slew is still pending (adjtime replaces it otherwise)
+static void slew_us(int64_t us) {
+  struct timeval old;
+  adjtime(NULL, &old);
+  us += (int64_t)old.tv_sec * 1000000 + old.tv_usec;
+  struct timeval delta = { (time_t)(us / 1000000), (suseconds_t)(us % 1000000) };
+  adjtime(&delta, NULL);
+}
+
+static void apply_drift() {
+  int64_t t = esp_timer_get_time();
+  if (drift_applied_us == 0 || drift_ppb == 0) {
+    drift_applied_us = t;
+    return;
+  }
+  int64_t corr = (t - drift_applied_us) * drift_ppb / 1000000000LL;
+  if (corr == 0) return;  // Keep accumulating the fraction
+  slew_us(-corr);
+  drift_applied_us = t;
+}
+
+static WallclockRes finest_res() {
+  for (uint8_t i = 0; i < sub_count; i++) {
+    if (subs[i].res == WALLCLOCK_SECOND) return WALLCLOCK_SECOND;
+  }
+  return WALLCLOCK_MINUTE;
+}
+
+static int64_t us_to_boundary(WallclockRes res) {
+  int64_t period = res == WALLCLOCK_SECOND ? 1000000 : 60000000;
+  return period - now_us() % period;
+}
+
+static void schedule_tick() {
+  if (!tick_timer) return;
+  // Just past the boundary, so the new second is already showing
+  uint32_t ms = (uint32_t)(us_to_boundary(finest_res()) / 1000) + 2;
+  lv_timer_set_period(tick_timer, ms);
+}
+
+static void tick_cb(lv_timer_t* timer) {
+  struct tm now;
+  wallclock_now(&now);
+  uint8_t changed = WALLCLOCK_CHANGED_SEC | WALLCLOCK_CHANGED_MIN | WALLCLOCK_CHANGED_HOUR | WALLCLOCK_CHANGED_DAY;
+  if (have_last) {
+    changed = 0;
+    if (now.tm_sec != last_tm.tm_sec) changed |= WALLCLOCK_CHANGED_SEC;
+    if (now.tm_min != last_tm.tm_min) changed |= WALLCLOCK_CHANGED_MIN;
+    if (now.tm_hour != last_tm.tm_hour) changed |= WALLCLOCK_CHANGED_HOUR;
+    if (now.tm_mday != last_tm.tm_mday) changed |= WALLCLOCK_CHANGED_DAY;
+  }
+  last_tm = now;
+  have_last = true;
+
+  if (changed & WALLCLOCK_CHANGED_SEC) {
+    uint32_t late = (uint32_t)(now_us() % 1000000 / 1000);
+    if (late > stats.tick_late_max_ms) stats.tick_late_max_ms = late;
+    stats.ticks++;
+  }
+  for (uint8_t i = 0; i < sub_count; i++) {
+    uint8_t need = subs[i].res == WALLCLOCK_SECOND ? WALLCLOCK_CHANGED_SEC : WALLCLOCK_CHANGED_MIN;
+    if (changed & need) subs[i].cb(&now, changed, subs[i].user_data);
+  }
+
+  apply_drift();
+  schedule_tick();
+}
+
+bool wallclock_valid() {
+  return time(NULL) >= EPOCH_MIN;
+}
+
+void wallclock_set(time_t utc) {
+  struct timeval tv = { utc, 0 };
+  settimeofday(&tv, NULL);
+  last_sync_us = 0;
+  if (tick_timer) lv_timer_ready(tick_timer);
+}
+
+void wallclock_now(struct tm* local) {
+  time_t t = time(NULL);
+  localtime_r(&t, local);
+}
+
+bool wallclock_subscribe(WallclockRes res, wallclock_tick_cb_t cb, void* user_data) {
+  if (sub_count >= WALLCLOCK_MAX_SUBS) return false;
+  subs[sub_count++] = { res, cb, user_data };
+  schedule_tick();
+  return true;
+}
+
+void wallclock_unsubscribe(wallclock_tick_cb_t cb, void* user_data) {
+  for (uint8_t i = 0; i < sub_count; i++) {
+    if (subs[i].cb == cb && subs[i].user_data == user_data) {
+      subs[i] = subs[--sub_count];
+      break;
+    }
+  }
+  schedule_tick();
+}
+
+void wallclock_gps_sync(time_t utc, int64_t at_us) {
+  int64_t t = esp_timer_get_time();
+  bool valid = wallclock_valid();
+  // Fixes in between only add noise to the rate estimate
+  if (valid && last_sync_us && t - last_sync_us < (int64_t)WALLCLOCK_GPS_INTERVAL_S * 1000000) return;
+
+  int64_t offset = now_us() - (t - at_us) - (int64_t)utc * 1000000;
+  stats.gps_syncs++;
+  stats.last_offset_us = (int32_t)constrain(offset, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+
+  if (!valid || llabs(offset) > WALLCLOCK_STEP_US) {
+    int64_t target = (int64_t)utc * 1000000 + (t - at_us);
+    struct timeval tv = { (time_t)(target / 1000000), (suseconds_t)(target % 1000000) };
+    settimeofday(&tv, NULL);
+    stats.gps_steps++;
+    last_sync_us = at_us;  // Relearn from here, keeping the rate learned so far
+    return;
+  }
+
+  // What is left after the drift correction is the remaining rate error
+  apply_drift();
+  if (last_sync_us) {
+    int64_t residual = offset * 1000000000LL / (at_us - last_sync_us);
+    drift_ppb = constrain(drift_ppb + (int32_t)(residual / 2), -WALLCLOCK_DRIFT_MAX_PPB, WALLCLOCK_DRIFT_MAX_PPB);
+  }
+  slew_us(-offset);
+  last_sync_us = at_us;
+}
+
+// Days since 1970-01-01 of a civil date
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+static uint32_t two_digits(const char* p) {
+  return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+bool wallclock_feed_nmea(const char* sentence, int64_t rx_us) {
+  // $xxRMC,hhmmss.sss,A,lat,N,lon,E,speed,course,ddmmyy,...*CS
+  if (sentence[0] != '$' || strncmp(sentence + 3, "RMC,", 4) != 0) return false;
+  const char* star = strchr(sentence, '*');
+  if (!star || strlen(star) < 3) return false;
+  uint8_t sum = 0;
+  for (const char* p = sentence + 1; p < star; p++) sum ^= (uint8_t)*p;
+  if (sum != (uint8_t)strtoul(star + 1, NULL, 16)) return false;
+
+  const char* field[10];
+  uint8_t n = 0;
+  for (const char* p = sentence; p < star && n < 10; p++) {
+    if (*p == ',') field[n++] = p + 1;
+  }
+  if (n < 9 || field[1][0] != 'A' || star - field[0] < 6 || star - field[8] < 6) return false;
+  for (uint8_t i = 0; i < 6; i++) {
+    if (!isdigit(field[0][i]) || !isdigit(field[8][i])) return false;
+  }
+
+  uint32_t frac_us = 0;
+  if (field[0][6] == '.') {
+    uint32_t scale = 100000;
+    for (const char* p = field[0] + 7; isdigit(*p) && scale; p++, scale /= 10) frac_us += (*p - '0') * scale;
+  }
+  int32_t days = days_from_civil(2000 + two_digits(field[8] + 4), two_digits(field[8] + 2), two_digits(field[8]));
+  time_t utc = (time_t)days * 86400 + two_digits(field[0]) * 3600 + two_digits(field[0] + 2) * 60 +
+               two_digits(field[0] + 4);
+  wallclock_gps_sync(utc, rx_us - (int64_t)WALLCLOCK_NMEA_LATENCY_MS * 1000 - frac_us);
+  return true;
+}
+
+// Light sleep only when no task needs the CPU and, with the screen on, a
+// clock face is left alone with nothing animating or waiting to be drawn.
+// The backlight PWM runs on RTC8M_CLK and stays lit through the sleep.
+static bool can_sleep() {
+  if (audio_get_state() == AUDIO_PLAYING || !storage_idle()) return false;
+  LibraryStats lib;
+  library_get_stats(&lib);
+  if (lib.scanning) return false;
+  if (!screen_is_on()) return true;
+  lv_disp_t* disp = lv_disp_get_default();
+  return sub_count > 0 && lv_disp_get_inactive_time(disp) > WALLCLOCK_SLEEP_IDLE_MS &&
+         lv_anim_count_running() == 0 && disp->inv_p == 0;
+}
+
+void wallclock_idle(uint32_t ms) {
+#if WALLCLOCK_LIGHT_SLEEP
+  if (can_sleep()) {
+    int64_t until = us_to_boundary(screen_is_on() ? finest_res() : WALLCLOCK_MINUTE) + 2000;
+    if (until >= WALLCLOCK_SLEEP_MIN_MS * 1000) {
+      esp_sleep_enable_timer_wakeup(until);
+      // Level wakeup replaces the touch driver's edge interrupt while asleep
+      gpio_wakeup_enable((gpio_num_t)TOUCH_IRQ, GPIO_INTR_LOW_LEVEL);
+      Serial.flush();
+      int64_t t = esp_timer_get_time();
+      esp_light_sleep_start();
+      gpio_wakeup_disable((gpio_num_t)TOUCH_IRQ);
+      gpio_set_intr_type((gpio_num_t)TOUCH_IRQ, GPIO_INTR_NEGEDGE);
+      uint32_t slept_ms = (uint32_t)((esp_timer_get_time() - t) / 1000);
+      // LVGL's tick timer stops in light sleep
+      lv_tick_inc(slept_ms);
+      stats.sleeps++;
+      stats.sleep_ms += slept_ms;
+      return;
+    }
+  }
+#endif
+  delay(ms);
+}
+
+void wallclock_get_stats(WallclockStats* out) {
+  *out = stats;
+  out->drift_ppb = drift_ppb;
+}
+
+/***************************************************************************************
+** Digital clock, one label per character
+***************************************************************************************/
+
+struct Digits {
+  WallclockRes res;
+  bool active;
+  uint8_t count;            // 5 (HH:MM) or 8 (HH:MM:SS)
+  char shown[9];
+  lv_obj_t* label[8];
+};
+
+static void digits_update(lv_obj_t* obj, const struct tm* now) {
+  Digits* d = (Digits*)lv_obj_get_user_data(obj);
+  char text[9];
+  strftime(text, sizeof(text), d->res == WALLCLOCK_SECOND ? "%H:%M:%S" : "%H:%M", now);
+  for (uint8_t i = 0; i < d->count; i++) {
+    if (text[i] == d->shown[i]) continue;
+    char c[2] = { text[i], 0 };
+    lv_label_set_text(d->label[i], c);
+    d->shown[i] = text[i];
+  }
+}
+
+static void digits_tick(const struct tm* now, uint8_t changed, void* user_data) {
+  digits_update((lv_obj_t*)user_data, now);
+}
+
+static void digits_event_cb(lv_event_t* e) {
+  lv_obj_t* obj = lv_event_get_target(e);
+  wallclock_digits_set_active(obj, false);
+  lv_mem_free(lv_obj_get_user_data(obj));
+}
+
+lv_obj_t* wallclock_digits_create(lv_obj_t* parent, WallclockRes res, const lv_font_t* font) {
+  lv_obj_t* obj = lv_obj_create(parent);
+  lv_obj_remove_style_all(obj);
+  lv_obj_set_size(obj, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
+  lv_obj_set_flex_flow(obj, LV_FLEX_FLOW_ROW);
+
+  Digits* d = (Digits*)lv_mem_alloc(sizeof(Digits));
+  memset(d, 0, sizeof(*d));
+  d->res = res;
+  d->count = res == WALLCLOCK_SECOND ? 8 : 5;
+
+  // Every digit is as wide as the widest one, so with a proportional font a
+  // new digit never resizes the row and moves (and redraws) its neighbours
+  lv_coord_t digit_w = 0;
+  for (char c = '0'; c <= '9'; c++) digit_w = max<lv_coord_t>(digit_w, lv_font_get_glyph_width(font, c, 0));
+  lv_coord_t colon_w = lv_font_get_glyph_width(font, ':', 0);
+  for (uint8_t i = 0; i < d->count; i++) {
+    d->label[i] = lv_label_create(obj);
+    lv_obj_set_style_text_font(d->label[i], font, 0);  // Over the theme's label font
+    lv_obj_set_style_text_align(d->label[i], LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_width(d->label[i], i % 3 == 2 ? colon_w : digit_w);
+    lv_label_set_text(d->label[i], "");
+  }
+  lv_obj_set_user_data(obj, d);
+  lv_obj_add_event_cb(obj, digits_event_cb, LV_EVENT_DELETE, NULL);
+
+  wallclock_digits_set_active(obj, true);
+  return obj;
+}
+
+void wallclock_digits_set_active(lv_obj_t* obj, bool active) {
+  Digits* d = (Digits*)lv_obj_get_user_data(obj);
+  if (d->active == active) return;
+  d->active = active;
+  if (active) {
+    struct tm now;
+    wallclock_now(&now);
+    digits_update(obj, &now);  // Catch up on what changed while inactive
+    wallclock_subscribe(d->res, digits_tick, obj);
+  } else {
+    wallclock_unsubscribe(digits_tick, obj);
+  }
+}
+
+/***************************************************************************************
+** Console
+***************************************************************************************/
+
+static void cmd_time(int argc, char** argv) {
+  uint32_t value;
+  if (argc > 2 && strcmp(argv[1], "set") == 0 && console_parse_uint(argv[2], UINT32_MAX, &value)) {
+    wallclock_set((time_t)value);
+  } else if (argc > 2 && strcmp(argv[1], "nmea") == 0) {
+    if (!wallclock_feed_nmea(argv[2], esp_timer_get_time())) Serial.println("time: not a valid RMC sentence");
+  } else if (argc > 1) {
+    Serial.println("usage: time [set <unix_seconds>|nmea <sentence>]");
+    return;
+  }
+
+  struct tm now;
+  wallclock_now(&now);
+  char text[24];
+  strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &now);
+  WallclockStats s;
+  wallclock_get_stats(&s);
+  Serial.printf("TIME,local=%s,valid=%d,subs=%u,ticks=%u,tick_late_max_ms=%u,sleeps=%u,sleep_ms=%u,"
+                "gps_syncs=%u,gps_steps=%u,offset_us=%d,drift_ppb=%d\n",
+                text, wallclock_valid(), sub_count, s.ticks, s.tick_late_max_ms, s.sleeps, s.sleep_ms,
+                s.gps_syncs, s.gps_steps, s.last_offset_us, s.drift_ppb);
+}
+
+void wallclock_init() {
+  setenv("TZ", WALLCLOCK_TZ, 1);
+  tzset();
+
+#if WALLCLOCK_LIGHT_SLEEP
+  // Touch and serial input end a light sleep (the first characters are lost)
+  esp_sleep_enable_gpio_wakeup();
+  uart_set_wakeup_threshold(UART_NUM_0, 3);
+  esp_sleep_enable_uart_wakeup(0);
+#endif
+
+  tick_timer = lv_timer_create(tick_cb, 1000, NULL);
+  schedule_tick();
+  console_register("time", "[set <unix_seconds>|nmea <sentence>] wall clock, sleep and GPS discipline", cmd_time);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+#include <lvgl.h>
+#include "config.h"
+
+enum WallclockRes {
+  WALLCLOCK_MINUTE,
+  WALLCLOCK_SECOND
+};
+
+// Local time fields that changed since the previous tick
+#define WALLCLOCK_CHANGED_SEC  0x01
+#define WALLCLOCK_CHANGED_MIN  0x02
+#define WALLCLOCK_CHANGED_HOUR 0x04
+#define WALLCLOCK_CHANGED_DAY  0x08
+
+typedef void (*wallclock_tick_cb_t)(const struct tm* local, uint8_t changed, void* user_data);
+
+struct WallclockStats {
+  uint32_t ticks;
+  uint32_t tick_late_max_ms;  // Latest tick after its boundary
+  uint32_t sleeps;            // Light sleeps entered from the idle loop
+  uint32_t sleep_ms;          // Time spent in them
+  uint32_t gps_syncs;         // GPS fixes applied
+  uint32_t gps_steps;         // Of those, clock steps instead of slews
+  int32_t last_offset_us;     // Clock minus GPS at the last fix
+  int32_t drift_ppb;          // Learned rate error, slewed out between fixes
+};
+
+// Apply WALLCLOCK_TZ, start the tick timer and register the 'time' console
+// command. The system time itself runs on the RTC timer and survives light
+// sleep and soft resets.
+void wallclock_init();
+
+bool wallclock_valid();             // Set since power-on (from the console or GPS)
+void wallclock_set(time_t utc);
+void wallclock_now(struct tm* local);
+
+// Call cb from the LVGL thread on each minute or second boundary. With the
+// screen on, the idle loop sleeps until the next boundary of the finest
+// resolution subscribed, so faces should unsubscribe while hidden.
+bool wallclock_subscribe(WallclockRes res, wallclock_tick_cb_t cb, void* user_data);
+void wallclock_unsubscribe(wallclock_tick_cb_t cb, void* user_data);
+
+// GPS time: 'utc' started at esp_timer time at_us (PPS edge, or sentence
+// arrival). Large offsets step the clock, small ones are slewed out and
+// teach the rate error, which is then corrected between fixes.
+void wallclock_gps_sync(time_t utc, int64_t at_us);
+
+// Feed one NMEA sentence ($GPRMC/$GNRMC with a valid fix are used)
+bool wallclock_feed_nmea(const char* sentence, int64_t rx_us);
+
+// Main loop idle: light sleep until the next minute with the screen off, or
+// until the next tick a visible face needs once the UI has been idle for
+// WALLCLOCK_SLEEP_IDLE_MS (touch and serial input wake early); a plain delay
+// while anything else is running
+void wallclock_idle(uint32_t ms);
+
+// HH:MM or HH:MM:SS in 'font', one fixed-width label per character; a tick
+// only sets the digits that changed, so only those are redrawn. Inactive
+// ones neither update nor keep the idle loop waking every second.
+lv_obj_t* wallclock_digits_create(lv_obj_t* parent, WallclockRes res, const lv_font_t* font);
+void wallclock_digits_set_active(lv_obj_t* digits, bool active);
+
+void wallclock_get_stats(WallclockStats* stats);
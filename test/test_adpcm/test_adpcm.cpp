@@ -0,0 +1,205 @@
+// IMA-ADPCM decoder on the host: round trip checks and decode cost per
+// second of audio (pio test -e native). Results print as BENCH lines in the
+// device format, with host microseconds and, on x86, TSC cycles.
+
+#include <unity.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "adpcm.h"
+
+#define SPB 1017                      // Frames per block: 1024-byte blocks in stereo, 512 in mono
+#define SECONDS 10
+#define ITERATIONS 20
+
+struct MemReader {
+  const uint8_t* data;
+  size_t len;
+  size_t pos;
+};
+
+static size_t mem_read(void* ctx, uint8_t* buf, size_t len) {
+  MemReader* r = (MemReader*)ctx;
+  len = min(len, r->len - r->pos);
+  memcpy(buf, r->data + r->pos, len);
+  r->pos += len;
+  return len;
+}
+
+static void put_le(uint8_t* p, uint32_t v, int bytes) {
+  for (int i = 0; i < bytes; i++) p[i] = v >> (i * 8);
+}
+
+static int16_t signal(uint32_t n, int c) {
+  return 9000 * sinf(n * (0.06f + 0.03f * c)) + 3000 * sinf(n * 0.71f);
+}
+
+// SECONDS of a two-tone signal as an in-memory IMA-ADPCM WAV
+static uint8_t* make_wav(uint16_t channels, size_t* len, AdpcmChannel* state) {
+  const uint32_t blocks = (AUDIO_SAMPLE_RATE * SECONDS + SPB - 1) / SPB;
+  const uint16_t block_align = 4 * channels + (SPB - 1) / 2 * channels;
+  const size_t header = 12 + 8 + 16 + 8;
+  *len = header + blocks * block_align;
+
+  uint8_t* wav = (uint8_t*)malloc(*len);
+  memcpy(wav, "RIFF", 4);
+  put_le(wav + 4, *len - 8, 4);
+  memcpy(wav + 8, "WAVEfmt ", 8);
+  put_le(wav + 16, 16, 4);
+  put_le(wav + 20, 0x11, 2);
+  put_le(wav + 22, channels, 2);
+  put_le(wav + 24, AUDIO_SAMPLE_RATE, 4);
+  put_le(wav + 28, AUDIO_SAMPLE_RATE * block_align / SPB, 4);
+  put_le(wav + 32, block_align, 2);
+  put_le(wav + 34, 4, 2);
+  memcpy(wav + 36, "data", 4);
+  put_le(wav + 40, blocks * block_align, 4);
+
+  int16_t pcm[SPB * 2];
+  memset(state, 0, 2 * sizeof(AdpcmChannel));
+  for (uint32_t b = 0, n = 0; b < blocks; b++) {
+    for (int i = 0; i < SPB; i++, n++) {
+      for (int c = 0; c < channels; c++) pcm[i * channels + c] = signal(n, c);
+    }
+    adpcm_encode_block(state, channels, pcm, SPB, wav + header + b * block_align);
+  }
+  return wav;
+}
+
+static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static AdpcmDecoder dec;
+static int16_t out[AUDIO_FEED_FRAMES * 2];
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+// Full length, close to the input on average (the fast tone lags), and ends on the encoder's reconstruction
+static void check_round_trip(uint16_t channels) {
+  size_t len;
+  AdpcmChannel enc[2];
+  uint8_t* wav = make_wav(channels, &len, enc);
+  MemReader r = { wav, len, 0 };
+  TEST_ASSERT_TRUE(adpcm_open(&dec, mem_read, &r));
+  TEST_ASSERT_EQUAL_UINT32(AUDIO_SAMPLE_RATE, dec.sample_rate);
+
+  uint32_t frames = 0, n;
+  uint64_t err_sum = 0;
+  while ((n = adpcm_decode(&dec, out, AUDIO_FEED_FRAMES)) > 0) {
+    for (uint32_t i = 0; i < n; i++) {
+      for (int c = 0; c < 2; c++) {
+        err_sum += abs(out[i * 2 + c] - signal(frames + i, channels == 1 ? 0 : c));
+      }
+    }
+    frames += n;
+  }
+  TEST_ASSERT_EQUAL_UINT32(dec.total_frames, frames);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(AUDIO_SAMPLE_RATE * SECONDS, frames);
+  TEST_ASSERT_LESS_THAN_UINT32(512, err_sum / (frames * 2));
+  uint32_t last = (frames - 1) % AUDIO_FEED_FRAMES;
+  TEST_ASSERT_EQUAL_INT16(enc[0].predictor, out[last * 2]);
+  TEST_ASSERT_EQUAL_INT16(enc[channels - 1].predictor, out[last * 2 + 1]);
+  free(wav);
+}
+
+static void test_mono_round_trip() {
+  check_round_trip(1);
+}
+
+static void test_stereo_round_trip() {
+  check_round_trip(2);
+}
+
+// A tail shorter than a block counts only the whole nibble groups decoded
+static void test_partial_block_length() {
+  size_t len;
+  AdpcmChannel enc[2];
+  uint8_t* wav = make_wav(1, &len, enc);
+  const uint16_t block_align = 4 + (SPB - 1) / 2;
+  const uint32_t data = 2 * block_align + 10;
+  put_le(wav + 40, data, 4);
+  MemReader r = { wav, 44 + data, 0 };
+  TEST_ASSERT_TRUE(adpcm_open(&dec, mem_read, &r));
+  TEST_ASSERT_EQUAL_UINT32(2 * SPB + 9, dec.total_frames);
+
+  uint32_t frames = 0, n;
+  while ((n = adpcm_decode(&dec, out, AUDIO_FEED_FRAMES)) > 0) frames += n;
+  TEST_ASSERT_EQUAL_UINT32(dec.total_frames, frames);
+  free(wav);
+}
+
+// Decode in feeder-sized reads, as the audio engine does
+static void bench_decode(uint16_t channels) {
+  size_t len;
+  AdpcmChannel enc[2];
+  uint8_t* wav = make_wav(channels, &len, enc);
+  MemReader r = { wav, len, 0 };
+
+  uint64_t c = cycles();
+  uint32_t t = micros();
+  for (int i = 0; i < ITERATIONS; i++) {
+    r.pos = 0;
+    adpcm_open(&dec, mem_read, &r);
+    while (adpcm_decode(&dec, out, AUDIO_FEED_FRAMES) > 0) {}
+  }
+  t = micros() - t;
+  c = cycles() - c;
+  free(wav);
+
+  const char* name = channels == 1 ? "host_decode_mono" : "host_decode_stereo";
+  uint32_t audio_ms = ITERATIONS * adpcm_duration_ms(&dec);
+  // BENCH,adpcm,<name>,<iterations>,<total_us>,<us_per_iter>
+  printf("BENCH,adpcm,%s,%u,%u,%u\n", name, ITERATIONS, t, t / ITERATIONS);
+  // BENCH,adpcm,<name>_cpu,<host_cycles_per_audio_second>,<us_per_audio_second>
+  printf("BENCH,adpcm,%s_cpu,%llu,%u\n", name, (unsigned long long)(c * 1000 / audio_ms),
+         (uint32_t)((uint64_t)t * 1000 / audio_ms));
+  TEST_ASSERT_GREATER_THAN_UINT32(0, t);
+}
+
+static void test_bench_mono() {
+  bench_decode(1);
+}
+
+static void test_bench_stereo() {
+  bench_decode(2);
+}
+
+// Through the engine: the decoder as a source, rendered to a WAV file
+static void test_engine_plays_adpcm() {
+  size_t len;
+  AdpcmChannel enc[2];
+  uint8_t* wav = make_wav(2, &len, enc);
+  MemReader r = { wav, len, 0 };
+  TEST_ASSERT_TRUE(adpcm_open(&dec, mem_read, &r));
+
+  audio_set_volume(255);
+  audio_play(adpcm_source(&dec));
+  TEST_ASSERT_TRUE(audio_host_render("test_adpcm.wav", AUDIO_SAMPLE_RATE * SECONDS + AUDIO_SAMPLE_RATE / 2, 1));
+  TEST_ASSERT_EQUAL(AUDIO_STOPPED, audio_get_state());
+  AudioStats stats;
+  audio_get_stats(&stats, false);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.underruns);
+  TEST_ASSERT_EQUAL_UINT32(dec.total_frames, stats.frames_out);
+  free(wav);
+}
+
+int main(int argc, char** argv) {
+  audio_init();
+  UNITY_BEGIN();
+  RUN_TEST(test_mono_round_trip);
+  RUN_TEST(test_stereo_round_trip);
+  RUN_TEST(test_partial_block_length);
+  RUN_TEST(test_bench_mono);
+  RUN_TEST(test_bench_stereo);
+  RUN_TEST(test_engine_plays_adpcm);
+  return UNITY_END();
+}
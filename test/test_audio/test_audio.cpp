@@ -0,0 +1,145 @@
+// Audio engine on the host: sources, feeder, ring and output rendered to WAV
+// files (pio test -e native). The files stay in the working directory.
+
+#include <unity.h>
+#include "audio.h"
+
+// Counting source: frame i holds first + i in both channels
+struct Ramp {
+  int16_t next;
+  uint32_t left;
+  AudioSource source;
+};
+
+static uint32_t ramp_read(void* ctx, int16_t* out, uint32_t frames) {
+  Ramp* r = (Ramp*)ctx;
+  uint32_t n = min(frames, r->left);
+  for (uint32_t i = 0; i < n; i++, r->next++) out[i * 2] = out[i * 2 + 1] = r->next;
+  r->left -= n;
+  return n;
+}
+
+static void ramp_init(Ramp* r, int16_t first, uint32_t frames) {
+  r->next = first;
+  r->left = frames;
+  r->source.read = ramp_read;
+  r->source.ctx = r;
+  r->source.sample_rate = AUDIO_SAMPLE_RATE;
+}
+
+// Left channel of a 16-bit stereo WAV written by audio_host_render
+static int16_t* read_wav(const char* path, uint32_t* frames, uint32_t* rate) {
+  FILE* f = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  uint8_t h[44];
+  TEST_ASSERT_EQUAL(sizeof(h), fread(h, 1, sizeof(h), f));
+  TEST_ASSERT_EQUAL_MEMORY("RIFF", h, 4);
+  TEST_ASSERT_EQUAL_MEMORY("data", h + 36, 4);
+  TEST_ASSERT_EQUAL(2, h[22]);
+  TEST_ASSERT_EQUAL(16, h[34]);
+  *rate = h[24] | h[25] << 8 | h[26] << 16 | (uint32_t)h[27] << 24;
+  *frames = (h[40] | h[41] << 8 | h[42] << 16 | (uint32_t)h[43] << 24) / 4;
+
+  int16_t* left = (int16_t*)malloc(*frames * sizeof(int16_t));
+  int16_t frame[2];
+  for (uint32_t i = 0; i < *frames; i++) {
+    TEST_ASSERT_EQUAL(1, fread(frame, sizeof(frame), 1, f));
+    left[i] = frame[0];
+  }
+  fclose(f);
+  return left;
+}
+
+void setUp() {
+  audio_stop();
+  audio_set_volume(255);
+  AudioStats stats;
+  audio_get_stats(&stats, true);
+}
+
+void tearDown() {
+}
+
+static void test_tone_renders_at_pitch() {
+  audio_play(audio_tone_source(1000));
+  TEST_ASSERT_TRUE(audio_host_render("test_tone.wav", AUDIO_SAMPLE_RATE, 1));
+
+  uint32_t frames, rate;
+  int16_t* left = read_wav("test_tone.wav", &frames, &rate);
+  TEST_ASSERT_EQUAL_UINT32(AUDIO_SAMPLE_RATE, rate);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(AUDIO_SAMPLE_RATE, frames);
+
+  // One second of 1 kHz: 2000 zero crossings, give or take the first block of silence
+  uint32_t crossings = 0;
+  int16_t peak = 0;
+  for (uint32_t i = 1; i < frames; i++) {
+    if ((left[i - 1] < 0) != (left[i] < 0)) crossings++;
+    peak = max(peak, left[i]);
+  }
+  free(left);
+  TEST_ASSERT_UINT32_WITHIN(40, 2000, crossings);
+  TEST_ASSERT_INT16_WITHIN(100, 12000, peak);
+}
+
+// The output runs first after a flush and finds the ring empty
+static void test_start_is_not_an_underrun() {
+  audio_play(audio_tone_source(440));
+  TEST_ASSERT_TRUE(audio_host_render("test_start.wav", AUDIO_SAMPLE_RATE / 4, 1));
+  AudioStats stats;
+  audio_get_stats(&stats, false);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.underruns);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, stats.frames_out);
+}
+
+static void test_slow_feeder_underruns() {
+  audio_play(audio_tone_source(440));
+  uint32_t blocks = AUDIO_RING_FRAMES / AUDIO_DMA_FRAMES;
+  TEST_ASSERT_TRUE(audio_host_render("test_slow.wav", AUDIO_SAMPLE_RATE, blocks * 2));
+  AudioStats stats;
+  audio_get_stats(&stats, false);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, stats.underruns);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.ring_min);
+}
+
+// The queued source's first frame follows the last one of the current source
+static void test_gapless_transition() {
+  Ramp a, b;
+  // Longer than the ring, so the next one is decoded ahead while it plays
+  ramp_init(&a, 1000, AUDIO_RING_FRAMES * 2);
+  ramp_init(&b, 1000 + AUDIO_RING_FRAMES * 2, 5000);
+  const uint32_t total = AUDIO_RING_FRAMES * 2 + 5000;
+  AudioTransition before, after;
+  audio_get_transition(&before);
+
+  audio_play(&a.source);
+  audio_queue(&b.source);
+  TEST_ASSERT_TRUE(audio_host_render("test_gapless.wav", total + 2 * AUDIO_DMA_FRAMES, 1));
+
+  TEST_ASSERT_EQUAL_UINT32(before.seq + 1, audio_get_transition(&after));
+  TEST_ASSERT_EQUAL_UINT32(0, after.gap_frames);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, after.preroll_frames);
+
+  uint32_t frames, rate;
+  int16_t* left = read_wav("test_gapless.wav", &frames, &rate);
+  uint32_t k = 0;
+  while (k < frames && left[k] == 0) k++;
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(frames - total, k);
+  for (int32_t i = 0; i < (int32_t)total; i++) {
+    TEST_ASSERT_EQUAL_INT16(((1000 + i) * 255) >> 8, left[k + i]);
+  }
+  free(left);
+
+  AudioStats stats;
+  audio_get_stats(&stats, false);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.underruns);
+}
+
+int main(int argc, char** argv) {
+  audio_init();
+  UNITY_BEGIN();
+  RUN_TEST(test_tone_renders_at_pitch);
+  RUN_TEST(test_start_is_not_an_underrun);
+  RUN_TEST(test_slow_feeder_underruns);
+  RUN_TEST(test_gapless_transition);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// Library index on the host: tag parsing, the sorted index, and rescans
+// that keep the tags of unchanged files, over the SD stand-in
+// (pio test -e native).
+
+#include <unity.h>
+#include <SD.h>
+#include "library.h"
+#include "storage.h"
+
+static uint32_t put_chunk(uint8_t* p, const char* id, const char* text) {
+  uint32_t len = strlen(text) + 1;
+  memcpy(p, id, 4);
+  memcpy(p + 4, &len, 4);
+  memcpy(p + 8, text, len);
+  if (len & 1) p[8 + len++] = 0;
+  return 8 + len;
+}
+
+// WAV with a LIST/INFO chunk ahead of a short data chunk. 'bad' sizes the
+// chunk after LIST so that skipping it wraps a 32-bit offset.
+static void write_wav(const char* path, const char* title, const char* artist, const char* album,
+                      uint32_t data_len, bool bad = false) {
+  uint8_t b[512];
+  uint32_t n = 12;
+  memcpy(b, "RIFF\0\0\0\0WAVE", 12);
+  uint32_t list = n;
+  memcpy(b + n, "LIST\0\0\0\0INFO", 12);
+  n += 12;
+  if (title) n += put_chunk(b + n, "INAM", title);
+  if (artist) n += put_chunk(b + n, "IART", artist);
+  if (album) n += put_chunk(b + n, "IPRD", album);
+  uint32_t list_len = n - list - 8;
+  memcpy(b + list + 4, &list_len, 4);
+  if (bad) {
+    uint32_t huge = 0xFFFFFFF8;
+    memcpy(b + n, "junk", 4);
+    memcpy(b + n + 4, &huge, 4);
+    n += 8;
+  }
+  memcpy(b + n, "data", 4);
+  memcpy(b + n + 4, &data_len, 4);
+  n += 8;
+  uint32_t riff = n + data_len - 8;
+  memcpy(b + 4, &riff, 4);
+
+  File f = SD.open(path, FILE_WRITE);
+  TEST_ASSERT_TRUE(f);
+  f.write(b, n);
+  memset(b, 0, sizeof(b));
+  for (uint32_t i = 0; i < data_len; i += sizeof(b)) f.write(b, min((uint32_t)sizeof(b), data_len - i));
+  f.close();
+}
+
+static void wait_scan(LibraryStats* s) {
+  for (int i = 0; i < 1000; i++) {
+    library_get_stats(s);
+    if (!s->scanning) return;
+    delay(10);
+  }
+  TEST_FAIL_MESSAGE("scan did not finish");
+}
+
+static void scan(LibraryStats* s) {
+  TEST_ASSERT_TRUE(library_scan_start());
+  wait_scan(s);
+}
+
+static void check_track(uint32_t index, const char* artist, const char* album, const char* title) {
+  LibraryTrack t;
+  TEST_ASSERT_TRUE(library_get_track(index, &t));
+  TEST_ASSERT_EQUAL_STRING(artist, t.artist);
+  TEST_ASSERT_EQUAL_STRING(album, t.album);
+  TEST_ASSERT_EQUAL_STRING(title, t.title);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+// Built by library_init, which finds no index
+static void test_index_is_sorted_and_grouped() {
+  LibraryStats s;
+  wait_scan(&s);
+  TEST_ASSERT_EQUAL_UINT32(5, s.tracks);
+  TEST_ASSERT_EQUAL_UINT32(3, s.artists);
+  TEST_ASSERT_EQUAL_UINT32(4, s.albums);
+  check_track(0, "Alpha", "First", "One");
+  check_track(1, "Alpha", "First", "Two");
+  check_track(2, "Alpha", "Second", "Three");
+  check_track(3, "Beta", "Unknown album", "Four");
+  check_track(4, "Unknown artist", "Unknown album", "untagged");
+
+  char name[LIBRARY_STR_MAX];
+  uint32_t first, count;
+  TEST_ASSERT_TRUE(library_get_artist(0, name, sizeof(name), &first, &count));
+  TEST_ASSERT_EQUAL_STRING("Alpha", name);
+  TEST_ASSERT_EQUAL_UINT32(0, first);
+  TEST_ASSERT_EQUAL_UINT32(3, count);
+  TEST_ASSERT_EQUAL_INT32(1, library_find_title("o"));
+  TEST_ASSERT_EQUAL_UINT32(0, library_title_track(library_find_title("one")));
+}
+
+// A chunk size that wraps the offset on the device must end the parse, not
+// loop; tags read before it are kept
+static void test_bad_chunk_size_ends_parse() {
+  write_wav("/music/bad.wav", "Broken", "Gamma", "Sizes", 100, true);
+  LibraryStats s;
+  scan(&s);
+  TEST_ASSERT_EQUAL_UINT32(6, s.tracks);
+  check_track(4, "Gamma", "Sizes", "Broken");
+  SD.remove("/music/bad.wav");
+}
+
+static void test_rescan_reuses_unchanged_files() {
+  LibraryStats s;
+  scan(&s);
+  TEST_ASSERT_EQUAL_UINT32(5, s.scan_files);
+  TEST_ASSERT_EQUAL_UINT32(5, s.scan_reused);
+
+  // New tags and a new size: read again, the rest reused
+  write_wav("/music/b/four.wav", "Four", "Alpha", "Second", 300);
+  scan(&s);
+  TEST_ASSERT_EQUAL_UINT32(5, s.scan_files);
+  TEST_ASSERT_EQUAL_UINT32(4, s.scan_reused);
+  TEST_ASSERT_EQUAL_UINT32(2, s.artists);
+  check_track(2, "Alpha", "Second", "Four");
+  check_track(3, "Alpha", "Second", "Three");
+}
+
+int main(int argc, char** argv) {
+  storage_init();
+  SD.remove(LIBRARY_PATH);
+  SD.mkdir("/music");
+  SD.mkdir("/music/a");
+  SD.mkdir("/music/b");
+  write_wav("/music/a/1.wav", "One", "Alpha", "First", 100);
+  write_wav("/music/a/2.wav", "Two", "alpha", "First", 100);
+  write_wav("/music/a/3.wav", "Three", "Alpha", "Second", 100);
+  write_wav("/music/b/four.wav", "Four", "Beta", NULL, 200);
+  write_wav("/music/untagged.wav", NULL, NULL, NULL, 100);
+  library_init();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_index_is_sorted_and_grouped);
+  RUN_TEST(test_bad_chunk_size_ends_parse);
+  RUN_TEST(test_rescan_reuses_unchanged_files);
+  return UNITY_END();
+}
@@ -0,0 +1,210 @@
+// Storage engine on the host: read-ahead streams and coalesced logs over the
+// SD stand-in (a directory, CYD_SD_IMAGE), and the record-sized read
+// benchmark against a card with per-command latency (pio test -e native).
+
+#include <unity.h>
+#include <SD.h>
+#include "storage.h"
+
+#define BENCH_PATH "/bench.bin"
+#define BENCH_SIZE (128 * 1024)
+#define BENCH_SMALL 100
+#define CARD_LATENCY_US 200           // Per command, about what the device sees at 20 MHz
+#define CARD_KBPS 2000
+
+static uint8_t pattern(uint32_t i) {
+  return i * 7 + (i >> 8);
+}
+
+static void write_file(const char* path, uint32_t size) {
+  File f = SD.open(path, FILE_WRITE);
+  TEST_ASSERT_TRUE(f);
+  uint8_t buf[256];
+  for (uint32_t i = 0; i < size; i += sizeof(buf)) {
+    uint32_t n = min((uint32_t)sizeof(buf), size - i);
+    for (uint32_t k = 0; k < n; k++) buf[k] = pattern(i + k);
+    TEST_ASSERT_EQUAL(n, f.write(buf, n));
+  }
+  f.close();
+}
+
+// Whole file through a stream in 'chunk' reads
+static void check_stream(const char* path, uint32_t size, size_t chunk) {
+  static uint8_t buf[STORAGE_BLOCK * 2];
+  StorageStream* s = storage_stream_open(path);
+  TEST_ASSERT_NOT_NULL(s);
+  TEST_ASSERT_EQUAL_UINT32(size, storage_stream_size(s));
+  uint32_t pos = 0;
+  size_t n;
+  while ((n = storage_stream_read(s, buf, chunk)) > 0) {
+    for (size_t k = 0; k < n; k++) {
+      if (buf[k] != pattern(pos + k)) TEST_FAIL_MESSAGE("stream data differs from the file");
+    }
+    pos += n;
+  }
+  storage_stream_close(s);
+  TEST_ASSERT_EQUAL_UINT32(size, pos);
+}
+
+void setUp() {
+  host_sd_set_speed(0, 0);
+}
+
+void tearDown() {
+}
+
+static void test_card_image_mounts() {
+  TEST_ASSERT_TRUE(storage_mounted());
+}
+
+static void test_stream_reads_whole_file() {
+  const uint32_t size = STORAGE_BLOCK * 3 + 123;
+  write_file("/stream.bin", size);
+  check_stream("/stream.bin", size, BENCH_SMALL);
+  check_stream("/stream.bin", size, STORAGE_BLOCK + 1000);
+  check_stream("/stream.bin", size, 1);
+  SD.remove("/stream.bin");
+}
+
+static void test_stream_reads_empty_file() {
+  write_file("/empty.bin", 0);
+  check_stream("/empty.bin", 0, BENCH_SMALL);
+  SD.remove("/empty.bin");
+}
+
+static void test_missing_file_has_no_stream() {
+  TEST_ASSERT_NULL(storage_stream_open("/missing.bin"));
+}
+
+// Records span buffer hand-offs; paced so the card is never two buffers behind
+static void test_log_keeps_records_in_order() {
+  SD.remove("/test.log");
+  StorageStats st;
+  storage_get_stats(&st, true);
+  StorageLog* log = storage_log_open("/test.log");
+  TEST_ASSERT_NOT_NULL(log);
+  char line[32];
+  const int records = 1000;
+  for (int i = 0; i < records; i++) {
+    int n = snprintf(line, sizeof(line), "record %06d\n", i);
+    storage_log_write(log, line, n);
+    if (i % 50 == 49) delay(2);
+  }
+  storage_log_close(log);
+  storage_get_stats(&st, false);
+  TEST_ASSERT_EQUAL_UINT32(0, st.log_dropped);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, st.write_ops);
+
+  static char text[records * 16];
+  File f = SD.open("/test.log", FILE_READ);
+  TEST_ASSERT_TRUE(f);
+  size_t len = f.read((uint8_t*)text, sizeof(text) - 1);
+  f.close();
+  text[len] = 0;
+  char* p = text;
+  for (int i = 0; i < records; i++) {
+    int n = snprintf(line, sizeof(line), "record %06d\n", i);
+    TEST_ASSERT_EQUAL_STRING_LEN(line, p, n);
+    p += n;
+  }
+  TEST_ASSERT_EQUAL(p - text, len);
+  SD.remove("/test.log");
+}
+
+// The storage task's periodic wake holds the card lock for a moment
+static bool idle_soon() {
+  for (int i = 0; i < 20; i++) {
+    if (storage_idle()) return true;
+    delay(1);
+  }
+  return false;
+}
+
+// What the idle loop checks before a light sleep
+static void test_idle_only_without_open_work() {
+  TEST_ASSERT_TRUE(idle_soon());
+  write_file("/idle.bin", 100);
+  StorageStream* s = storage_stream_open("/idle.bin");
+  TEST_ASSERT_FALSE(storage_idle());
+  storage_stream_close(s);
+  TEST_ASSERT_TRUE(idle_soon());
+
+  StorageLog* log = storage_log_open("/idle.log");
+  TEST_ASSERT_TRUE(idle_soon());
+  storage_log_write(log, "x", 1);
+  TEST_ASSERT_FALSE(storage_idle());
+  storage_log_close(log);
+  TEST_ASSERT_TRUE(idle_soon());
+  SD.remove("/idle.bin");
+  SD.remove("/idle.log");
+}
+
+// BENCH,sd,<name>,<ops>,<total_us>,<us_per_op>, then BENCH,sd,<name>_kbps,<kbps>
+static void report(const char* name, uint32_t ops, uint32_t bytes, uint32_t us) {
+  printf("BENCH,sd,%s,%u,%u,%u\n", name, ops, us, ops ? us / ops : 0);
+  printf("BENCH,sd,%s_kbps,%u\n", name, us ? (uint32_t)((uint64_t)bytes * 1000000 / 1024 / us) : 0);
+}
+
+static uint32_t direct_read(const char* name, size_t chunk) {
+  static uint8_t buf[STORAGE_BLOCK];
+  File f = SD.open(BENCH_PATH, FILE_READ);
+  TEST_ASSERT_TRUE(f);
+  uint32_t ops = 0, bytes = 0;
+  size_t n;
+  uint32_t t = micros();
+  while ((n = f.read(buf, chunk)) > 0) {
+    ops++;
+    bytes += n;
+  }
+  t = micros() - t;
+  f.close();
+  TEST_ASSERT_EQUAL_UINT32(BENCH_SIZE, bytes);
+  report(name, ops, bytes, t);
+  return t;
+}
+
+// Record-sized reads: straight from the card each call pays the command
+// latency; through the stream they are served from the read-ahead
+static void test_bench_stream_against_direct() {
+  write_file(BENCH_PATH, BENCH_SIZE);
+  host_sd_set_speed(CARD_LATENCY_US, CARD_KBPS);
+  uint32_t direct = direct_read("host_read_100", BENCH_SMALL);
+  direct_read("host_read_block", STORAGE_BLOCK);
+
+  StorageStats st;
+  storage_get_stats(&st, true);
+  uint8_t buf[BENCH_SMALL];
+  StorageStream* s = storage_stream_open(BENCH_PATH);
+  TEST_ASSERT_NOT_NULL(s);
+  uint32_t ops = 0, bytes = 0;
+  size_t n;
+  uint32_t t = micros();
+  while ((n = storage_stream_read(s, buf, sizeof(buf))) > 0) {
+    ops++;
+    bytes += n;
+  }
+  t = micros() - t;
+  storage_stream_close(s);
+  report("host_stream_100", ops, bytes, t);
+  storage_get_stats(&st, true);
+  // BENCH,sd,stream_io,<card_reads>,<read_max_us>,<stalls>
+  printf("BENCH,sd,host_stream_io,%u,%u,%u\n", st.read_ops, st.read_max_us, st.stalls);
+
+  TEST_ASSERT_EQUAL_UINT32(BENCH_SIZE, bytes);
+  TEST_ASSERT_EQUAL_UINT32(BENCH_SIZE / STORAGE_BLOCK + 1, st.read_ops);
+  TEST_ASSERT_LESS_THAN_UINT32(direct, t);
+  SD.remove(BENCH_PATH);
+}
+
+int main(int argc, char** argv) {
+  storage_init();
+  UNITY_BEGIN();
+  RUN_TEST(test_card_image_mounts);
+  RUN_TEST(test_stream_reads_whole_file);
+  RUN_TEST(test_stream_reads_empty_file);
+  RUN_TEST(test_missing_file_has_no_stream);
+  RUN_TEST(test_log_keeps_records_in_order);
+  RUN_TEST(test_idle_only_without_open_work);
+  RUN_TEST(test_bench_stream_against_direct);
+  return UNITY_END();
+}
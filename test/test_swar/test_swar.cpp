@@ -0,0 +1,141 @@
+// RGB565 SWAR kernels on the host against the scalar references, in native
+// and byte-swapped order, over both word alignments and odd and even lengths
+// (pio test -e native). Timings print as BENCH lines in the device format.
+
+#include <unity.h>
+#include "rgb565_swar.h"
+
+#define LEN 240
+#define ROWS 20000
+
+static uint16_t a[LEN + 2], b[LEN + 2];
+static uint8_t mask[LEN];
+
+static uint32_t seed = 1;
+
+static uint32_t next() {
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 8;
+}
+
+static uint16_t swap16(uint16_t c) {
+  return (c >> 8) | (c << 8);
+}
+
+// Runs of clear and opaque pixels with edges between them, as glyphs and
+// anti-aliased lines have; 'levels' 16 keeps every value a 4-bit alpha
+static void make_mask(uint32_t levels) {
+  for (int i = 0; i < LEN;) {
+    int run = 1 + next() % 9;
+    uint32_t kind = next() % 3;
+    for (; run && i < LEN; run--, i++) {
+      uint32_t v = kind == 0 ? 0 : kind == 1 ? levels - 1 : next() % levels;
+      mask[i] = levels == 16 ? v * 17 : v;
+    }
+  }
+}
+
+// Two pixels per byte, high nibble first, from the A8 mask
+static void pack_a4(uint8_t* mask4) {
+  memset(mask4, 0, LEN / 2 + 1);
+  for (int i = 0; i < LEN; i++) mask4[i >> 1] |= (mask[i] / 17) << ((i & 1) ? 0 : 4);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+enum Kernel { FILL, CONST, A8, A4 };
+
+// Run the kernel at dst + off for len pixels and the reference on a copy.
+// Swapped kernels are checked against the reference on unswapped pixels.
+static void check(Kernel k, bool sw, uint32_t off, uint32_t len, uint16_t color, uint8_t alpha, const uint8_t* m4) {
+  for (int i = 0; i < LEN + 2; i++) a[i] = b[i] = next();
+  if (sw) for (int i = 0; i < LEN + 2; i++) b[i] = swap16(a[i]);
+
+  uint16_t* d = a + off;
+  uint16_t* r = b + off;
+  switch (k) {
+    case FILL:
+      if (sw) swar_fill_sw(d, color, len); else swar_fill(d, color, len);
+      for (uint32_t i = 0; i < len; i++) r[i] = color;
+      break;
+    case CONST:
+      if (sw) swar_blend_const_sw(d, color, alpha, len); else swar_blend_const(d, color, alpha, len);
+      scalar_blend_const(r, color, alpha, len);
+      break;
+    case A8:
+      if (sw) swar_blend_a8_sw(d, color, mask, len); else swar_blend_a8(d, color, mask, len);
+      scalar_blend_a8(r, color, mask, len);
+      break;
+    case A4:
+      if (sw) swar_blend_a4_sw(d, color, m4, len); else swar_blend_a4(d, color, m4, len);
+      scalar_blend_a4(r, color, m4, len);
+      break;
+  }
+  if (sw) for (int i = 0; i < LEN + 2; i++) b[i] = swap16(b[i]);
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "kernel %d%s off %u len %u", k, sw ? "_sw" : "", off, len);
+  TEST_ASSERT_EQUAL_HEX16_ARRAY_MESSAGE(b, a, LEN + 2, msg);
+}
+
+// Both alignments, lengths 0-9 and the longest, each kernel in both orders
+static void check_all(Kernel k, uint32_t levels) {
+  uint8_t m4[LEN / 2 + 1];
+  for (int rep = 0; rep < 20; rep++) {
+    make_mask(levels);
+    pack_a4(m4);
+    uint16_t color = next();
+    uint8_t alpha = rep == 0 ? 0 : rep == 1 ? 255 : next();
+    for (int sw = 0; sw < 2; sw++) {
+      for (uint32_t off = 0; off < 2; off++) {
+        for (uint32_t len = 0; len < 10; len++) check(k, sw, off, len, color, alpha, m4);
+        check(k, sw, off, LEN - off, color, alpha, m4);
+      }
+    }
+  }
+}
+
+static void test_fill() {
+  check_all(FILL, 256);
+}
+
+static void test_blend_const() {
+  check_all(CONST, 256);
+}
+
+static void test_blend_a8() {
+  check_all(A8, 256);
+}
+
+static void test_blend_a4() {
+  check_all(A4, 16);
+}
+
+// One LEN-pixel row per iteration, half transparent edges
+static void test_bench_a8() {
+  make_mask(256);
+  uint32_t t = micros();
+  for (int i = 0; i < ROWS; i++) scalar_blend_a8(a, 0xFD20, mask, LEN);
+  uint32_t t_scalar = micros() - t;
+  t = micros();
+  for (int i = 0; i < ROWS; i++) swar_blend_a8(a, 0xFD20, mask, LEN);
+  uint32_t t_swar = micros() - t;
+  // BENCH,swar,<name>,<iterations>,<total_us>,<us_per_iter>
+  printf("BENCH,swar,host_scalar_a8_row,%u,%u,%u\n", ROWS, t_scalar, t_scalar / ROWS);
+  printf("BENCH,swar,host_swar_a8_row,%u,%u,%u\n", ROWS, t_swar, t_swar / ROWS);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, t_scalar);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill);
+  RUN_TEST(test_blend_const);
+  RUN_TEST(test_blend_a8);
+  RUN_TEST(test_blend_a4);
+  RUN_TEST(test_bench_a8);
+  return UNITY_END();
+}